@@ -0,0 +1,186 @@
+/*
+  ==============================================================================
+
+    AudioCallbackStats.cpp
+    Created: 25 Jun 2023 10:12:37am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "AudioCallbackStats.h"
+#include <cmath>
+
+namespace
+{
+    /**Bucket of a callback that used exactly its deadline*/
+    const int deadlineBucket = 24;
+    const int bucketsPerOctave = 4;
+    const double windowSeconds = 0.25;
+}
+
+AudioCallbackStats::AudioCallbackStats()
+    : ticksPerSecond(double(juce::Time::getHighResolutionTicksPerSecond()))
+{
+    prepare(sampleRate);
+}
+
+void AudioCallbackStats::prepare(double _sampleRate)
+{
+    sampleRate = _sampleRate;
+    windowBusyTicks = 0;
+    windowDeadlineTicks = 0.0;
+    windowPeakLoad = 0.0f;
+    for (auto& deckTicks : windowDeckTicks)
+    {
+        deckTicks = 0;
+    }
+
+    numCallbacks = 0;
+    numOverruns = 0;
+    load = 0.0f;
+    peakLoad = 0.0f;
+    for (auto& deckLoad : deckLoads)
+    {
+        deckLoad = 0.0f;
+    }
+    for (auto& count : histogram)
+    {
+        count = 0;
+    }
+}
+
+void AudioCallbackStats::endCallback(juce::int64 startTicks, int numSamples)
+{
+    if (numSamples <= 0 || sampleRate <= 0)
+    {
+        return;
+    }
+    auto busyTicks = juce::Time::getHighResolutionTicks() - startTicks;
+    double deadlineTicks = numSamples / sampleRate * ticksPerSecond;
+    double callbackLoad = busyTicks / deadlineTicks;
+
+    // only this thread writes, so relaxed increments are enough
+    histogram[size_t(getBucket(callbackLoad))].fetch_add(1, std::memory_order_relaxed);
+    numCallbacks.fetch_add(1, std::memory_order_relaxed);
+    if (callbackLoad > 1.0)
+    {
+        numOverruns.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    windowBusyTicks += busyTicks;
+    windowDeadlineTicks += deadlineTicks;
+    windowPeakLoad = juce::jmax(windowPeakLoad, float(callbackLoad));
+    if (windowDeadlineTicks >= windowSeconds * ticksPerSecond)
+    {
+        load.store(float(windowBusyTicks / windowDeadlineTicks), std::memory_order_relaxed);
+        peakLoad.store(windowPeakLoad, std::memory_order_relaxed);
+        // a late deck's time lands in whichever window is open when it finishes
+        for (size_t deck = 0; deck < windowDeckTicks.size(); ++deck)
+        {
+            auto deckTicks = windowDeckTicks[deck].exchange(0, std::memory_order_relaxed);
+            deckLoads[deck].store(float(deckTicks / windowDeadlineTicks), std::memory_order_relaxed);
+        }
+        windowBusyTicks = 0;
+        windowDeadlineTicks = 0.0;
+        windowPeakLoad = 0.0f;
+    }
+}
+
+AudioCallbackStats::Snapshot AudioCallbackStats::getSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.numCallbacks = numCallbacks.load(std::memory_order_relaxed);
+    snapshot.numOverruns = numOverruns.load(std::memory_order_relaxed);
+    snapshot.load = load.load(std::memory_order_relaxed);
+    snapshot.peakLoad = peakLoad.load(std::memory_order_relaxed);
+    for (size_t deck = 0; deck < deckLoads.size(); ++deck)
+    {
+        snapshot.deckLoads[deck] = deckLoads[deck].load(std::memory_order_relaxed);
+    }
+    for (size_t bucket = 0; bucket < histogram.size(); ++bucket)
+    {
+        snapshot.histogram[bucket] = histogram[bucket].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+double AudioCallbackStats::getBucketStart(int bucket)
+{
+    if (bucket <= 0)
+    {
+        return 0.0;
+    }
+    return std::exp2(double(bucket - deadlineBucket) / bucketsPerOctave);
+}
+
+int AudioCallbackStats::getBucket(double callbackLoad)
+{
+    if (callbackLoad <= 0.0)
+    {
+        return 0;
+    }
+    int bucket = int(std::floor(std::log2(callbackLoad) * bucketsPerOctave)) + deadlineBucket;
+    return juce::jlimit(0, numBuckets - 1, bucket);
+}
+
+juce::String AudioCallbackStats::Snapshot::toString() const
+{
+    juce::String text;
+    text << "callbacks " << numCallbacks << ", overruns " << numOverruns
+         << ", load " << juce::roundToInt(load * 100.0f) << "% (peak " << juce::roundToInt(peakLoad * 100.0f) << "%)";
+    for (size_t deck = 0; deck < deckLoads.size(); ++deck)
+    {
+        if (deckLoads[deck] > 0.0f)
+        {
+            text << ", deck " << int(deck + 1) << " " << juce::roundToInt(deckLoads[deck] * 100.0f) << "%";
+        }
+    }
+    for (int bucket = 0; bucket < numBuckets; ++bucket)
+    {
+        if (histogram[size_t(bucket)] > 0)
+        {
+            text << juce::newLine << "  >= " << juce::String(getBucketStart(bucket) * 100.0, 1) << "% of deadline: "
+                 << int(histogram[size_t(bucket)]);
+        }
+    }
+    return text;
+}
+
+AudioCallbackStats::ScopedCallback::ScopedCallback(AudioCallbackStats& _stats, int _numSamples)
+    : stats(_stats),
+      numSamples(_numSamples),
+      startTicks(juce::Time::getHighResolutionTicks())
+{
+}
+
+AudioCallbackStats::ScopedCallback::~ScopedCallback()
+{
+    stats.endCallback(startTicks, numSamples);
+}
+
+AudioCallbackStats::DeckTimer::DeckTimer(AudioCallbackStats& _stats, int _deckIndex, juce::AudioSource* _source)
+    : stats(_stats),
+      deckIndex(_deckIndex),
+      source(_source)
+{
+    jassert(deckIndex >= 0 && deckIndex < maxDecks);
+}
+
+void AudioCallbackStats::DeckTimer::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    source->prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void AudioCallbackStats::DeckTimer::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    auto startTicks = juce::Time::getHighResolutionTicks();
+    source->getNextAudioBlock(bufferToFill);
+    stats.windowDeckTicks[size_t(deckIndex)].fetch_add(juce::Time::getHighResolutionTicks() - startTicks,
+                                                       std::memory_order_relaxed);
+}
+
+void AudioCallbackStats::DeckTimer::releaseResources()
+{
+    source->releaseResources();
+}
@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    AudioCallbackStats.h
+    Created: 25 Jun 2023 10:12:37am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+//==============================================================================
+/*
+    Times every audio callback against its deadline, the length of audio it
+    has to produce, without the audio thread ever taking a lock.
+
+    Each callback goes into a histogram of how much of the deadline it used,
+    in quarter-octave buckets from 1/64 of the deadline to 4 times over it,
+    and callbacks that run past the deadline are counted as overruns. The
+    time each deck takes is measured by wrapping it in a DeckTimer.
+
+    Averages and peaks over each quarter second are published into atomics,
+    so the GUI and the log can take a snapshot from any thread.
+*/
+class AudioCallbackStats
+{
+    public:
+        static constexpr int numBuckets = 32;
+        static constexpr int maxDecks = 8;
+
+        struct Snapshot
+        {
+            juce::int64 numCallbacks{ 0 };
+            juce::int64 numOverruns{ 0 };
+            /**Proportion of the deadline used over the last quarter second*/
+            float load{ 0.0f };
+            /**The slowest single callback in the last quarter second*/
+            float peakLoad{ 0.0f };
+            std::array<float, maxDecks> deckLoads{};
+            std::array<juce::uint32, numBuckets> histogram{};
+
+            /**One line of totals, then a line for each histogram bucket in use*/
+            juce::String toString() const;
+        };
+
+        /**Runs for the length of a callback, from the top of getNextAudioBlock*/
+        class ScopedCallback
+        {
+            public:
+                ScopedCallback(AudioCallbackStats& _stats, int _numSamples);
+                ~ScopedCallback();
+
+            private:
+                AudioCallbackStats& stats;
+                int numSamples;
+                juce::int64 startTicks;
+
+                JUCE_DECLARE_NON_COPYABLE (ScopedCallback)
+        };
+
+        /**Passes a deck's audio through, timing how long the deck takes*/
+        class DeckTimer : public juce::AudioSource
+        {
+            public:
+                DeckTimer(AudioCallbackStats& _stats, int _deckIndex, juce::AudioSource* _source);
+
+                void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+                void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+                void releaseResources() override;
+
+            private:
+                AudioCallbackStats& stats;
+                int deckIndex;
+                juce::AudioSource* source;
+
+                JUCE_DECLARE_NON_COPYABLE (DeckTimer)
+        };
+
+        AudioCallbackStats();
+
+        /**Clears the counts for a new sample rate, before callbacks start*/
+        void prepare(double _sampleRate);
+        /**Any thread: the totals and the latest quarter second*/
+        Snapshot getSnapshot() const;
+        /**The proportion of the deadline where a histogram bucket starts*/
+        static double getBucketStart(int bucket);
+
+    private:
+        void endCallback(juce::int64 startTicks, int numSamples);
+        static int getBucket(double load);
+
+        double sampleRate{ 44100.0 };
+        double ticksPerSecond;
+
+        /**Only touched by the audio thread*/
+        juce::int64 windowBusyTicks{ 0 };
+        double windowDeadlineTicks{ 0.0 };
+        float windowPeakLoad{ 0.0f };
+        /**Each deck's added to by whichever thread renders it, which may still
+           be a worker after the callback has ended, so they are atomic and
+           each window takes them with an exchange*/
+        std::array<std::atomic<juce::int64>, maxDecks> windowDeckTicks;
+
+        /**Written by the audio thread, read by anyone*/
+        std::atomic<juce::int64> numCallbacks{ 0 };
+        std::atomic<juce::int64> numOverruns{ 0 };
+        std::atomic<float> load{ 0.0f };
+        std::atomic<float> peakLoad{ 0.0f };
+        std::array<std::atomic<float>, maxDecks> deckLoads;
+        std::array<std::atomic<juce::uint32>, numBuckets> histogram;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioCallbackStats)
+};
@@ -0,0 +1,181 @@
+/*
+  ==============================================================================
+
+    BeatAnalyser.cpp
+    Created: 13 Aug 2023 10:26:41am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "BeatAnalyser.h"
+#include "SimdOps.h"
+
+BeatAnalyser::BeatAnalyser()
+{
+    int frameSize = fft.getSize();
+    window.resize(size_t(frameSize));
+    for (int i = 0; i < frameSize; ++i)
+    {
+        window[size_t(i)] = 0.5f - 0.5f * std::cos(2.0f * juce::MathConstants<float>::pi * float(i) / float(frameSize));
+    }
+    frame.resize(size_t(frameSize));
+    magnitudes.resize(size_t(frameSize / 2 + 1));
+    previousMagnitudes.resize(magnitudes.size());
+}
+
+BeatAnalyser::Result BeatAnalyser::analyse(const float* samples, int numSamples, double sampleRate)
+{
+    Result result;
+    findOnsets(samples, numSamples, sampleRate);
+    double framesPerSecond = sampleRate / hopSize;
+    int roughPeriod = findPeriod(framesPerSecond);
+    if (roughPeriod == 0)
+    {
+        return result;
+    }
+
+    double firstBeat = 0.0;
+    double period = refinePeriod(roughPeriod, firstBeat);
+
+    // the bar starts on whichever beat has the most kick drum across the track
+    double bestStrength = -1.0;
+    double downbeat = firstBeat;
+    for (int beatOfBar = 0; beatOfBar < 4; ++beatOfBar)
+    {
+        double strength = 0.0;
+        for (double beat = firstBeat + beatOfBar * period; beat < double(bassOnsets.size()); beat += 4.0 * period)
+        {
+            strength += sampleAt(bassOnsets, beat);
+        }
+        if (strength > bestStrength)
+        {
+            bestStrength = strength;
+            downbeat = firstBeat + beatOfBar * period;
+        }
+    }
+
+    result.bpm = 60.0 * framesPerSecond / period;
+    // the log spectrum picks an onset up as soon as it comes into the frame
+    result.firstDownbeat = (downbeat * hopSize + fft.getSize() - hopSize / 2) / sampleRate;
+    return result;
+}
+
+void BeatAnalyser::findOnsets(const float* samples, int numSamples, double sampleRate)
+{
+    int frameSize = fft.getSize();
+    int numFrames = numSamples >= frameSize ? 1 + (numSamples - frameSize) / hopSize : 0;
+    onsets.assign(size_t(numFrames), 0.0f);
+    bassOnsets.assign(size_t(numFrames), 0.0f);
+    std::fill(previousMagnitudes.begin(), previousMagnitudes.end(), 0.0f);
+
+    // the kick drum and bass, up to about 150Hz
+    int numBins = int(magnitudes.size());
+    int numBassBins = juce::jlimit(1, numBins, int(std::ceil(150.0 * frameSize / sampleRate)) + 1);
+    for (int f = 0; f < numFrames; ++f)
+    {
+        juce::FloatVectorOperations::multiply(frame.data(), samples + f * hopSize, window.data(), frameSize);
+        fft.performMagnitudes(frame.data(), magnitudes.data());
+        // compressed so quiet onsets count as well as loud ones
+        for (auto& magnitude : magnitudes)
+        {
+            magnitude = std::log1p(100.0f * magnitude);
+        }
+        onsets[size_t(f)] = SimdOps::sumOfIncreases(magnitudes.data(), previousMagnitudes.data(), numBins);
+        bassOnsets[size_t(f)] = SimdOps::sumOfIncreases(magnitudes.data(), previousMagnitudes.data(), numBassBins);
+        std::swap(magnitudes, previousMagnitudes);
+    }
+
+    // only what stands out from the last quarter second or so is an onset
+    const int meanFrames = 16;
+    std::vector<double> runningTotal(size_t(numFrames + 1), 0.0);
+    for (int f = 0; f < numFrames; ++f)
+    {
+        runningTotal[size_t(f + 1)] = runningTotal[size_t(f)] + onsets[size_t(f)];
+    }
+    for (int f = 0; f < numFrames; ++f)
+    {
+        int from = juce::jmax(0, f - meanFrames);
+        int to = juce::jmin(numFrames, f + meanFrames + 1);
+        float mean = float((runningTotal[size_t(to)] - runningTotal[size_t(from)]) / (to - from));
+        onsets[size_t(f)] = juce::jmax(0.0f, onsets[size_t(f)] - mean);
+    }
+}
+
+int BeatAnalyser::findPeriod(double framesPerSecond)
+{
+    int numFrames = int(onsets.size());
+    int shortest = juce::jmax(1, int(std::floor(60.0 * framesPerSecond / maxBpm)));
+    int longest = int(std::ceil(60.0 * framesPerSecond / minBpm));
+    if (numFrames < 4 * longest)
+    {
+        return 0;
+    }
+
+    int bestPeriod = 0;
+    double bestScore = 0.0;
+    for (int lag = shortest; lag <= longest; ++lag)
+    {
+        double correlation = SimdOps::dotProduct(onsets.data(), onsets.data() + lag, numFrames - lag) / double(numFrames - lag);
+        // a tempo an octave away from 120 BPM needs a much stronger beat to win
+        double octavesFrom120 = std::log2(60.0 * framesPerSecond / lag / 120.0);
+        double score = correlation * std::exp(-0.5 * octavesFrom120 * octavesFrom120);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestPeriod = lag;
+        }
+    }
+    return bestPeriod;
+}
+
+double BeatAnalyser::refinePeriod(int roughPeriod, double& firstBeat)
+{
+    // each period's onsets are folded onto one beat, and the period that piles
+    // them up the highest at any phase wins
+    const int numPhases = 48;
+    const int numCandidates = 161;
+    phaseStrengths.resize(size_t(numPhases));
+    double bestPeriod = roughPeriod;
+    double bestStrength = -1.0;
+    int bestPhase = 0;
+    for (int candidate = 0; candidate < numCandidates; ++candidate)
+    {
+        // a frame either side of the rough period
+        double period = roughPeriod - 1.0 + 2.0 * candidate / (numCandidates - 1);
+        std::fill(phaseStrengths.begin(), phaseStrengths.end(), 0.0f);
+        double phasesPerFrame = numPhases / period;
+        for (size_t f = 0; f < onsets.size(); ++f)
+        {
+            double beats = double(f) * phasesPerFrame;
+            int phase = int(beats - std::floor(beats / numPhases) * numPhases) % numPhases;
+            phaseStrengths[size_t(phase)] += onsets[f];
+        }
+        for (int phase = 0; phase < numPhases; ++phase)
+        {
+            // neighbouring phases count too, so an onset split across two isn't lost
+            float strength = phaseStrengths[size_t((phase + numPhases - 1) % numPhases)]
+                             + 2.0f * phaseStrengths[size_t(phase)]
+                             + phaseStrengths[size_t((phase + 1) % numPhases)];
+            if (strength > bestStrength)
+            {
+                bestStrength = strength;
+                bestPeriod = period;
+                bestPhase = phase;
+            }
+        }
+    }
+    firstBeat = bestPhase * bestPeriod / numPhases;
+    return bestPeriod;
+}
+
+float BeatAnalyser::sampleAt(const std::vector<float>& values, double frame)
+{
+    auto index = size_t(frame);
+    if (index + 1 >= values.size())
+    {
+        return index < values.size() ? values[index] : 0.0f;
+    }
+    float fraction = float(frame - double(index));
+    return values[index] + fraction * (values[index + 1] - values[index]);
+}
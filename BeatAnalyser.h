@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    BeatAnalyser.h
+    Created: 13 Aug 2023 10:26:41am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "RealFft.h"
+
+//==============================================================================
+/*
+    Finds the tempo of a track and lays a beat grid over it, from mono audio
+    that has been brought down to around 11kHz.
+
+    Onsets are the rise in log spectrum from one short frame to the next,
+    once over every bin and once over the low bins where the kick drum is.
+    The onsets' autocorrelation, weighted towards 120 BPM, picks the beat
+    period to the nearest frame. That is refined by trying periods close
+    to it and keeping the one whose onsets line up best across the whole
+    track, which also gives the phase of the beats. The downbeat is the
+    beat of the bar with the most kick drum on it.
+
+    The grid assumes the tempo holds for the whole track. One analyser can
+    be used for any number of tracks, but only by one thread at a time.
+*/
+class BeatAnalyser
+{
+    public:
+        struct Result
+        {
+            /**0 if no steady beat was found*/
+            double bpm{ 0.0 };
+            /**Seconds into the track of a downbeat, with the rest of the grid
+               every 60 / bpm seconds either side of it*/
+            double firstDownbeat{ 0.0 };
+        };
+
+        BeatAnalyser();
+
+        Result analyse(const float* samples, int numSamples, double sampleRate);
+
+        static constexpr double minBpm = 60.0;
+        static constexpr double maxBpm = 200.0;
+
+    private:
+        /**Fills onsets and bassOnsets with one value a frame*/
+        void findOnsets(const float* samples, int numSamples, double sampleRate);
+        /**The beat period in frames, to the nearest frame, or 0 if there's no beat*/
+        int findPeriod(double framesPerSecond);
+        /**Tries periods close to the rough one, returning the best and the
+           frame of the first beat*/
+        double refinePeriod(int roughPeriod, double& firstBeat);
+        /**The onset strength at a fractional frame*/
+        static float sampleAt(const std::vector<float>& values, double frame);
+
+        static constexpr int fftOrder = 9;
+        static constexpr int hopSize = 128;
+
+        RealFft fft{ fftOrder };
+        std::vector<float> window, frame, magnitudes, previousMagnitudes;
+        std::vector<float> onsets, bassOnsets;
+        std::vector<float> phaseStrengths;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BeatAnalyser)
+};
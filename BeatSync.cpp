@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    BeatSync.cpp
+    Created: 20 Aug 2023 2:37:18pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "BeatSync.h"
+
+BeatSync::BeatSync()
+{
+}
+
+void BeatSync::setMaster(int deck)
+{
+    if (deck != noMaster && (deck < 0 || deck >= maxDecks))
+    {
+        DBG("BeatSync::setMaster deck should be between 0 and " << maxDecks - 1);
+        return;
+    }
+    master.store(deck);
+}
+
+int BeatSync::getMaster() const
+{
+    return master.load();
+}
+
+void BeatSync::publish(int deck, juce::int64 sampleTime, double beat, double beatsPerSample, bool playing)
+{
+    auto& clock = clocks[deck];
+    auto sequence = clock.sequence.load(std::memory_order_relaxed);
+    clock.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    clock.sampleTime.store(sampleTime, std::memory_order_relaxed);
+    clock.beat.store(beat, std::memory_order_relaxed);
+    clock.beatsPerSample.store(beatsPerSample, std::memory_order_relaxed);
+    clock.playing.store(playing, std::memory_order_relaxed);
+    clock.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool BeatSync::getMasterClock(int deck, juce::int64 sampleTime, MasterClock& result) const
+{
+    int masterDeck = master.load(std::memory_order_relaxed);
+    if (masterDeck == noMaster || masterDeck == deck)
+    {
+        return false;
+    }
+
+    const auto& clock = clocks[masterDeck];
+    for (int attempt = 0; attempt < maxReadAttempts; ++attempt)
+    {
+        auto before = clock.sequence.load(std::memory_order_acquire);
+        if ((before & 1) != 0)
+        {
+            continue;
+        }
+        auto stamp = clock.sampleTime.load(std::memory_order_relaxed);
+        double beat = clock.beat.load(std::memory_order_relaxed);
+        double beatsPerSample = clock.beatsPerSample.load(std::memory_order_relaxed);
+        bool playing = clock.playing.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (clock.sequence.load(std::memory_order_relaxed) != before)
+        {
+            continue;
+        }
+
+        if (beatsPerSample <= 0.0)
+        {
+            return false;
+        }
+        // the master may be a block ahead or behind, its tempo carries it to sampleTime
+        result.beat = playing ? beat + double(sampleTime - stamp) * beatsPerSample : beat;
+        result.beatsPerSample = beatsPerSample;
+        result.playing = playing;
+        return true;
+    }
+    return false;
+}
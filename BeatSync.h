@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    BeatSync.h
+    Created: 20 Aug 2023 2:37:18pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+//==============================================================================
+/*
+    The clock the decks share for SYNC, so a synced deck can follow the
+    tempo and beat phase of the master deck.
+
+    At the end of every block each deck publishes where it is in its beat
+    grid, stamped with the number of samples it has rendered since the audio
+    started. The decks render the same blocks in lock step, so a stamp is the
+    same instant on every deck, and a deck can work out where the master is
+    at the start of its own block whether the master has rendered this block
+    yet or not.
+
+    Publishing and reading never wait: each deck's clock has a sequence
+    number around it rather than a lock, and a reader that catches a clock
+    mid-update tries again a few times before giving up for that block.
+*/
+class BeatSync
+{
+    public:
+        static constexpr int maxDecks = 8;
+        static constexpr int noMaster = -1;
+
+        /**Where the master is at the sample a deck asked about*/
+        struct MasterClock
+        {
+            double beat{ 0.0 };
+            double beatsPerSample{ 0.0 };
+            /**A stopped master still has a tempo to match, but no phase to lock to*/
+            bool playing{ false };
+        };
+
+        BeatSync();
+
+        /**Message thread: the deck the synced decks follow, or noMaster. The
+           first deck leads until another is chosen*/
+        void setMaster(int deck);
+        int getMaster() const;
+
+        /**Audio thread of the deck: where its beat grid is at sampleTime, the
+           end of the block it has just rendered. A beatsPerSample of 0 means it
+           has no beat grid, and nothing follows it*/
+        void publish(int deck, juce::int64 sampleTime, double beat, double beatsPerSample, bool playing);
+        /**Audio thread of any other deck: where the master is at sampleTime.
+           Returns false if there is no master with a beat grid to follow*/
+        bool getMasterClock(int deck, juce::int64 sampleTime, MasterClock& clock) const;
+
+    private:
+        struct Clock
+        {
+            /**Odd while the deck is part way through publishing*/
+            std::atomic<juce::uint32> sequence{ 0 };
+            std::atomic<juce::int64> sampleTime{ 0 };
+            std::atomic<double> beat{ 0.0 };
+            /**0 while the deck has no beat grid*/
+            std::atomic<double> beatsPerSample{ 0.0 };
+            std::atomic<bool> playing{ false };
+        };
+
+        /**Tries this many times to catch a clock between updates*/
+        static constexpr int maxReadAttempts = 4;
+
+        Clock clocks[maxDecks];
+        std::atomic<int> master{ 0 };
+
+        JUCE_DECLARE_NON_COPYABLE (BeatSync)
+};
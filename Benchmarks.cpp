@@ -0,0 +1,967 @@
+/*
+  ==============================================================================
+
+    Benchmarks.cpp
+    Created: 9 Apr 2023 5:02:44pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "Benchmarks.h"
+#include "DJAudioPlayer.h"
+#include "MetadataProbe.h"
+#include "OfflineRenderer.h"
+#include "CachedAudioSource.h"
+#include "PolyphaseResampler.h"
+#include "TimeStretcher.h"
+#include "StereoReverb.h"
+#include "DeckEngine.h"
+#include "MixBus.h"
+#include "BeatSync.h"
+#include "TrackAnalyser.h"
+#include "LibraryFile.h"
+#include "SearchIndex.h"
+#include "KeyAnalyser.h"
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+    double ticksToMicroseconds(juce::int64 ticks)
+    {
+        return juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6;
+    }
+
+    juce::Array<juce::File> findAudioFiles(juce::AudioFormatManager& formatManager,
+                                           const juce::File& folder,
+                                           int maxFiles)
+    {
+        juce::Array<juce::File> files;
+        for (const auto& entry : juce::RangedDirectoryIterator(folder, true,
+                                                               formatManager.getWildcardForAllFormats(),
+                                                               juce::File::findFiles))
+        {
+            files.add(entry.getFile());
+            if (files.size() >= maxFiles)
+            {
+                break;
+            }
+        }
+        return files;
+    }
+
+    /**Gets a percentile, from 0 to 100, of some timings*/
+    double percentile(std::vector<double> values, double percent)
+    {
+        if (values.empty())
+        {
+            return 0.0;
+        }
+        std::sort(values.begin(), values.end());
+        auto index = size_t(juce::jlimit(0.0, double(values.size() - 1), percent / 100.0 * double(values.size() - 1)));
+        return values[index];
+    }
+
+    void printResult(const juce::String& name, juce::DynamicObject* result)
+    {
+        result->setProperty("benchmark", name);
+        std::cout << juce::JSON::toString(juce::var(result)) << std::endl;
+    }
+}
+
+bool Benchmarks::isBenchmarkCommandLine(const juce::String& commandLine)
+{
+    return commandLine.contains("--benchmark");
+}
+
+int Benchmarks::run(const juce::String& commandLine)
+{
+    auto args = juce::StringArray::fromTokens(commandLine, " ", "\"");
+    args.removeEmptyStrings();
+    for (auto& arg : args)
+    {
+        arg = arg.unquoted();
+    }
+
+    int nameIndex = args.indexOf("--benchmark") + 1;
+    juce::String name = args[nameIndex];
+    args.removeRange(0, nameIndex + 1);
+
+    if (name == "probe")
+    {
+        return metadataProbe(args);
+    }
+    if (name == "mmap")
+    {
+        return mappedReader(args);
+    }
+    if (name == "render")
+    {
+        return offlineRender(args);
+    }
+    if (name == "dsp")
+    {
+        return dspChain(args);
+    }
+    if (name == "analysis")
+    {
+        return trackAnalysis(args);
+    }
+    if (name == "library")
+    {
+        return libraryFile(args);
+    }
+    if (name == "search")
+    {
+        return librarySearch(args);
+    }
+
+    std::cerr << "unknown benchmark: " << name << std::endl;
+    return 1;
+}
+
+int Benchmarks::metadataProbe(const juce::StringArray& args)
+{
+    juce::File folder{ args[0] };
+    int maxFiles = args.size() > 1 ? args[1].getIntValue() : 200;
+    if (!folder.isDirectory())
+    {
+        std::cerr << "usage: --benchmark probe <folder> [maxFiles]" << std::endl;
+        return 1;
+    }
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    auto files = findAudioFiles(formatManager, folder, maxFiles);
+    if (files.isEmpty())
+    {
+        std::cerr << "no audio files found in " << folder.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    DJAudioPlayer player{ formatManager };
+    MetadataProbe probe{ formatManager };
+
+    auto timePlayer = [&]
+    {
+        auto start = juce::Time::getHighResolutionTicks();
+        for (const auto& file : files)
+        {
+            player.loadURL(juce::URL{ file });
+            player.getLengthInSeconds();
+        }
+        return juce::Time::getHighResolutionTicks() - start;
+    };
+    auto timeProbe = [&]
+    {
+        auto start = juce::Time::getHighResolutionTicks();
+        for (const auto& file : files)
+        {
+            TrackMetadata metadata;
+            probe.probe(file, metadata);
+        }
+        return juce::Time::getHighResolutionTicks() - start;
+    };
+
+    // one untimed pass each so both read from a warm file cache
+    timePlayer();
+    timeProbe();
+    double playerMicros = ticksToMicroseconds(timePlayer()) / files.size();
+    double probeMicros = ticksToMicroseconds(timeProbe()) / files.size();
+
+    // the probe should agree with the player on every file
+    double maxLengthError = 0.0;
+    for (const auto& file : files)
+    {
+        TrackMetadata metadata;
+        probe.probe(file, metadata);
+        player.loadURL(juce::URL{ file });
+        maxLengthError = juce::jmax(maxLengthError,
+                                    std::abs(metadata.lengthInSeconds - player.getLengthInSeconds()));
+    }
+
+    auto* result = new juce::DynamicObject();
+    result->setProperty("files", files.size());
+    result->setProperty("playerLoadMicrosPerFile", playerMicros);
+    result->setProperty("probeMicrosPerFile", probeMicros);
+    result->setProperty("speedup", playerMicros / juce::jmax(probeMicros, 1.0e-3));
+    result->setProperty("maxLengthErrorSeconds", maxLengthError);
+    printResult("probe", result);
+    return 0;
+}
+
+int Benchmarks::mappedReader(const juce::StringArray& args)
+{
+    juce::File file{ args[0] };
+    int numSeeks = args.size() > 1 ? args[1].getIntValue() : 1000;
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> streamed{ formatManager.createReaderFor(file) };
+    auto mapped = DJAudioPlayer::createMappedReader(formatManager, file);
+    if (streamed == nullptr || mapped == nullptr)
+    {
+        std::cerr << "usage: --benchmark mmap <wav or aiff file> [numSeeks]" << std::endl;
+        return 1;
+    }
+
+    const int blockSize = 512;
+    juce::AudioBuffer<float> buffer{ 2, blockSize };
+    juce::AudioSourceChannelInfo block{ &buffer, 0, blockSize };
+    auto* result = new juce::DynamicObject();
+    double seconds = streamed->lengthInSamples / streamed->sampleRate;
+
+    auto measure = [&](const juce::String& prefix, juce::AudioFormatReader* reader)
+    {
+        juce::AudioFormatReaderSource source{ reader, false };
+        source.prepareToPlay(blockSize, reader->sampleRate);
+
+        // one untimed pass so both read from a warm file cache
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            source.setNextReadPosition(0);
+            auto start = juce::Time::getHighResolutionTicks();
+            while (source.getNextReadPosition() < reader->lengthInSamples)
+            {
+                source.getNextAudioBlock(block);
+            }
+            if (pass == 1)
+            {
+                auto micros = ticksToMicroseconds(juce::Time::getHighResolutionTicks() - start);
+                result->setProperty(prefix + "ReadMicrosPerSecondOfAudio", micros / seconds);
+            }
+        }
+
+        juce::Random random{ 1234 };
+        std::vector<double> seekMicros;
+        for (int i = 0; i < numSeeks; ++i)
+        {
+            auto start = juce::Time::getHighResolutionTicks();
+            source.setNextReadPosition(juce::int64(random.nextDouble() * double(reader->lengthInSamples)));
+            source.getNextAudioBlock(block);
+            seekMicros.push_back(ticksToMicroseconds(juce::Time::getHighResolutionTicks() - start));
+        }
+        result->setProperty(prefix + "SeekMicrosMedian", percentile(seekMicros, 50.0));
+        result->setProperty(prefix + "SeekMicrosP99", percentile(seekMicros, 99.0));
+    };
+    measure("streamed", streamed.get());
+    measure("mapped", mapped.get());
+
+    result->setProperty("file", file.getFileName());
+    result->setProperty("seconds", seconds);
+    result->setProperty("seeks", numSeeks);
+    printResult("mmap", result);
+    return 0;
+}
+
+int Benchmarks::offlineRender(const juce::StringArray& args)
+{
+    juce::File scriptFile{ args[0] };
+    juce::File outputFile{ args[1] };
+    double seconds = args[2].getDoubleValue();
+    int decksIndex = args.indexOf("--decks");
+    int numDecks = decksIndex >= 0 ? args[decksIndex + 1].getIntValue() : 2;
+    if (!scriptFile.existsAsFile() || args[1].isEmpty() || seconds <= 0
+        || numDecks < 1 || numDecks > OfflineRenderer::maxDecks)
+    {
+        std::cerr << "usage: --benchmark render <script> <output.wav> <seconds> [--decks n]" << std::endl;
+        return 1;
+    }
+
+    std::vector<OfflineRenderer::Event> events;
+    auto parsed = OfflineRenderer::parseScript(scriptFile.loadFileAsString(), events);
+    if (parsed.failed())
+    {
+        std::cerr << "bad script, " << parsed.getErrorMessage() << std::endl;
+        return 1;
+    }
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    OfflineRenderer renderer{ formatManager, numDecks };
+    auto rendered = renderer.render(events, seconds, outputFile);
+    if (!rendered.succeeded)
+    {
+        std::cerr << "couldn't write " << outputFile.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    auto* result = new juce::DynamicObject();
+    result->setProperty("output", outputFile.getFullPathName());
+    result->setProperty("events", int(events.size()));
+    result->setProperty("decks", numDecks);
+    result->setProperty("audioSeconds", rendered.audioSeconds);
+    result->setProperty("renderSeconds", rendered.renderSeconds);
+    result->setProperty("realtimeFactor", rendered.realtimeFactor);
+    result->setProperty("underruns", rendered.underruns);
+    printResult("render", result);
+    return 0;
+}
+
+int Benchmarks::dspChain(const juce::StringArray& args)
+{
+    juce::String inputPath, savePath, baselinePath;
+    int blocksPerRun = 500;
+    for (int i = 0; i < args.size(); ++i)
+    {
+        if (args[i] == "--blocks")            blocksPerRun = juce::jmax(10, args[++i].getIntValue());
+        else if (args[i] == "--save")         savePath = args[++i];
+        else if (args[i] == "--baseline")     baselinePath = args[++i];
+        else                                  inputPath = args[i];
+    }
+
+    const double sampleRate = 44100.0;
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    // a minute of stereo noise over a sine unless a file is given
+    DecodedAudioCache::AudioPtr input;
+    if (inputPath.isNotEmpty())
+    {
+        juce::SharedResourcePointer<DecodedAudioCache> decodedAudio;
+        input = decodedAudio->getOrDecode(juce::File{ inputPath }, formatManager);
+        if (input == nullptr)
+        {
+            std::cerr << "couldn't decode " << inputPath << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        auto synthetic = std::make_shared<DecodedAudioCache::DecodedAudio>();
+        synthetic->sampleRate = sampleRate;
+        synthetic->samples.setSize(2, int(60 * sampleRate));
+        juce::Random random{ 42 };
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            auto* samples = synthetic->samples.getWritePointer(channel);
+            for (int i = 0; i < synthetic->samples.getNumSamples(); ++i)
+            {
+                samples[i] = 0.5f * std::sin(float(i) * 0.0627f * float(channel + 1))
+                             + 0.1f * (random.nextFloat() * 2.0f - 1.0f);
+            }
+        }
+        input = synthetic;
+    }
+
+    const int blockSizes[] = { 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+    const double ratios[] = { 0.25, 0.5, 1.0, 1.5, 2.0, 4.0 };
+    // with the small nudges sync and the pitch fader make, where the filter's cutoff matters most
+    const double resamplerRatios[] = { 0.25, 0.5, 1.0, 1.01, 1.06, 1.5, 2.0, 4.0 };
+    juce::Array<juce::var> results;
+
+    // times one block at a time, so percentiles show the odd slow block
+    auto measure = [&](const juce::String& stage, int blockSize, double ratio, bool reverbOn,
+                       const std::function<void(juce::AudioBuffer<float>&)>& processBlock,
+                       const std::function<void(juce::AudioBuffer<float>&)>& prepareBlock)
+    {
+        juce::AudioBuffer<float> buffer{ 2, blockSize };
+        std::vector<double> blockNanos;
+        for (int i = 0; i < blocksPerRun + blocksPerRun / 10; ++i)
+        {
+            // rewinding and refilling the input aren't part of the timing
+            prepareBlock(buffer);
+            auto start = juce::Time::getHighResolutionTicks();
+            processBlock(buffer);
+            auto nanos = ticksToMicroseconds(juce::Time::getHighResolutionTicks() - start) * 1000.0;
+            // the first few blocks warm the caches
+            if (i >= blocksPerRun / 10)
+            {
+                blockNanos.push_back(nanos);
+            }
+        }
+
+        auto* result = new juce::DynamicObject();
+        result->setProperty("stage", stage);
+        result->setProperty("blockSize", blockSize);
+        result->setProperty("ratio", ratio);
+        result->setProperty("reverb", reverbOn);
+        result->setProperty("nsPerSample", percentile(blockNanos, 50.0) / blockSize);
+        result->setProperty("nsPerBlockP50", percentile(blockNanos, 50.0));
+        result->setProperty("nsPerBlockP90", percentile(blockNanos, 90.0));
+        result->setProperty("nsPerBlockP99", percentile(blockNanos, 99.0));
+        results.add(juce::var(result));
+    };
+
+    // a source that starts again from the top when it runs out
+    auto makeSource = [&input]
+    {
+        return std::make_unique<CachedAudioSource>(input);
+    };
+    auto rewindIfNearEnd = [&input](juce::PositionableAudioSource& source)
+    {
+        if (source.getNextReadPosition() > input->samples.getNumSamples() - 4 * 4096)
+        {
+            source.setNextReadPosition(0);
+        }
+    };
+
+    for (int blockSize : blockSizes)
+    {
+        auto source = makeSource();
+        measure("source", blockSize, 1.0, false, [&](juce::AudioBuffer<float>& buffer)
+        {
+            source->getNextAudioBlock(juce::AudioSourceChannelInfo(buffer));
+        }, [&](juce::AudioBuffer<float>&) { rewindIfNearEnd(*source); });
+
+        auto transportInput = makeSource();
+        juce::AudioTransportSource transport;
+        transport.setSource(transportInput.get(), 0, nullptr, input->sampleRate);
+        transport.prepareToPlay(blockSize, sampleRate);
+        transport.start();
+        measure("transport", blockSize, 1.0, false, [&](juce::AudioBuffer<float>& buffer)
+        {
+            transport.getNextAudioBlock(juce::AudioSourceChannelInfo(buffer));
+        }, [&](juce::AudioBuffer<float>&) { rewindIfNearEnd(*transportInput); });
+        transport.setSource(nullptr);
+
+        for (double ratio : resamplerRatios)
+        {
+            auto resamplerInput = makeSource();
+            juce::ResamplingAudioSource resampler{ resamplerInput.get(), false, 2 };
+            resampler.setResamplingRatio(ratio);
+            resampler.prepareToPlay(blockSize, sampleRate);
+            measure("resampler", blockSize, ratio, false, [&](juce::AudioBuffer<float>& buffer)
+            {
+                resampler.getNextAudioBlock(juce::AudioSourceChannelInfo(buffer));
+            }, [&](juce::AudioBuffer<float>&) { rewindIfNearEnd(*resamplerInput); });
+
+            // the deck's own resampler at each quality, against JUCE's above
+            const std::pair<PolyphaseResampler::Quality, const char*> qualities[] = {
+                { PolyphaseResampler::Quality::draft, "polyphase-draft" },
+                { PolyphaseResampler::Quality::normal, "polyphase-normal" },
+                { PolyphaseResampler::Quality::high, "polyphase-high" }
+            };
+            for (const auto& quality : qualities)
+            {
+                auto polyphaseInput = makeSource();
+                PolyphaseResampler polyphase{ polyphaseInput.get() };
+                polyphase.setQuality(quality.first);
+                polyphase.prepareToPlay(blockSize, sampleRate);
+                polyphase.setResamplingRatio(ratio);
+                measure(quality.second, blockSize, ratio, false, [&](juce::AudioBuffer<float>& buffer)
+                {
+                    polyphase.getNextAudioBlock(juce::AudioSourceChannelInfo(buffer));
+                }, [&](juce::AudioBuffer<float>&) { rewindIfNearEnd(*polyphaseInput); });
+            }
+
+            // key lock, where the cost is in the searches once per half frame
+            const std::pair<TimeStretcher::Quality, const char*> stretchQualities[] = {
+                { TimeStretcher::Quality::lowLatency, "stretch-lowLatency" },
+                { TimeStretcher::Quality::normal, "stretch-normal" },
+                { TimeStretcher::Quality::high, "stretch-high" }
+            };
+            for (const auto& quality : stretchQualities)
+            {
+                auto stretchInput = makeSource();
+                TimeStretcher stretcher{ stretchInput.get() };
+                stretcher.setQuality(quality.first);
+                stretcher.prepareToPlay(blockSize, sampleRate);
+                stretcher.setTempoRatio(ratio);
+                measure(quality.second, blockSize, ratio, false, [&](juce::AudioBuffer<float>& buffer)
+                {
+                    stretcher.getNextAudioBlock(juce::AudioSourceChannelInfo(buffer));
+                }, [&](juce::AudioBuffer<float>&) { rewindIfNearEnd(*stretchInput); });
+            }
+        }
+
+        juce::Reverb reverb;
+        juce::Reverb::Parameters reverbParameters;
+        reverb.setParameters(reverbParameters);
+        reverb.setSampleRate(sampleRate);
+        auto reverbInput = makeSource();
+        measure("reverb", blockSize, 1.0, true, [&](juce::AudioBuffer<float>& buffer)
+        {
+            reverb.processStereo(buffer.getWritePointer(0), buffer.getWritePointer(1), buffer.getNumSamples());
+        }, [&](juce::AudioBuffer<float>& buffer)
+        {
+            rewindIfNearEnd(*reverbInput);
+            reverbInput->getNextAudioBlock(juce::AudioSourceChannelInfo(buffer));
+        });
+
+        // the deck's reverb with the same settings, then at the neutral setting it skips
+        for (bool reverbOn : { true, false })
+        {
+            StereoReverb stereoReverb;
+            auto stereoParameters = reverbParameters;
+            stereoParameters.wetLevel = reverbOn ? reverbParameters.wetLevel : 0.0f;
+            stereoReverb.setSampleRate(sampleRate);
+            stereoReverb.setParameters(stereoParameters);
+            measure(reverbOn ? "reverb-simd" : "reverb-bypass", blockSize, 1.0, reverbOn, [&](juce::AudioBuffer<float>& buffer)
+            {
+                stereoReverb.processStereo(buffer.getWritePointer(0), buffer.getWritePointer(1), buffer.getNumSamples());
+            }, [&](juce::AudioBuffer<float>& buffer)
+            {
+                rewindIfNearEnd(*reverbInput);
+                reverbInput->getNextAudioBlock(juce::AudioSourceChannelInfo(buffer));
+            });
+        }
+
+        for (double ratio : ratios)
+        {
+            for (bool reverbOn : { false, true })
+            {
+                DJAudioPlayer player{ formatManager };
+                player.loadDecodedAudio(input);
+                player.setSpeed(ratio);
+                player.setWetLevel(reverbOn ? 0.33f : 0.0f);
+                player.setRoomSize(reverbOn ? 0.5f : 0.0f);
+                player.prepareToPlay(blockSize, sampleRate);
+                player.play();
+                measure("chain", blockSize, ratio, reverbOn, [&](juce::AudioBuffer<float>& buffer)
+                {
+                    player.getNextAudioBlock(juce::AudioSourceChannelInfo(buffer));
+                }, [&](juce::AudioBuffer<float>&)
+                {
+                    if (player.getPositionRelative() > 0.9)
+                    {
+                        player.setPositionRelative(0.0);
+                    }
+                });
+                player.releaseResources();
+            }
+        }
+
+        // a deck following another's beats, against the same deck playing free at
+        // the speed sync settles on. The master renders outside the timing
+        const double masterBpm = 120.0;
+        const double followerBpm = 124.0;
+        for (bool synced : { false, true })
+        {
+            BeatSync beatSync;
+            DJAudioPlayer master{ formatManager };
+            DJAudioPlayer follower{ formatManager };
+            juce::AudioBuffer<float> masterBuffer{ 2, blockSize };
+            master.setBeatSync(&beatSync, 0);
+            follower.setBeatSync(&beatSync, 1);
+            master.loadDecodedAudio(input, masterBpm, 0.0);
+            follower.loadDecodedAudio(input, followerBpm, 0.1);
+            follower.setSpeed(masterBpm / followerBpm);
+            follower.setSync(synced);
+            master.prepareToPlay(blockSize, sampleRate);
+            follower.prepareToPlay(blockSize, sampleRate);
+            master.play();
+            follower.play();
+            measure(synced ? "chain-synced" : "chain-unsynced", blockSize, masterBpm / followerBpm, false,
+                    [&](juce::AudioBuffer<float>& buffer)
+            {
+                follower.getNextAudioBlock(juce::AudioSourceChannelInfo(buffer));
+            }, [&](juce::AudioBuffer<float>&)
+            {
+                // both go back to the top together, so the follower stays locked
+                if (master.getPositionRelative() > 0.9 || follower.getPositionRelative() > 0.9)
+                {
+                    master.setPositionRelative(0.0);
+                    follower.setPositionRelative(0.0);
+                }
+                master.getNextAudioBlock(juce::AudioSourceChannelInfo(masterBuffer));
+            });
+            master.releaseResources();
+            follower.releaseResources();
+        }
+    }
+
+    // several decks mixed on the audio thread alone, then spread over the cores
+    for (int blockSize : blockSizes)
+    {
+        for (int numDecks : { 2, 4, 8 })
+        {
+            juce::OwnedArray<DJAudioPlayer> players;
+            for (int deck = 0; deck < numDecks; ++deck)
+            {
+                auto* player = players.add(new DJAudioPlayer{ formatManager });
+                player->loadDecodedAudio(input);
+                player->setWetLevel(0.33f);
+                player->setRoomSize(0.5f);
+                player->play();
+            }
+            for (bool parallel : { false, true })
+            {
+                DeckEngine engine{ parallel ? juce::jmin(numDecks - 1, juce::SystemStats::getNumCpus() - 1) : 0 };
+                for (auto* player : players)
+                {
+                    engine.addInput(player);
+                }
+                engine.prepareToPlay(blockSize, sampleRate);
+                measure(parallel ? "engine-parallel" : "engine-serial", blockSize, 1.0, true, [&](juce::AudioBuffer<float>& buffer)
+                {
+                    engine.getNextAudioBlock(juce::AudioSourceChannelInfo(buffer));
+                }, [&](juce::AudioBuffer<float>&)
+                {
+                    for (auto* player : players)
+                    {
+                        if (player->getPositionRelative() > 0.9)
+                        {
+                            player->setPositionRelative(0.0);
+                        }
+                    }
+                });
+                results.getReference(results.size() - 1).getDynamicObject()->setProperty("decks", numDecks);
+                results.getReference(results.size() - 1).getDynamicObject()->setProperty("workers", engine.getNumWorkers());
+                results.getReference(results.size() - 1).getDynamicObject()->setProperty("lateInputs", engine.getNumLateInputs());
+                engine.releaseResources();
+            }
+        }
+    }
+
+    // the mix stage alone: gain in each deck then a plain sum and a master gain,
+    // against the mix bus doing all three in one pass, with the faders still and moving
+    for (int blockSize : blockSizes)
+    {
+        for (int numDecks : { 2, 4, 8 })
+        {
+            juce::OwnedArray<juce::AudioBuffer<float>> deckBuffers;
+            juce::OwnedArray<juce::AudioBuffer<float>> renderedBuffers;
+            for (int deck = 0; deck < numDecks; ++deck)
+            {
+                auto* rendered = renderedBuffers.add(new juce::AudioBuffer<float>{ 2, blockSize });
+                for (int channel = 0; channel < 2; ++channel)
+                {
+                    rendered->copyFrom(channel, 0, input->samples, juce::jmin(channel, input->samples.getNumChannels() - 1),
+                                      (deck * blockSize) % juce::jmax(1, input->samples.getNumSamples() - blockSize), blockSize);
+                }
+                deckBuffers.add(new juce::AudioBuffer<float>{ 2, blockSize });
+            }
+            // each deck's buffer is as it came out of the deck at the start of every block
+            auto refill = [&](juce::AudioBuffer<float>&)
+            {
+                for (int deck = 0; deck < numDecks; ++deck)
+                {
+                    deckBuffers[deck]->makeCopyOf(*renderedBuffers[deck], true);
+                }
+            };
+
+            for (bool moving : { false, true })
+            {
+                int block = 0;
+                measure(moving ? "mix-separate-moving" : "mix-separate", blockSize, 1.0, false, [&](juce::AudioBuffer<float>& buffer)
+                {
+                    float gain = moving ? 0.5f + 0.25f * float(block++ % 2) : 0.8f;
+                    buffer.clear();
+                    for (auto* deckBuffer : deckBuffers)
+                    {
+                        deckBuffer->applyGainRamp(0, blockSize, moving ? 1.25f - gain : gain, gain);
+                        for (int channel = 0; channel < 2; ++channel)
+                        {
+                            buffer.addFrom(channel, 0, *deckBuffer, channel, 0, blockSize);
+                        }
+                    }
+                    buffer.applyGain(0.9f);
+                }, refill);
+
+                MixBus mixBus;
+                mixBus.setMasterGain(0.9f);
+                mixBus.setCrossfaderCurve(MixBus::CrossfaderCurve::constantPower);
+                mixBus.prepareToPlay(sampleRate);
+                block = 0;
+                measure(moving ? "mix-fused-moving" : "mix-fused", blockSize, 1.0, false, [&](juce::AudioBuffer<float>& buffer)
+                {
+                    // a fader moving every block keeps every channel ramping
+                    if (moving)
+                    {
+                        mixBus.setChannelGain(0, 0.5f + 0.25f * float(block++ % 2));
+                        mixBus.setCrossfader(0.25f + 0.5f * float(block % 2));
+                    }
+                    mixBus.process(juce::AudioSourceChannelInfo(buffer), deckBuffers.getRawDataPointer(), numDecks);
+                }, refill);
+            }
+            for (int i = 1; i <= 4; ++i)
+            {
+                auto* result = results.getReference(results.size() - i).getDynamicObject();
+                result->setProperty("decks", numDecks);
+                result->setProperty("nsPerDeckSample", double(result->getProperty("nsPerSample")) / numDecks);
+            }
+        }
+    }
+
+    auto resultKey = [](const juce::var& result)
+    {
+        return result["stage"].toString() + "/" + result["blockSize"].toString() + "/"
+               + result["ratio"].toString() + "/" + result["reverb"].toString()
+               + "/" + result["decks"].toString();
+    };
+
+    // the deck's normal resampler against JUCE's, which it replaced
+    std::map<juce::String, double> juceResamplerNanos;
+    for (const auto& result : results)
+    {
+        if (result["stage"].toString() == "resampler")
+        {
+            juceResamplerNanos[result["blockSize"].toString() + "/" + result["ratio"].toString()] = double(result["nsPerSample"]);
+        }
+    }
+    int numSlowerThanJuce = 0;
+    for (auto& result : results)
+    {
+        auto match = juceResamplerNanos.find(result["blockSize"].toString() + "/" + result["ratio"].toString());
+        if (result["stage"].toString().startsWith("polyphase-") && match != juceResamplerNanos.end() && match->second > 0.0)
+        {
+            double change = double(result["nsPerSample"]) / match->second;
+            result.getDynamicObject()->setProperty("vsJuceResampler", change);
+            numSlowerThanJuce += result["stage"].toString() == "polyphase-normal" && change > 1.0 ? 1 : 0;
+        }
+    }
+
+    // anything more than 10% slower than the baseline is called out
+    int numRegressions = 0;
+    if (baselinePath.isNotEmpty())
+    {
+        auto baseline = juce::JSON::parse(juce::File{ baselinePath });
+        std::map<juce::String, double> baselineNanos;
+        if (auto* baselineResults = baseline["results"].getArray())
+        {
+            for (const auto& result : *baselineResults)
+            {
+                baselineNanos[resultKey(result)] = double(result["nsPerSample"]);
+            }
+        }
+        for (auto& result : results)
+        {
+            auto match = baselineNanos.find(resultKey(result));
+            if (match != baselineNanos.end() && match->second > 0.0)
+            {
+                double change = double(result["nsPerSample"]) / match->second;
+                result.getDynamicObject()->setProperty("vsBaseline", change);
+                numRegressions += change > 1.1 ? 1 : 0;
+            }
+        }
+    }
+
+    auto* summary = new juce::DynamicObject();
+    summary->setProperty("input", inputPath.isNotEmpty() ? inputPath : juce::String("synthetic"));
+    summary->setProperty("blocksPerRun", blocksPerRun);
+    summary->setProperty("normalSlowerThanJuceResampler", numSlowerThanJuce);
+    summary->setProperty("results", results);
+    if (baselinePath.isNotEmpty())
+    {
+        summary->setProperty("baseline", baselinePath);
+        summary->setProperty("regressions", numRegressions);
+    }
+    juce::var summaryVar{ summary };
+    if (savePath.isNotEmpty())
+    {
+        juce::File{ savePath }.replaceWithText(juce::JSON::toString(summaryVar));
+    }
+    printResult("dsp", summary);
+    return numRegressions > 0 ? 2 : 0;
+}
+
+int Benchmarks::trackAnalysis(const juce::StringArray& args)
+{
+    juce::File folder{ args[0] };
+    int maxFiles = args.size() > 1 ? args[1].getIntValue() : 50;
+    if (!folder.isDirectory())
+    {
+        std::cerr << "usage: --benchmark analysis <folder> [maxFiles]" << std::endl;
+        return 1;
+    }
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    auto files = findAudioFiles(formatManager, folder, maxFiles);
+    if (files.isEmpty())
+    {
+        std::cerr << "no audio files found in " << folder.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    BeatAnalyser beatAnalyser;
+    KeyAnalyser keyAnalyser;
+    std::vector<double> decodeSeconds, analysisSeconds, keySeconds;
+    double audioSeconds = 0.0;
+    juce::Array<juce::var> tracks;
+    for (const auto& file : files)
+    {
+        std::vector<float> samples;
+        double sampleRate = 0.0;
+        auto start = juce::Time::getHighResolutionTicks();
+        if (!TrackAnalyser::decodeForAnalysis(formatManager, file, samples, sampleRate, [] { return false; }))
+        {
+            continue;
+        }
+        auto decoded = juce::Time::getHighResolutionTicks();
+        auto beats = beatAnalyser.analyse(samples.data(), int(samples.size()), sampleRate);
+        auto beatsFound = juce::Time::getHighResolutionTicks();
+        auto key = keyAnalyser.analyse(samples.data(), int(samples.size()), sampleRate);
+        auto analysed = juce::Time::getHighResolutionTicks();
+
+        decodeSeconds.push_back(juce::Time::highResolutionTicksToSeconds(decoded - start));
+        analysisSeconds.push_back(juce::Time::highResolutionTicksToSeconds(analysed - decoded));
+        keySeconds.push_back(juce::Time::highResolutionTicksToSeconds(analysed - beatsFound));
+        audioSeconds += samples.size() / sampleRate;
+
+        auto* track = new juce::DynamicObject();
+        track->setProperty("file", file.getFileName());
+        track->setProperty("bpm", beats.bpm);
+        track->setProperty("firstDownbeat", beats.firstDownbeat);
+        track->setProperty("key", KeyAnalyser::getCamelot(key.key));
+        tracks.add(juce::var(track));
+    }
+    if (decodeSeconds.empty())
+    {
+        std::cerr << "none of the files could be decoded" << std::endl;
+        return 1;
+    }
+
+    double totalDecode = std::accumulate(decodeSeconds.begin(), decodeSeconds.end(), 0.0);
+    double totalAnalysis = std::accumulate(analysisSeconds.begin(), analysisSeconds.end(), 0.0);
+    double secondsPerTrack = (totalDecode + totalAnalysis) / decodeSeconds.size();
+    auto* result = new juce::DynamicObject();
+    result->setProperty("files", int(decodeSeconds.size()));
+    result->setProperty("decodeSecondsP50", percentile(decodeSeconds, 50.0));
+    result->setProperty("analysisSecondsP50", percentile(analysisSeconds, 50.0));
+    result->setProperty("analysisSecondsP99", percentile(analysisSeconds, 99.0));
+    result->setProperty("keySecondsP50", percentile(keySeconds, 50.0));
+    result->setProperty("audioSecondsPerSecond", audioSeconds / (totalDecode + totalAnalysis));
+    result->setProperty("tracksPerHourPerCore", 3600.0 / secondsPerTrack);
+    result->setProperty("tracks", tracks);
+    printResult("analysis", result);
+    return 0;
+}
+
+int Benchmarks::libraryFile(const juce::StringArray& args)
+{
+    int numTracks = args.size() > 0 ? args[0].getIntValue() : 100000;
+    if (numTracks <= 0)
+    {
+        std::cerr << "usage: --benchmark library [numTracks]" << std::endl;
+        return 1;
+    }
+
+    auto folder = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                      .getNonexistentChildFile("library-benchmark", "", false);
+    folder.createDirectory();
+    auto snapshot = folder.getChildFile("library.djlib");
+
+    // the old playlist format is the quickest way to a snapshot of any size
+    auto playlist = folder.getChildFile("playlist.txt");
+    {
+        juce::MemoryOutputStream text;
+        for (int i = 0; i < numTracks; ++i)
+        {
+            text << "/music/Artist " << i % 997 << "/Album " << i % 13 << "/"
+                 << i << " Track " << i << ".mp3," << 2 + i % 5 << ":" << juce::String(i % 60).paddedLeft('0', 2) << "\n";
+        }
+        playlist.replaceWithText(text.toString());
+        TrackStore store;
+        LibraryFile migrated{ snapshot };
+        migrated.load(playlist, store);
+    }
+
+    std::vector<double> loadSeconds;
+    for (int run = 0; run < 5; ++run)
+    {
+        TrackStore store;
+        LibraryFile library{ snapshot };
+        auto start = juce::Time::getHighResolutionTicks();
+        library.load(juce::File(), store);
+        loadSeconds.push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start));
+    }
+
+    // a compaction should only stall the caller, the message thread, for a
+    // small part of a 60Hz frame however large the library is
+    double compactStallMillis = 0.0, compactSeconds = 0.0;
+    {
+        TrackStore store;
+        LibraryFile library{ snapshot };
+        library.load(juce::File(), store);
+        for (int row = 0; row < juce::jmin(1000, store.size()); ++row)
+        {
+            Track track = store.getTrack(row);
+            track.bpm = 120.0;
+            library.trackAdded(track);
+        }
+        auto start = juce::Time::getHighResolutionTicks();
+        library.compact();
+        auto returned = juce::Time::getHighResolutionTicks();
+        while (library.isCompacting())
+        {
+            juce::Thread::sleep(1);
+        }
+        compactStallMillis = juce::Time::highResolutionTicksToSeconds(returned - start) * 1000.0;
+        compactSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+    }
+    folder.deleteRecursively();
+
+    auto* result = new juce::DynamicObject();
+    result->setProperty("tracks", numTracks);
+    result->setProperty("loadSecondsP50", percentile(loadSeconds, 50.0));
+    result->setProperty("loadSecondsMax", percentile(loadSeconds, 100.0));
+    result->setProperty("loadMicrosecondsPerTrack", percentile(loadSeconds, 50.0) * 1.0e6 / numTracks);
+    result->setProperty("compactStallMillis", compactStallMillis);
+    result->setProperty("compactSeconds", compactSeconds);
+    printResult("library", result);
+    return 0;
+}
+
+int Benchmarks::librarySearch(const juce::StringArray& args)
+{
+    int numTracks = args.size() > 0 ? args[0].getIntValue() : 500000;
+    if (numTracks <= 0)
+    {
+        std::cerr << "usage: --benchmark search [numTracks]" << std::endl;
+        return 1;
+    }
+
+    // titles of two to five common words, so short queries match much of the library
+    const char* const words[] = { "love", "night", "the", "beat", "remix", "a", "in", "my", "heart", "dance",
+                                  "dj", "on", "me", "of", "light", "summer", "club", "mix", "extended", "edit",
+                                  "blue", "deep", "house", "fire", "we", "go", "you", "baby", "star", "dream",
+                                  "city", "feel", "time", "way", "de", "la", "el", "lo", "real", "sound",
+                                  "original", "vip", "bass", "drop", "rise", "sun", "moon", "acid", "techno", "trance" };
+    const int numWords = juce::numElementsInArray(words);
+    juce::Random random{ 1 };
+    SearchIndex index;
+    auto start = juce::Time::getHighResolutionTicks();
+    for (int i = 0; i < numTracks; ++i)
+    {
+        juce::String title;
+        for (int w = 2 + random.nextInt(4); w > 0; --w)
+        {
+            title << words[random.nextInt(numWords)] << " ";
+        }
+        title << random.nextInt(1000);
+        juce::String artist = juce::String("Artist ") + juce::String(random.nextInt(20000)) + " " + words[random.nextInt(numWords)];
+        int key = random.nextInt(KeyAnalyser::numKeys);
+        index.add(juce::uint32(i + 1), title, artist, KeyAnalyser::getCamelot(key) + " " + KeyAnalyser::getKeyName(key));
+    }
+    double buildSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+    // every keystroke searches, so a query has to come back within a millisecond
+    const double targetMicros = 1000.0;
+    bool isWithinTarget = true;
+    auto timeQueries = [&](const juce::StringArray& queries, juce::DynamicObject& result, const juce::String& name)
+    {
+        std::vector<double> micros;
+        double numResults = 0.0;
+        for (const auto& query : queries)
+        {
+            for (int run = 0; run < 20; ++run)
+            {
+                auto queryStart = juce::Time::getHighResolutionTicks();
+                auto found = index.search(query);
+                micros.push_back(ticksToMicroseconds(juce::Time::getHighResolutionTicks() - queryStart));
+                numResults += double(found.size()) / 20.0;
+            }
+        }
+        result.setProperty(name + "MicrosP50", percentile(micros, 50.0));
+        result.setProperty(name + "MicrosP99", percentile(micros, 99.0));
+        result.setProperty(name + "MeanResults", numResults / queries.size());
+        isWithinTarget = isWithinTarget && percentile(micros, 99.0) < targetMicros;
+    };
+
+    auto* result = new juce::DynamicObject();
+    result->setProperty("tracks", numTracks);
+    result->setProperty("buildSeconds", buildSeconds);
+    timeQueries({ "a", "b", "m", "th", "lo", "de", "am", "8a" }, *result, "short");
+    timeQueries({ "love", "night heart", "remix 2", "summer club mix", "techno", "artist 123" }, *result, "long");
+    result->setProperty("targetMicrosP99", targetMicros);
+    result->setProperty("withinTarget", isWithinTarget);
+    printResult("search", result);
+    return isWithinTarget ? 0 : 2;
+}
@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    Benchmarks.h
+    Created: 9 Apr 2023 5:02:44pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Headless benchmarks, run from the command line instead of opening the
+    window:
+
+        DJAPPOtodecks --benchmark <name> [arguments...]
+
+    Results are printed to stdout as JSON.
+*/
+namespace Benchmarks
+{
+    /**Returns true if the command line asks for a benchmark*/
+    bool isBenchmarkCommandLine(const juce::String& commandLine);
+    /**Runs the benchmark named on the command line, returns the exit code*/
+    int run(const juce::String& commandLine);
+
+    /**Header probe against loading each file into a DJAudioPlayer.
+       Arguments: <folder> [maxFiles]*/
+    int metadataProbe(const juce::StringArray& args);
+    /**Streaming reader against a memory-mapped reader for one WAV or AIFF file:
+       time to read it all and latency of random seeks.
+       Arguments: <file> [numSeeks]*/
+    int mappedReader(const juce::StringArray& args);
+    /**Renders a script of deck events to a WAV file as fast as possible and
+       reports the realtime factor. See OfflineRenderer for the script format.
+       Arguments: <script> <output.wav> <seconds> [--decks n]*/
+    int offlineRender(const juce::StringArray& args);
+    /**Cost of each stage of the deck signal chain and of the whole chain, over
+       block sizes 32 to 4096, speeds 0.25 to 4 and with the reverb on and off,
+       of a deck synced to another against one playing free, then of mixing
+       2, 4 and 8 decks on one thread against the deck engine's workers, and
+       of the mix stage on its own with and without the mix bus.
+       Each deck resampler quality is timed against juce::ResamplingAudioSource,
+       and any block size and speed where "normal" is the slower one is counted.
+       Plays a synthetic stereo signal, or a file if one is given. Results can be
+       saved as a baseline and later runs compared against it.
+       Arguments: [file] [--blocks n] [--save baseline.json] [--baseline baseline.json]*/
+    int dspChain(const juce::StringArray& args);
+    /**Decodes and analyses each file the way a track is after import, on one
+       thread, and reports how many tracks an hour one core gets through.
+       Arguments: <folder> [maxFiles]*/
+    int trackAnalysis(const juce::StringArray& args);
+    /**Time to open a synthetic library of the given size from its snapshot,
+       and how long folding a full journal into it stalls the caller.
+       Arguments: [numTracks]*/
+    int libraryFile(const juce::StringArray& args);
+    /**Search latency over a synthetic library, for queries of one or two
+       letters and for longer ones. Exits with 2 if either kind's p99 is a
+       millisecond or more.
+       Arguments: [numTracks]*/
+    int librarySearch(const juce::StringArray& args);
+}
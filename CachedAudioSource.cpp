@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    CachedAudioSource.cpp
+    Created: 11 Jun 2023 1:05:12pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "CachedAudioSource.h"
+
+CachedAudioSource::CachedAudioSource(DecodedAudioCache::AudioPtr _audio) : audio(std::move(_audio))
+{
+}
+
+void CachedAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+}
+
+void CachedAudioSource::releaseResources()
+{
+}
+
+void CachedAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const auto& samples = audio->samples;
+    auto start = position.load();
+    int numAvailable = int(juce::jlimit(juce::int64(0), juce::int64(bufferToFill.numSamples),
+                                        juce::int64(samples.getNumSamples()) - start));
+
+    for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+    {
+        // a mono file is played on every channel
+        int sourceChannel = juce::jmin(channel, samples.getNumChannels() - 1);
+        if (numAvailable > 0)
+        {
+            bufferToFill.buffer->copyFrom(channel, bufferToFill.startSample,
+                                          samples, sourceChannel, int(start), numAvailable);
+        }
+    }
+    if (numAvailable < bufferToFill.numSamples)
+    {
+        bufferToFill.buffer->clear(bufferToFill.startSample + numAvailable,
+                                   bufferToFill.numSamples - numAvailable);
+    }
+    // a seek made while this block was read wins over moving on past it
+    position.compare_exchange_strong(start, start + bufferToFill.numSamples);
+}
+
+void CachedAudioSource::setNextReadPosition(juce::int64 newPosition)
+{
+    position.store(newPosition);
+}
+
+juce::int64 CachedAudioSource::getNextReadPosition() const
+{
+    return position.load();
+}
+
+juce::int64 CachedAudioSource::getTotalLength() const
+{
+    return audio->samples.getNumSamples();
+}
+
+bool CachedAudioSource::isLooping() const
+{
+    return false;
+}
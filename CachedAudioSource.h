@@ -0,0 +1,41 @@
+/*
+  ==============================================================================
+
+    CachedAudioSource.h
+    Created: 11 Jun 2023 1:05:12pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include "DecodedAudioCache.h"
+
+//==============================================================================
+/*
+    Plays a track straight out of the decoded audio cache, so playing and
+    seeking never touch the disk. Holding the audio keeps it in the cache
+    for as long as the deck has it loaded.
+*/
+class CachedAudioSource : public juce::PositionableAudioSource
+{
+    public:
+        CachedAudioSource(DecodedAudioCache::AudioPtr _audio);
+
+        void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+        void releaseResources() override;
+        void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+        void setNextReadPosition(juce::int64 newPosition) override;
+        juce::int64 getNextReadPosition() const override;
+        juce::int64 getTotalLength() const override;
+        bool isLooping() const override;
+
+    private:
+        DecodedAudioCache::AudioPtr audio;
+        std::atomic<juce::int64> position{ 0 };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CachedAudioSource)
+};
@@ -9,15 +9,18 @@
 */
 
 #include "DJAudioPlayer.h"
+#include "CachedAudioSource.h"
 DJAudioPlayer::DJAudioPlayer(juce::AudioFormatManager& _formatManager
                             ) : formatManager(_formatManager)
 {
     //Default reverb settings
-    reverbParameters.roomSize = 0;
-    reverbParameters.damping = 0;
-    reverbParameters.wetLevel = 0;
-    reverbParameters.dryLevel = 1.0;
-    reverbSource.setParameters(reverbParameters);
+    parameters.change([](Parameters& p)
+    {
+        p.reverb.roomSize = 0;
+        p.reverb.damping = 0;
+        p.reverb.wetLevel = 0;
+        p.reverb.dryLevel = 1.0;
+    });
 }
 
 DJAudioPlayer::~DJAudioPlayer()
@@ -26,35 +29,433 @@ DJAudioPlayer::~DJAudioPlayer()
 
 void DJAudioPlayer::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
-    transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    // the transport is prepared once, for whichever of the two reads more at a time
     resampleSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
-    reverbSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    timeStretcher.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    transportInput.prepareToPlay(sampleRate);
+    keyLockFadeBuffer.setSize(2, samplesPerBlockExpected);
+    keyLockFadeRemaining = 0;
+    reverb.setSampleRate(sampleRate);
+    outputSampleRate = sampleRate;
+    samplesRendered = 0;
+    gainSmoother.reset(sampleRate, smoothingSeconds);
+    speedSmoother.reset(sampleRate, smoothingSeconds);
+    sendSmoother.reset(sampleRate, smoothingSeconds);
+
+    // start from the current values rather than gliding to them
+    parameters.pull(audioParameters);
+    applyParameters(audioParameters, true);
 }
 
 void DJAudioPlayer::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    reverbSource.getNextAudioBlock(bufferToFill);
+    // taken first, so a deck that renders past the mix knows its send is too late
+    auto sendBlock = sendBus != nullptr ? sendBus->getBlockNumber() : 0;
+
+    // the only place GUI changes reach the audio thread, once per block
+    if (parameters.pull(audioParameters))
+    {
+        applyParameters(audioParameters, false);
+    }
+    if (audioParameters.sync)
+    {
+        followMaster();
+    }
+    if (audioParameters.keyLock != keyLockActive)
+    {
+        // whichever takes over carries on from where the transport is now,
+        // while the other plays on under it for a frame
+        keyLockActive = audioParameters.keyLock;
+        if (keyLockActive)
+        {
+            timeStretcher.flushBuffers();
+            stretcherInput.catchUp();
+        }
+        else
+        {
+            resampleSource.flushBuffers();
+            resamplerInput.catchUp();
+        }
+        keyLockFadeLength = timeStretcher.getFrameSize();
+        keyLockFadeRemaining = keyLockFadeLength;
+    }
+    if (speedSmoother.isSmoothing())
+    {
+        double speed = speedSmoother.skip(bufferToFill.numSamples);
+        resampleSource.setResamplingRatio(speed);
+        timeStretcher.setTempoRatio(speed);
+    }
+
+    if (keyLockActive)
+    {
+        timeStretcher.getNextAudioBlock(bufferToFill);
+    }
+    else
+    {
+        resampleSource.getNextAudioBlock(bufferToFill);
+    }
+    if (keyLockFadeRemaining > 0)
+    {
+        fadeOutKeyLockPath(bufferToFill);
+    }
+
+    auto& buffer = *bufferToFill.buffer;
+    int start = bufferToFill.startSample;
+    int numSamples = bufferToFill.numSamples;
+
+    // post-fader, so the reverb follows the volume, but taken before the insert
+    // reverb's dry gain so a send comes back as loud as the deck's own reverb would
+    if (sendBus != nullptr && (sendSmoother.isSmoothing() || sendSmoother.getTargetValue() > 0.0f))
+    {
+        auto gainAfterBlock = gainSmoother;
+        float startLevel = sendSmoother.getCurrentValue() * gainSmoother.getCurrentValue();
+        float endLevel = sendSmoother.skip(numSamples) * gainAfterBlock.skip(numSamples);
+        sendBus->addToSend(sendIndex, sendBlock, buffer, start, numSamples, startLevel, endLevel);
+    }
+
+    if (buffer.getNumChannels() > 1)
+    {
+        reverb.processStereo(buffer.getWritePointer(0, start), buffer.getWritePointer(1, start), numSamples);
+    }
+    else if (buffer.getNumChannels() == 1)
+    {
+        reverb.processMono(buffer.getWritePointer(0, start), numSamples);
+    }
+
+    // on the mix bus the gain is applied while mixing, and here only moves along
+    if (mixBus != nullptr)
+    {
+        gainSmoother.skip(numSamples);
+    }
+    else if (gainSmoother.isSmoothing())
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float gain = gainSmoother.getNextValue();
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            {
+                buffer.getWritePointer(channel, start)[i] *= gain;
+            }
+        }
+    }
+    else
+    {
+        buffer.applyGain(start, numSamples, gainSmoother.getTargetValue());
+    }
+
+    samplesRendered += numSamples;
+    playheadSeconds.store(transportSource.getCurrentPosition(), std::memory_order_relaxed);
+    if (beatSync != nullptr)
+    {
+        bool gridFound = hasBeatGrid();
+        beatSync->publish(syncIndex,
+                          samplesRendered,
+                          gridFound ? getBeat() : 0.0,
+                          gridFound ? beatsPerSampleAtUnitSpeed * speedSmoother.getCurrentValue() : 0.0,
+                          transportSource.isPlaying());
+    }
+}
+
+void DJAudioPlayer::fadeOutKeyLockPath(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    // a block bigger than prepared for finishes the switch straight away
+    int numSamples = bufferToFill.numSamples;
+    if (numSamples > keyLockFadeBuffer.getNumSamples())
+    {
+        keyLockFadeRemaining = 0;
+        return;
+    }
+    juce::AudioSourceChannelInfo fadeInfo(&keyLockFadeBuffer, 0, numSamples);
+    if (keyLockActive)
+    {
+        resampleSource.getNextAudioBlock(fadeInfo);
+    }
+    else
+    {
+        timeStretcher.getNextAudioBlock(fadeInfo);
+    }
+
+    auto& buffer = *bufferToFill.buffer;
+    int numFading = juce::jmin(numSamples, keyLockFadeRemaining);
+    float fadeStart = float(keyLockFadeRemaining) / float(keyLockFadeLength);
+    float fadeEnd = float(keyLockFadeRemaining - numFading) / float(keyLockFadeLength);
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+    {
+        int fadeChannel = juce::jmin(channel, 1);
+        buffer.applyGainRamp(channel, bufferToFill.startSample, numFading, 1.0f - fadeStart, 1.0f - fadeEnd);
+        buffer.addFromWithRamp(channel, bufferToFill.startSample, keyLockFadeBuffer.getReadPointer(fadeChannel),
+                               numFading, fadeStart, fadeEnd);
+    }
+    keyLockFadeRemaining -= numFading;
 }
 
 void DJAudioPlayer::releaseResources()
 {
-    transportSource.releaseResources();
     resampleSource.releaseResources();
-    reverbSource.releaseResources();
+    timeStretcher.releaseResources();
+    transportInput.releaseResources();
+    reverb.reset();
 }
 
-void DJAudioPlayer::loadURL(juce::URL audioURL)
+void DJAudioPlayer::applyParameters(const Parameters& newParameters, bool jumpToValues)
+{
+    // when sending, the wet level is the send and the deck's own reverb is skipped
+    auto insertReverb = newParameters.reverb;
+    float sendLevel = 0.0f;
+    if (newParameters.sendToBus && sendBus != nullptr)
+    {
+        // scaled like the reverb's wet gain, so a send sounds like the deck's own reverb
+        sendLevel = insertReverb.wetLevel * 3.0f;
+        insertReverb.wetLevel = 0.0f;
+    }
+    // the reverb smooths its own parameters
+    reverb.setParameters(insertReverb);
+
+    beatsPerSampleAtUnitSpeed = newParameters.beatsPerSecond / outputSampleRate;
+    if (newParameters.beatsPerSecond > 0.0)
+    {
+        samplesPerBeatAtUnitSpeed = 1.0 / beatsPerSampleAtUnitSpeed;
+        phaseCorrectionPerBeat = 1.0 / (phaseLockSeconds * newParameters.beatsPerSecond);
+    }
+    if (!newParameters.sync)
+    {
+        syncedSpeed.store(0.0, std::memory_order_relaxed);
+    }
+    if (jumpToValues)
+    {
+        sendSmoother.setCurrentAndTargetValue(sendLevel);
+        gainSmoother.setCurrentAndTargetValue(newParameters.gain);
+        speedSmoother.setCurrentAndTargetValue(newParameters.speed);
+        resampleSource.setResamplingRatio(newParameters.speed);
+        timeStretcher.setTempoRatio(newParameters.speed);
+    }
+    else
+    {
+        sendSmoother.setTargetValue(sendLevel);
+        gainSmoother.setTargetValue(newParameters.gain);
+        speedSmoother.setTargetValue(newParameters.speed);
+    }
+}
+
+void DJAudioPlayer::followMaster()
+{
+    BeatSync::MasterClock master;
+    if (beatSync == nullptr
+        || !hasBeatGrid()
+        || !beatSync->getMasterClock(syncIndex, samplesRendered, master))
+    {
+        // nothing to follow, so the deck plays at its own speed
+        syncedSpeed.store(0.0, std::memory_order_relaxed);
+        speedSmoother.setTargetValue(audioParameters.speed);
+        return;
+    }
+
+    // the speed that matches the tempo, at half or double time if that's nearer the track's own
+    double speed = master.beatsPerSample * samplesPerBeatAtUnitSpeed;
+    double beatsPerMasterBeat = 1.0;
+    if (speed > juce::MathConstants<double>::sqrt2)
+    {
+        beatsPerMasterBeat = 0.5;
+    }
+    else if (speed < 1.0 / juce::MathConstants<double>::sqrt2)
+    {
+        beatsPerMasterBeat = 2.0;
+    }
+    speed *= beatsPerMasterBeat;
+    syncedSpeed.store(speed, std::memory_order_relaxed);
+
+    if (master.playing && transportSource.isPlaying())
+    {
+        // both beats are at the first sample of this block, so the gap is exact
+        double gap = master.beat * beatsPerMasterBeat - getBeat();
+        gap -= std::floor(gap + 0.5);
+        double nudge = maxPhaseCorrection * speed;
+        speed += juce::jlimit(-nudge, nudge, gap * phaseCorrectionPerBeat);
+    }
+    speedSmoother.setTargetValue(juce::jlimit(0.25, maxSpeed, speed));
+}
+
+bool DJAudioPlayer::hasBeatGrid()
+{
+    return beatsPerSampleAtUnitSpeed > 0.0
+        && audioParameters.gridGeneration == loadedGrid.load(std::memory_order_acquire);
+}
+
+double DJAudioPlayer::getBeat()
+{
+    // the transport has read ahead of what is heard by whatever the playing
+    // path holds, both what it has buffered and what it has still to take
+    double buffered = keyLockActive ? stretcherInput.getSamplesBehind() + timeStretcher.getBufferedInput()
+                                    : resamplerInput.getSamplesBehind() + resampleSource.getBufferedInput();
+    double seconds = transportSource.getCurrentPosition() - buffered / outputSampleRate;
+    return (seconds - audioParameters.firstDownbeat) * audioParameters.beatsPerSecond;
+}
+
+void DJAudioPlayer::loadURL(juce::URL audioURL, double bpm, double firstDownbeat)
 {
     DBG("DJAudioPlayer::loadURL called");
+    if (audioURL.isLocalFile())
+    {
+        // uncompressed files are played straight out of the page cache
+        if (auto mapped = createMappedReader(formatManager, audioURL.getLocalFile()))
+        {
+            DBG("DJAudioPlayer::loadURL playing a memory-mapped file");
+            auto* reader = mapped.get();
+            double sampleRate = mapped->sampleRate;
+            setSource(std::make_unique<juce::AudioFormatReaderSource>(mapped.release(), true), nullptr, sampleRate,
+                      bpm, firstDownbeat);
+            mappedReader = reader;
+            touchMappedAudio(0);
+            // the most a deck can play through in the read-ahead time
+            mappedPager = std::make_unique<MappedAudioPager>(*reader, playheadSeconds, readAheadSeconds * maxSpeed);
+            return;
+        }
+        // a track that is already decoded plays straight from memory
+        if (auto cached = decodedAudio->find(audioURL.getLocalFile()))
+        {
+            DBG("DJAudioPlayer::loadURL playing from the decoded audio cache");
+            loadDecodedAudio(std::move(cached), bpm, firstDownbeat);
+            return;
+        }
+    }
+
     auto* reader = formatManager.createReaderFor(audioURL.createInputStream(false));
     if (reader != nullptr) // good file!
     {
-        std::unique_ptr<juce::AudioFormatReaderSource> newSource(new juce::AudioFormatReaderSource(reader,
-            true));
-        transportSource.setSource(newSource.get(), 0, nullptr, reader->sampleRate);
-        readerSource.reset(newSource.release());
+        // decoding happens on the read-ahead thread, never in the audio callback
+        std::unique_ptr<ReadAheadSource> newSource(new ReadAheadSource(new juce::AudioFormatReaderSource(reader, true),
+                                                                       int(reader->numChannels),
+                                                                       reader->sampleRate,
+                                                                       readAheadSeconds,
+                                                                       maxSpeed));
+        newSource->setPlaybackRatio(parameters.get().speed);
+        auto* readAhead = newSource.get();
+        setSource(std::move(newSource), readAhead, reader->sampleRate, bpm, firstDownbeat);
+
+        // decoded once in the background for the waveforms, analysis and the next load
+        if (audioURL.isLocalFile())
+        {
+            decodedAudio->prefetch(audioURL.getLocalFile(), formatManager);
+        }
+    }
+}
+
+void DJAudioPlayer::loadWithoutReadAhead(const juce::File& file, double bpm, double firstDownbeat)
+{
+    if (auto* reader = formatManager.createReaderFor(file))
+    {
+        double sampleRate = reader->sampleRate;
+        setSource(std::make_unique<juce::AudioFormatReaderSource>(reader, true), nullptr, sampleRate,
+                  bpm, firstDownbeat);
+    }
+}
+
+void DJAudioPlayer::loadDecodedAudio(DecodedAudioCache::AudioPtr audio, double bpm, double firstDownbeat)
+{
+    double sampleRate = audio->sampleRate;
+    setSource(std::make_unique<CachedAudioSource>(std::move(audio)), nullptr, sampleRate, bpm, firstDownbeat);
+}
+
+void DJAudioPlayer::setSource(std::unique_ptr<juce::PositionableAudioSource> newSource,
+                              ReadAheadSource* newReadAhead,
+                              double sampleRate,
+                              double bpm,
+                              double firstDownbeat)
+{
+    if (bpm < 0)
+    {
+        DBG("DJAudioPlayer::setSource bpm should be 0 or more");
+        bpm = 0;
     }
+    // the audio thread only uses the grid once both it and the track have
+    // arrived, so neither track syncs a block against the other's grid
+    juce::uint32 generation = loadedGrid.load(std::memory_order_relaxed) + 1;
+    parameters.change([bpm, firstDownbeat, generation](Parameters& p)
+    {
+        p.beatsPerSecond = bpm / 60.0;
+        p.firstDownbeat = firstDownbeat;
+        p.gridGeneration = generation;
+    });
+    transportSource.setSource(newSource.get(), 0, nullptr, sampleRate);
+    loadedGrid.store(generation, std::memory_order_release);
+    // stops paging the old reader before it is deleted with its source
+    mappedPager.reset();
+    playheadSeconds.store(0.0, std::memory_order_relaxed);
+    // the old source is only deleted once the transport has let go of it
+    deckSource = std::move(newSource);
+    readAheadSource = newReadAhead;
+    mappedReader = nullptr;
 }
+
+std::unique_ptr<juce::MemoryMappedAudioFormatReader> DJAudioPlayer::createMappedReader(juce::AudioFormatManager& formatManager,
+                                                                                        const juce::File& file)
+{
+    // only formats that store plain samples can be mapped, the rest return nullptr
+    auto* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+    if (format == nullptr)
+    {
+        return nullptr;
+    }
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader{ format->createMemoryMappedReader(file) };
+    if (reader == nullptr || !reader->mapEntireFile() || reader->getMappedSection().isEmpty())
+    {
+        return nullptr;
+    }
+    return reader;
+}
+
+void DJAudioPlayer::touchMappedAudio(juce::int64 startSample)
+{
+    if (mappedReader == nullptr)
+    {
+        return;
+    }
+    auto endSample = juce::jmin(mappedReader->lengthInSamples, startSample + juce::int64(mappedReader->sampleRate));
+    // a sample every 256 is at least one in every page
+    for (auto sample = juce::jmax(juce::int64(0), startSample); sample < endSample; sample += 256)
+    {
+        mappedReader->touchSample(sample);
+    }
+}
+
+//==============================================================================
+DJAudioPlayer::MappedAudioPager::MappedAudioPager(const juce::MemoryMappedAudioFormatReader& _reader,
+                                                  const std::atomic<double>& _playheadSeconds,
+                                                  double _readAheadSeconds
+                                                 ) : reader(_reader),
+                                                     playheadSeconds(_playheadSeconds),
+                                                     readAheadSamples(juce::int64(_readAheadSeconds * _reader.sampleRate))
+{
+    decodeThread->addTimeSliceClient(this);
+}
+
+DJAudioPlayer::MappedAudioPager::~MappedAudioPager()
+{
+    // waits for a slice that is running to finish
+    decodeThread->removeTimeSliceClient(this);
+}
+
+int DJAudioPlayer::MappedAudioPager::useTimeSlice()
+{
+    auto playhead = juce::int64(playheadSeconds.load(std::memory_order_relaxed) * reader.sampleRate);
+    // after a seek, start again from the new playhead
+    if (playhead < touchedFrom || playhead > touchedUntil)
+    {
+        touchedUntil = playhead;
+    }
+    touchedFrom = playhead;
+
+    auto endSample = juce::jmin(reader.lengthInSamples, playhead + readAheadSamples);
+    auto sliceEnd = juce::jmin(endSample, touchedUntil + maxSamplesPerSlice);
+    // a sample every 256 is at least one in every page
+    for (auto sample = juce::jmax(juce::int64(0), touchedUntil); sample < sliceEnd; sample += 256)
+    {
+        reader.touchSample(sample);
+    }
+    touchedUntil = juce::jmax(touchedUntil, sliceEnd);
+    return touchedUntil < endSample ? 0 : 20;
+}
+
 void DJAudioPlayer::play()
 {
     transportSource.start();
@@ -65,8 +466,18 @@ void DJAudioPlayer::stop()
     transportSource.stop();
 }
 
+bool DJAudioPlayer::isPlaying()
+{
+    return transportSource.isPlaying();
+}
+
 void DJAudioPlayer::setPosition(double posInSecs)
 {
+    if (mappedReader != nullptr)
+    {
+        touchMappedAudio(juce::int64(posInSecs * mappedReader->sampleRate));
+        playheadSeconds.store(posInSecs, std::memory_order_relaxed);
+    }
     transportSource.setPosition(posInSecs);
 }
 
@@ -89,21 +500,44 @@ void DJAudioPlayer::setGain(double gain)
         DBG("DJAudioPlayer::setGain gain should be between 0 and 1");
     }
     else {
-        transportSource.setGain(gain);
+        parameters.change([gain](Parameters& p) { p.gain = float(gain); });
+        if (mixBus != nullptr)
+        {
+            mixBus->setChannelGain(mixBusChannel, float(gain));
+        }
     }
 }
 
 void DJAudioPlayer::setSpeed(double ratio)
 {
-    if (ratio < 0.25 || ratio > 4.0)
+    if (ratio < 0.25 || ratio > maxSpeed)
     {
         DBG("DJAudioPlayer::setSpeed ratio should be between 0.25 and 4");
     }
     else {
-        resampleSource.setResamplingRatio(ratio);
+        parameters.change([ratio](Parameters& p) { p.speed = ratio; });
+        if (readAheadSource != nullptr)
+        {
+            readAheadSource->setPlaybackRatio(ratio);
+        }
     }
 }
 
+void DJAudioPlayer::setResamplingQuality(PolyphaseResampler::Quality quality)
+{
+    resampleSource.setQuality(quality);
+}
+
+void DJAudioPlayer::setKeyLock(bool shouldLockKey)
+{
+    parameters.change([shouldLockKey](Parameters& p) { p.keyLock = shouldLockKey; });
+}
+
+void DJAudioPlayer::setKeyLockQuality(TimeStretcher::Quality quality)
+{
+    timeStretcher.setQuality(quality);
+}
+
 void DJAudioPlayer::setRoomSize(float size)
 {
     DBG("DJAudioPlayer::setRoomSize called");
@@ -112,8 +546,11 @@ void DJAudioPlayer::setRoomSize(float size)
         DBG("DJAudioPlayer::setRoomSize size should be between 0 and 1.0");
     }
     else {
-        reverbParameters.roomSize = size;
-        reverbSource.setParameters(reverbParameters);
+        parameters.change([size](Parameters& p) { p.reverb.roomSize = size; });
+        if (sendBus != nullptr)
+        {
+            sendBus->setRoomSize(size);
+        }
     }
 }
 
@@ -125,8 +562,11 @@ void DJAudioPlayer::setDamping(float dampingAmt)
         DBG("DJAudioPlayer::setDamping amount should be between 0 and 1.0");
     }
     else {
-        reverbParameters.damping = dampingAmt;
-        reverbSource.setParameters(reverbParameters);
+        parameters.change([dampingAmt](Parameters& p) { p.reverb.damping = dampingAmt; });
+        if (sendBus != nullptr)
+        {
+            sendBus->setDamping(dampingAmt);
+        }
     }
 }
 
@@ -138,8 +578,7 @@ void DJAudioPlayer::setWetLevel(float wetLevel)
         DBG("DJAudioPlayer::setWetLevel level should be between 0 and 1.0");
     }
     else {
-        reverbParameters.wetLevel = wetLevel;
-        reverbSource.setParameters(reverbParameters);
+        parameters.change([wetLevel](Parameters& p) { p.reverb.wetLevel = wetLevel; });
     }
 }
 
@@ -151,11 +590,69 @@ void DJAudioPlayer::setDryLevel(float dryLevel)
         DBG("DJAudioPlayer::setDryLevel level should be between 0 and 1.0");
     }
     else {
-        reverbParameters.dryLevel = dryLevel;
-        reverbSource.setParameters(reverbParameters);
+        parameters.change([dryLevel](Parameters& p) { p.reverb.dryLevel = dryLevel; });
     }
 }
 
+void DJAudioPlayer::setSendBus(SendReverb* bus, int sender)
+{
+    sendBus = bus;
+    sendIndex = sender;
+}
+
+void DJAudioPlayer::setMixBus(MixBus* bus, int channel)
+{
+    mixBus = bus;
+    mixBusChannel = channel;
+    // the volume slider has already set the deck's gain
+    if (mixBus != nullptr)
+    {
+        mixBus->setChannelGain(mixBusChannel, parameters.get().gain);
+    }
+}
+
+void DJAudioPlayer::setBeatSync(BeatSync* sync, int deck)
+{
+    beatSync = sync;
+    syncIndex = deck;
+}
+
+void DJAudioPlayer::setSync(bool shouldSync)
+{
+    parameters.change([shouldSync](Parameters& p) { p.sync = shouldSync; });
+}
+
+void DJAudioPlayer::setSyncMaster(bool shouldLead)
+{
+    if (beatSync == nullptr)
+    {
+        return;
+    }
+    if (shouldLead)
+    {
+        beatSync->setMaster(syncIndex);
+    }
+    else if (isSyncMaster())
+    {
+        beatSync->setMaster(BeatSync::noMaster);
+    }
+}
+
+bool DJAudioPlayer::isSyncMaster()
+{
+    return beatSync != nullptr && beatSync->getMaster() == syncIndex;
+}
+
+double DJAudioPlayer::getSyncedSpeed()
+{
+    return syncedSpeed.load(std::memory_order_relaxed);
+}
+
+void DJAudioPlayer::setReverbSend(bool shouldSend)
+{
+    parameters.change([shouldSend](Parameters& p) { p.sendToBus = shouldSend; });
+}
+
 double DJAudioPlayer::getPositionRelative()
 {
     return transportSource.getCurrentPosition() / transportSource.getLengthInSeconds();
@@ -165,3 +662,34 @@ double DJAudioPlayer::getLengthInSeconds()
 {
     return transportSource.getLengthInSeconds();
 }
+
+void DJAudioPlayer::setReadAheadSeconds(double seconds)
+{
+    if (seconds <= 0)
+    {
+        DBG("DJAudioPlayer::setReadAheadSeconds seconds should be more than 0");
+    }
+    else {
+        readAheadSeconds = seconds;
+    }
+}
+
+int DJAudioPlayer::getNumUnderruns()
+{
+    return readAheadSource != nullptr ? readAheadSource->getNumUnderruns() : 0;
+}
+
+float DJAudioPlayer::getReadAheadFillLevel()
+{
+    return readAheadSource != nullptr ? readAheadSource->getFillLevel() : 0.0f;
+}
+
+DJAudioPlayer::ParameterBatch::ParameterBatch(DJAudioPlayer& _player) : player(_player)
+{
+    player.parameters.beginBatch();
+}
+
+DJAudioPlayer::ParameterBatch::~ParameterBatch()
+{
+    player.parameters.endBatch();
+}
@@ -10,6 +10,16 @@
 
 #pragma once
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "ParameterStore.h"
+#include "ReadAheadSource.h"
+#include "DecodedAudioCache.h"
+#include "PolyphaseResampler.h"
+#include "TimeStretcher.h"
+#include "SharedInput.h"
+#include "StereoReverb.h"
+#include "SendReverb.h"
+#include "MixBus.h"
+#include "BeatSync.h"
 
 class DJAudioPlayer : public juce::AudioSource
 {
@@ -21,18 +31,33 @@ class DJAudioPlayer : public juce::AudioSource
         void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
         void releaseResources() override;
 
-        /**Loads the audio file*/
-        void loadURL(juce::URL audioURL);
+        /**Loads the audio file, with its tempo and first downbeat, which it needs
+           to sync. A bpm of 0 means the track has no beat grid*/
+        void loadURL(juce::URL audioURL, double bpm = 0.0, double firstDownbeat = 0.0);
+        /**Loads a file that is decoded in the audio callback as it plays, with
+           nothing read ahead. Only for rendering offline, where a callback can
+           take as long as it needs*/
+        void loadWithoutReadAhead(const juce::File& file, double bpm = 0.0, double firstDownbeat = 0.0);
+        /**Loads audio that is already decoded, which plays without touching the disk*/
+        void loadDecodedAudio(DecodedAudioCache::AudioPtr audio, double bpm = 0.0, double firstDownbeat = 0.0);
         /**Plays loaded audio file*/
         void play();
         /**Stops playing audio file*/
         void stop();
+        /**Gets whether the audio file is playing*/
+        bool isPlaying();
         /**Sets relative position of audio file*/
         void setPositionRelative(double pos);
         /**Sets the volume*/
         void setGain(double gain);
         /**Sets the speed*/
         void setSpeed(double ratio);
+        /**Sets how closely speed changes are filtered, trading CPU for less aliasing*/
+        void setResamplingQuality(PolyphaseResampler::Quality quality);
+        /**Keeps the pitch where it is when the speed changes*/
+        void setKeyLock(bool shouldLockKey);
+        /**Sets the key lock's frame size, trading latency for smoother sustained notes*/
+        void setKeyLockQuality(TimeStretcher::Quality quality);
         /**Gets relative position of playhead*/
         double getPositionRelative();
         /**Gets the length of transport source in seconds*/
@@ -45,12 +70,173 @@ class DJAudioPlayer : public juce::AudioSource
         void setWetLevel(float wetLevel);
         /**Sets the amount of reverb*/
         void setDryLevel(float dryLevel);
+        /**Gives the deck the mix's shared reverb and its own send on it, before
+           the audio starts*/
+        void setSendBus(SendReverb* bus, int sender);
+        /**Leaves the volume to a channel of the mix bus, which applies it while
+           mixing, before the audio starts. The reverb send still follows it*/
+        void setMixBus(MixBus* bus, int channel);
+        /**Gives the deck the clock the decks sync to and its place on it, before
+           the audio starts*/
+        void setBeatSync(BeatSync* sync, int deck);
+        /**Follows the master deck's tempo and keeps in phase with its beats,
+           in place of the speed set here*/
+        void setSync(bool shouldSync);
+        /**Makes this the deck the others sync to, or leaves no deck leading*/
+        void setSyncMaster(bool shouldLead);
+        bool isSyncMaster();
+        /**Gets the speed that matches the master's tempo, without the small
+           corrections that hold the phase, or 0 while the deck isn't following one*/
+        double getSyncedSpeed();
+        /**Sends to the shared reverb instead of using the deck's own. The wet level
+           becomes the send level and the room is shared with the other decks*/
+        void setReverbSend(bool shouldSend);
+        /**Sets how many seconds of audio are decoded ahead of the playhead at
+           normal speed, from the next file loaded*/
+        void setReadAheadSeconds(double seconds);
+        /**Gets how many times playback ran out of decoded audio*/
+        int getNumUnderruns();
+        /**Gets how full the read-ahead buffer is, from 0 to 1*/
+        float getReadAheadFillLevel();
+        /**Opens a local WAV or AIFF file as a memory-mapped reader. Returns nullptr
+           for compressed formats or if the file can't be mapped*/
+        static std::unique_ptr<juce::MemoryMappedAudioFormatReader> createMappedReader(juce::AudioFormatManager& formatManager,
+                                                                                        const juce::File& file);
+
+        /**Sends every parameter set while it exists to the audio thread in one go*/
+        class ParameterBatch
+        {
+            public:
+                ParameterBatch(DJAudioPlayer& _player);
+                ~ParameterBatch();
+            private:
+                DJAudioPlayer& player;
+        };
+
     private:
+        /**Everything the GUI changes while the deck is playing*/
+        struct Parameters
+        {
+            float gain{ 1.0f };
+            double speed{ 1.0 };
+            bool keyLock{ false };
+            bool sendToBus{ false };
+            bool sync{ false };
+            /**0 without a beat grid*/
+            double beatsPerSecond{ 0.0 };
+            double firstDownbeat{ 0.0 };
+            /**Which load the beat grid belongs to*/
+            juce::uint32 gridGeneration{ 0 };
+            juce::Reverb::Parameters reverb;
+        };
+
         void setPosition(double posInSecs);
+        /**Swaps the transport over to a newly loaded track and its beat grid*/
+        void setSource(std::unique_ptr<juce::PositionableAudioSource> newSource,
+                       ReadAheadSource* newReadAhead,
+                       double sampleRate,
+                       double bpm,
+                       double firstDownbeat);
+        /**Reads a second of a mapped file from the playhead, so the audio thread
+           doesn't wait on the disk for the first pages*/
+        void touchMappedAudio(juce::int64 startSample);
+
+        /**Keeps reading a mapped file's pages a little ahead of the playhead on
+           the read-ahead thread, so the audio thread never waits on the disk
+           for them once it is past the first second*/
+        class MappedAudioPager : private juce::TimeSliceClient
+        {
+            public:
+                MappedAudioPager(const juce::MemoryMappedAudioFormatReader& _reader,
+                                 const std::atomic<double>& _playheadSeconds,
+                                 double _readAheadSeconds);
+                ~MappedAudioPager() override;
+
+            private:
+                int useTimeSlice() override;
+
+                const juce::MemoryMappedAudioFormatReader& reader;
+                const std::atomic<double>& playheadSeconds;
+                juce::int64 readAheadSamples;
+                juce::SharedResourcePointer<ReadAheadSource::DecodeThread> decodeThread;
+                /**Only touched by the read-ahead thread*/
+                juce::int64 touchedFrom{ 0 };
+                juce::int64 touchedUntil{ 0 };
+
+                /**Most samples read in one go, so the other decks' read-ahead isn't held up*/
+                static constexpr int maxSamplesPerSlice = 65536;
+        };
+        /**Audio thread: moves the smoothers and the reverb towards new parameters*/
+        void applyParameters(const Parameters& newParameters, bool jumpToValues);
+        /**Audio thread: mixes in the path key lock switched away from, fading out*/
+        void fadeOutKeyLockPath(const juce::AudioSourceChannelInfo& bufferToFill);
+        /**Audio thread: aims the speed at the master's tempo, nudged to close the
+           gap to its nearest beat*/
+        void followMaster();
+        /**Audio thread: whether the beat grid pulled belongs to the track playing*/
+        bool hasBeatGrid();
+        /**Audio thread: where the audio about to be heard is in the beat grid*/
+        double getBeat();
+
         juce::AudioFormatManager& formatManager;
-        std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
+        juce::SharedResourcePointer<DecodedAudioCache> decodedAudio;
+        std::unique_ptr<juce::PositionableAudioSource> deckSource;
+        /**The deck source when the track is streamed from disk, otherwise nullptr*/
+        ReadAheadSource* readAheadSource{ nullptr };
+        /**The deck's reader when the track is memory-mapped, otherwise nullptr*/
+        juce::MemoryMappedAudioFormatReader* mappedReader{ nullptr };
+        /**Set by the audio thread every block, for the pager to follow*/
+        std::atomic<double> playheadSeconds{ 0.0 };
+        /**Declared after the deck source, so it lets go of the reader first*/
+        std::unique_ptr<MappedAudioPager> mappedPager;
+        double readAheadSeconds{ 1.0 };
+        /**The fastest the speed slider goes, which sets the most read ahead*/
+        static constexpr double maxSpeed = 4.0;
         juce::AudioTransportSource transportSource;
-        juce::ResamplingAudioSource resampleSource{ &transportSource, false, 2 };
-        juce::ReverbAudioSource reverbSource{ &resampleSource, false };
-        juce::Reverb::Parameters reverbParameters;
+        /**The grid generation of the track in the transport, set once it is there*/
+        std::atomic<juce::uint32> loadedGrid{ 0 };
+        /**The resampler and stretcher both read the transport through this,
+           so the one key lock is leaving can play on while it fades out*/
+        SharedInput transportInput{ &transportSource };
+        SharedInput::Reader resamplerInput{ transportInput };
+        SharedInput::Reader stretcherInput{ transportInput };
+        PolyphaseResampler resampleSource{ &resamplerInput };
+        TimeStretcher timeStretcher{ &stretcherInput };
+        /**Audio thread: whether the stretcher rather than the resampler is playing*/
+        bool keyLockActive{ false };
+        /**Audio thread: the path key lock left, faded out over one of the
+           stretcher's frames under the one it switched to*/
+        juce::AudioBuffer<float> keyLockFadeBuffer;
+        int keyLockFadeLength{ 0 };
+        int keyLockFadeRemaining{ 0 };
+        /**Skips its tank while the wet level is 0, which it is when sending*/
+        StereoReverb reverb;
+        SendReverb* sendBus{ nullptr };
+        int sendIndex{ 0 };
+        MixBus* mixBus{ nullptr };
+        int mixBusChannel{ 0 };
+        juce::SmoothedValue<float> sendSmoother;
+        BeatSync* beatSync{ nullptr };
+        int syncIndex{ 0 };
+        /**Audio thread: samples rendered since the audio started, the time on the sync clock*/
+        juce::int64 samplesRendered{ 0 };
+        /**Audio thread: worked out when the beat grid or sample rate changes,
+           so following the master is a handful of multiplies a block*/
+        double beatsPerSampleAtUnitSpeed{ 0.0 };
+        double samplesPerBeatAtUnitSpeed{ 0.0 };
+        double phaseCorrectionPerBeat{ 0.0 };
+        double outputSampleRate{ 44100.0 };
+        std::atomic<double> syncedSpeed{ 0.0 };
+        /**Time taken to close a gap to the master's beat, unless that would
+           need more than the largest nudge to the speed*/
+        static constexpr double phaseLockSeconds = 0.5;
+        static constexpr double maxPhaseCorrection = 0.04;
+
+        ParameterStore<Parameters> parameters;
+        /**The audio thread's copy of the parameters*/
+        Parameters audioParameters;
+        juce::SmoothedValue<float> gainSmoother;
+        juce::SmoothedValue<double> speedSmoother;
+        /**Time taken to glide to a new gain or speed*/
+        static constexpr double smoothingSeconds = 0.02;
 };
@@ -0,0 +1,235 @@
+/*
+  ==============================================================================
+
+    DeckEngine.cpp
+    Created: 30 Jul 2023 11:04:52am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "DeckEngine.h"
+
+//==============================================================================
+DeckEngine::Worker::Worker(DeckEngine& _engine, int index)
+    : juce::Thread("Deck render " + juce::String(index + 1)),
+      engine(_engine)
+{
+}
+
+DeckEngine::Worker::~Worker()
+{
+    signalThreadShouldExit();
+    blockStarted.signal();
+    stopThread(2000);
+}
+
+bool DeckEngine::Worker::start()
+{
+    // the audio thread waits on these, so they run at the same priority
+    return startRealtimeThread(juce::Thread::RealtimeOptions{});
+}
+
+void DeckEngine::Worker::run()
+{
+    // the same as the audio thread, so a deck sounds and costs the same on either
+    juce::ScopedNoDenormals noDenormals;
+    while (!threadShouldExit())
+    {
+        blockStarted.wait(-1);
+        if (threadShouldExit())
+        {
+            return;
+        }
+        engine.renderInputs(engine.currentBlock.load(std::memory_order_acquire));
+    }
+}
+
+//==============================================================================
+DeckEngine::DeckEngine(int _numWorkers)
+{
+    for (int i = 0; i < _numWorkers; ++i)
+    {
+        auto worker = std::make_unique<Worker>(*this, i);
+        if (!worker->start())
+        {
+            // a worker at a lower priority than the audio thread would only hold it up
+            DBG("DeckEngine couldn't start a real-time render thread, the audio thread renders its share");
+            break;
+        }
+        workers.add(worker.release());
+    }
+}
+
+DeckEngine::~DeckEngine()
+{
+    // stops the workers before the inputs they might still be looking at go
+    workers.clear();
+}
+
+void DeckEngine::addInput(juce::AudioSource* input)
+{
+    // the reverb return goes on the channel after the last input
+    jassert(input != nullptr && inputs.size() < MixBus::maxChannels && sendReverb == nullptr);
+    inputs.add(input);
+    buffers.add(new juce::AudioBuffer<float>(2, 0));
+}
+
+void DeckEngine::setSendReverb(SendReverb* reverb)
+{
+    jassert(inputs.size() < MixBus::maxChannels);
+    sendReverb = reverb;
+    mixBus.setChannelSide(inputs.size(), MixBus::Side::thru);
+    mixBus.setChannelGain(inputs.size(), 1.0f);
+}
+
+int DeckEngine::getNumInputs() const
+{
+    return inputs.size();
+}
+
+int DeckEngine::getNumWorkers() const
+{
+    return workers.size();
+}
+
+MixBus& DeckEngine::getMixBus()
+{
+    return mixBus;
+}
+
+int DeckEngine::getNumLateInputs() const
+{
+    return numLateInputs.load(std::memory_order_relaxed);
+}
+
+void DeckEngine::prepareToPlay(int samplesPerBlockExpected, double newSampleRate)
+{
+    maxBlockSize = juce::jmax(1, samplesPerBlockExpected);
+    sampleRate = newSampleRate;
+    mixBus.prepareToPlay(sampleRate);
+    silence.setSize(2, maxBlockSize);
+    silence.clear();
+    for (int i = 0; i < inputs.size(); ++i)
+    {
+        buffers[i]->setSize(2, maxBlockSize);
+        inputs[i]->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    }
+}
+
+void DeckEngine::releaseResources()
+{
+    for (auto* input : inputs)
+    {
+        input->releaseResources();
+    }
+}
+
+void DeckEngine::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    auto seconds = bufferToFill.numSamples * maxWaitFraction / sampleRate;
+    auto deadline = juce::Time::getHighResolutionTicks() + juce::Time::secondsToHighResolutionTicks(seconds);
+
+    // only when the device gives a longer block than it said it would
+    for (int done = 0; done < bufferToFill.numSamples; done += maxBlockSize)
+    {
+        int numSamples = juce::jmin(maxBlockSize, bufferToFill.numSamples - done);
+        juce::AudioSourceChannelInfo part(bufferToFill.buffer, bufferToFill.startSample + done, numSamples);
+        renderBlock(part, deadline);
+    }
+}
+
+void DeckEngine::renderBlock(const juce::AudioSourceChannelInfo& bufferToFill, juce::int64 deadline)
+{
+    int numInputs = inputs.size();
+    if (++blockNumber == 0)
+    {
+        ++blockNumber;
+    }
+    auto block = (juce::uint64(blockNumber) << 32) | juce::uint32(bufferToFill.numSamples);
+    currentBlock.store(block, std::memory_order_release);
+
+    // a worker still waking from the last block finds nothing left and goes back to sleep
+    for (int i = 0; i < juce::jmin(workers.size(), numInputs - 1); ++i)
+    {
+        workers.getUnchecked(i)->blockStarted.signal();
+    }
+    renderInputs(block);
+
+    // the last inputs are nearly done, and sleeping could miss the deadline.
+    // Anything a worker was still busy with from before is rendered here once it's free
+    for (;;)
+    {
+        bool allFinished = true;
+        for (int input = 0; input < numInputs; ++input)
+        {
+            if (states[size_t(input)].finished.load(std::memory_order_acquire) == blockNumber)
+            {
+                continue;
+            }
+            if (claim(input, blockNumber))
+            {
+                render(input, blockNumber, bufferToFill.numSamples);
+            }
+            else
+            {
+                allFinished = false;
+            }
+        }
+        if (allFinished || juce::Time::getHighResolutionTicks() > deadline)
+        {
+            break;
+        }
+    }
+
+    int numChannels = numInputs;
+    for (int input = 0; input < numInputs; ++input)
+    {
+        bool finished = states[size_t(input)].finished.load(std::memory_order_acquire) == blockNumber;
+        mixInputs[size_t(input)] = finished ? buffers.getUnchecked(input) : &silence;
+        if (!finished)
+        {
+            numLateInputs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    // the inputs have sent to the reverb by now, so what comes back goes through the master gain with them
+    if (sendReverb != nullptr)
+    {
+        auto* wet = sendReverb->processReturn(bufferToFill.numSamples);
+        mixInputs[size_t(numChannels++)] = wet != nullptr ? wet : &silence;
+    }
+    mixBus.process(bufferToFill, mixInputs.data(), numChannels);
+}
+
+void DeckEngine::renderInputs(juce::uint64 block)
+{
+    auto number = juce::uint32(block >> 32);
+    int numSamples = int(block & 0xffffffff);
+    for (int input = 0; input < inputs.size(); ++input)
+    {
+        if (claim(input, number))
+        {
+            render(input, number, numSamples);
+        }
+    }
+}
+
+bool DeckEngine::claim(int input, juce::uint32 number)
+{
+    auto& state = states[size_t(input)];
+    auto claimed = state.claimed.load(std::memory_order_acquire);
+    // a worker that slept through a whole block never takes an input back from a newer one
+    bool alreadyTaken = juce::int32(number - claimed) <= 0;
+    if (alreadyTaken || state.finished.load(std::memory_order_acquire) != claimed)
+    {
+        return false;
+    }
+    return state.claimed.compare_exchange_strong(claimed, number, std::memory_order_acq_rel);
+}
+
+void DeckEngine::render(int input, juce::uint32 number, int numSamples)
+{
+    juce::AudioSourceChannelInfo info(buffers.getUnchecked(input), 0, numSamples);
+    inputs.getUnchecked(input)->getNextAudioBlock(info);
+    states[size_t(input)].finished.store(number, std::memory_order_release);
+}
@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    DeckEngine.h
+    Created: 30 Jul 2023 11:04:52am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include "MixBus.h"
+#include "SendReverb.h"
+
+//==============================================================================
+/*
+    Mixes any number of decks and sampler voices, rendering them in parallel
+    so the number that fits in a callback grows with the number of cores.
+
+    Each block the audio thread wakes a pool of real-time worker threads and
+    they all claim inputs that no other thread has taken, each input rendering
+    into its own buffer. The audio thread renders too rather than sitting
+    idle, then waits for the rest, and the mix bus sums the buffers straight
+    into the output with each channel's gain. Waking a worker signals a
+    WaitableEvent, which holds its mutex for a moment, but nothing is locked
+    while rendering and nothing is allocated. A block longer than the one
+    the engine was prepared for is rendered in parts.
+
+    The audio thread only waits for most of a block. An input a worker took
+    but hasn't finished by then is left out of the block, and can't be
+    taken again until that worker is done with it. A worker that couldn't
+    be started as a real-time thread is left out, and the audio thread
+    renders its share.
+
+    Inputs are added before the audio starts and are rendered by whichever
+    thread gets to them, but never by two threads at once.
+*/
+class DeckEngine : public juce::AudioSource
+{
+    public:
+        /**With no workers every input is rendered on the audio thread*/
+        DeckEngine(int _numWorkers);
+        ~DeckEngine() override;
+
+        /**Message thread, before the audio starts: adds a deck or voice to the mix*/
+        void addInput(juce::AudioSource* input);
+        /**Message thread, after the inputs are added: mixes the shared reverb's
+           return in on the channel after them, on neither side of the crossfader,
+           so the master gain turns it down with the decks*/
+        void setSendReverb(SendReverb* reverb);
+        int getNumInputs() const;
+        int getNumWorkers() const;
+        /**Input n is on channel n of the bus*/
+        MixBus& getMixBus();
+        /**Times an input wasn't ready in time and was left out of a block*/
+        int getNumLateInputs() const;
+
+        void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+        void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+        void releaseResources() override;
+
+    private:
+        /**Sleeps until a block starts, then helps render it*/
+        class Worker : public juce::Thread
+        {
+            public:
+                Worker(DeckEngine& _engine, int index);
+                ~Worker() override;
+
+                /**Returns false if it couldn't be started as a real-time thread*/
+                bool start();
+                void run() override;
+
+                juce::WaitableEvent blockStarted;
+
+            private:
+                DeckEngine& engine;
+
+                JUCE_DECLARE_NON_COPYABLE (Worker)
+        };
+
+        /**Which block an input was last taken for and last finished. They only
+           differ while a thread is rendering it*/
+        struct InputState
+        {
+            std::atomic<juce::uint32> claimed{ 0 };
+            std::atomic<juce::uint32> finished{ 0 };
+        };
+
+        /**Audio thread: renders and mixes a block no longer than the prepared size*/
+        void renderBlock(const juce::AudioSourceChannelInfo& bufferToFill, juce::int64 deadline);
+        /**Renders every input that no other thread has taken for the block*/
+        void renderInputs(juce::uint64 block);
+        /**Takes an input for a block, unless it has been taken for that block or a
+           later one, or is still being rendered*/
+        bool claim(int input, juce::uint32 number);
+        void render(int input, juce::uint32 number, int numSamples);
+
+        juce::Array<juce::AudioSource*> inputs;
+        juce::OwnedArray<juce::AudioBuffer<float>> buffers;
+        std::array<InputState, MixBus::maxChannels> states;
+        /**Audio thread: what the mix bus sums, the silence standing in for a late input*/
+        std::array<juce::AudioBuffer<float>*, MixBus::maxChannels> mixInputs{};
+        juce::AudioBuffer<float> silence;
+        juce::OwnedArray<Worker> workers;
+        MixBus mixBus;
+        SendReverb* sendReverb{ nullptr };
+
+        int maxBlockSize{ 0 };
+        double sampleRate{ 44100.0 };
+        /**Audio thread: counts blocks from 1, as 0 is every input's state before the first*/
+        juce::uint32 blockNumber{ 0 };
+        /**The block being rendered in the top half and its length in the bottom,
+           so a worker always sees the two together*/
+        std::atomic<juce::uint64> currentBlock{ 0 };
+        std::atomic<int> numLateInputs{ 0 };
+        /**How much of a block the audio thread waits for the workers*/
+        static constexpr double maxWaitFraction = 0.75;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckEngine)
+};
@@ -15,15 +15,19 @@
 DeckGUI::DeckGUI(int _id,
                  DJAudioPlayer* _player,
                  juce::AudioFormatManager& formatManager,
-                 juce::AudioThumbnailCache& thumbCache
+                 PeakCache& thumbCache
                 ) : player(_player),
                     id(_id),
-                    waveformDisplay(id, formatManager, thumbCache)
+                    waveformDisplay(id, formatManager, thumbCache),
+                    zoomedWaveform(formatManager, thumbCache)
 {
     // add all components and make visible
     addAndMakeVisible(playButton);
     addAndMakeVisible(stopButton);
     addAndMakeVisible(loadButton);
+    addAndMakeVisible(keyLockButton);
+    addAndMakeVisible(syncButton);
+    addAndMakeVisible(masterButton);
     addAndMakeVisible(volSlider);
     addAndMakeVisible(volLabel);
     addAndMakeVisible(speedSlider);
@@ -33,11 +37,15 @@ DeckGUI::DeckGUI(int _id,
     addAndMakeVisible(reverbPlot1);
     addAndMakeVisible(reverbPlot2);
     addAndMakeVisible(waveformDisplay);
+    addAndMakeVisible(zoomedWaveform);
 
     // add listeners
     playButton.addListener(this);
     stopButton.addListener(this);
     loadButton.addListener(this);
+    keyLockButton.addListener(this);
+    syncButton.addListener(this);
+    masterButton.addListener(this);
     volSlider.addListener(this);
     speedSlider.addListener(this);
     posSlider.addListener(this);
@@ -51,6 +59,15 @@ DeckGUI::DeckGUI(int _id,
     playButton.setColour(juce::TextButton::ColourIds::buttonColourId, colour1.interpolatedWith(colour2, 0.5f));
     stopButton.setColour(juce::TextButton::ColourIds::buttonColourId, colour1.interpolatedWith(colour2, 0.5f));
     loadButton.setColour(juce::TextButton::ColourIds::buttonColourId, colour1.interpolatedWith(colour2, 0.5f));
+    keyLockButton.setColour(juce::TextButton::ColourIds::buttonColourId, colour1.interpolatedWith(colour2, 0.5f));
+    keyLockButton.setClickingTogglesState(true);
+    keyLockButton.setTooltip("Keep the pitch when the speed changes");
+    syncButton.setColour(juce::TextButton::ColourIds::buttonColourId, colour1.interpolatedWith(colour2, 0.5f));
+    syncButton.setClickingTogglesState(true);
+    syncButton.setTooltip("Follow the master deck's tempo and beats. Needs a track analysed in the library");
+    masterButton.setColour(juce::TextButton::ColourIds::buttonColourId, colour1.interpolatedWith(colour2, 0.5f));
+    masterButton.setClickingTogglesState(true);
+    masterButton.setTooltip("The deck the synced decks follow");
     //configure volume slider and label
     double volDefaultValue = 0.5;
     volSlider.setRange(0.0, 1.0);
@@ -99,9 +116,10 @@ DeckGUI::DeckGUI(int _id,
 
     //configure reverb plots
     reverbPlot1.setTooltip("x: damping\ny: room size");
-    reverbPlot2.setTooltip("x: dry level\ny: wet level");
+    reverbPlot2.setTooltip("x: dry level\ny: wet level, or the send with the shared reverb");
 
-    startTimer(500);
+    // fast enough for the zoomed waveform to scroll smoothly
+    startTimerHz(30);
 }
 
 DeckGUI::~DeckGUI()
@@ -133,9 +151,12 @@ void DeckGUI::resized()
     auto plotRight = getWidth() - mainRight; // should == getHeight() / 2
 
     //                   x start, y start, width, height
-    playButton.setBounds(0, 0, mainRight / 3, getHeight() / 8);
-    stopButton.setBounds(mainRight / 3, 0, mainRight / 3, getHeight() / 8);
-    loadButton.setBounds(2 * mainRight / 3, 0, mainRight / 3, getHeight() / 8);
+    playButton.setBounds(0, 0, mainRight / 6, getHeight() / 8);
+    stopButton.setBounds(mainRight / 6, 0, mainRight / 6, getHeight() / 8);
+    loadButton.setBounds(2 * mainRight / 6, 0, mainRight / 6, getHeight() / 8);
+    keyLockButton.setBounds(3 * mainRight / 6, 0, mainRight / 6, getHeight() / 8);
+    syncButton.setBounds(4 * mainRight / 6, 0, mainRight / 6, getHeight() / 8);
+    masterButton.setBounds(5 * mainRight / 6, 0, mainRight / 6, getHeight() / 8);
  
     volSlider.setBounds(-80, getHeight()/7, getWidth()/2, getHeight()/7*3);
     volLabel.setCentreRelative(0.34f, 0.38f);
@@ -148,7 +169,8 @@ void DeckGUI::resized()
     
     reverbPlot1.setBounds(mainRight, 0, plotRight, getHeight() / 2);
     reverbPlot2.setBounds(mainRight, getHeight()/2, plotRight, getHeight() / 2);
-    waveformDisplay.setBounds(0, 4 * getHeight() / 8, mainRight, 4 * getHeight() / 8);
+    zoomedWaveform.setBounds(0, 4 * getHeight() / 8, mainRight, 2 * getHeight() / 8);
+    waveformDisplay.setBounds(0, 6 * getHeight() / 8, mainRight, 2 * getHeight() / 8);
 }
 
 void DeckGUI::buttonClicked(juce::Button* button)
@@ -171,13 +193,27 @@ void DeckGUI::buttonClicked(juce::Button* button)
         juce::FileBrowserComponent::canSelectFiles;
         fChooser.launchAsync(fileChooserFlags, [this](const juce::FileChooser& chooser)
         {
-            player->loadURL(juce::URL{chooser.getResult()});
-            // and now the waveformDisplay as well
-            waveformDisplay.loadURL(juce::URL{chooser.getResult()});
+            // the player and both waveforms
+            loadOutsideFile(chooser.getResult());
             DBG(juce::URL{ chooser.getResult() }.getFileName());
             
         });
     }
+    if (button == &keyLockButton)
+    {
+        DBG("Key lock button was clicked ");
+        player->setKeyLock(keyLockButton.getToggleState());
+    }
+    if (button == &syncButton)
+    {
+        DBG("Sync button was clicked ");
+        player->setSync(syncButton.getToggleState());
+    }
+    if (button == &masterButton)
+    {
+        DBG("Master button was clicked ");
+        player->setSyncMaster(masterButton.getToggleState());
+    }
 }
 
 
@@ -203,6 +239,8 @@ void DeckGUI::sliderValueChanged(juce::Slider* slider)
 void DeckGUI::coordPlotValueChanged(CoordinatePlot* coordinatePlot)
 {
     DBG("DeckGUI::coordPlotValueChanged called");
+    // both values of a plot reach the audio thread together
+    DJAudioPlayer::ParameterBatch batch{ *player };
     if (coordinatePlot == &reverbPlot1)
     {
         DBG("Deck " << id << ": ReverbPlot1 was clicked");
@@ -229,17 +267,34 @@ void DeckGUI::filesDropped(const juce::StringArray& files, int x, int y)
 
     DBG("DeckGUI::filesDropped at " + std::to_string(x)
         + "x and " + std::to_string(y) + "y" );
-    if (files.size() == 1)
+    if (files.size() == 1 && juce::File{ files[0] }.existsAsFile())
+    {
+        loadOutsideFile(juce::File{ files[0] });
+    }
+    else if (onImportFiles != nullptr)
     {
-        loadFile(juce::URL{ juce::File{files[0]} });
+        // several files or folders go to the library instead
+        onImportFiles(files);
     }
 }
 
-void DeckGUI::loadFile(juce::URL audioURL)
+void DeckGUI::loadFile(juce::URL audioURL, double bpm, double firstDownbeat)
 {
     DBG("DeckGUI::loadFile called");
-    player->loadURL(audioURL);
+    player->loadURL(audioURL, bpm, firstDownbeat);
     waveformDisplay.loadURL(audioURL);
+    zoomedWaveform.loadURL(audioURL);
+}
+
+void DeckGUI::loadOutsideFile(const juce::File& file)
+{
+    double bpm = 0.0;
+    double firstDownbeat = 0.0;
+    if (findBeatGrid != nullptr)
+    {
+        findBeatGrid(file, bpm, firstDownbeat);
+    }
+    loadFile(juce::URL{ file }, bpm, firstDownbeat);
 }
 
 void DeckGUI::timerCallback()
@@ -249,5 +304,16 @@ void DeckGUI::timerCallback()
     if (player->getPositionRelative() > 0)
     {
         waveformDisplay.setPositionRelative(player->getPositionRelative());
+        zoomedWaveform.setPositionRelative(player->getPositionRelative());
+    }
+
+    // another deck may have taken over as master
+    masterButton.setToggleState(player->isSyncMaster(), juce::dontSendNotification);
+    // the slider follows the synced tempo, so the deck keeps it when sync is turned off
+    double syncedSpeed = player->getSyncedSpeed();
+    if (syncButton.getToggleState() && syncedSpeed > 0.0
+        && std::abs(syncedSpeed - speedSlider.getValue()) > 0.001)
+    {
+        speedSlider.setValue(syncedSpeed);
     }
 }
@@ -13,6 +13,8 @@
 #include <JuceHeader.h>
 #include "DJAudioPlayer.h"
 #include "WaveformDisplay.h"
+#include "ZoomedWaveform.h"
+#include "PeakCache.h"
 #include "CoordinatePlot.h"
 
 //==============================================================================
@@ -29,7 +31,7 @@ public:
     DeckGUI(int _id,
             DJAudioPlayer* player,
             juce::AudioFormatManager& formatManager,
-            juce::AudioThumbnailCache& thumbCache);
+            PeakCache& thumbCache);
     ~DeckGUI() override;
 
     void paint (juce::Graphics&) override;
@@ -48,12 +50,21 @@ public:
     /**Listen for changes to the waveform*/
     void timerCallback() override;
 
+    /**Called with the files when several files or a folder are dropped on the deck*/
+    std::function<void(const juce::StringArray& files)> onImportFiles;
+    /**Looks up the beat grid the library has for a file loaded from outside it.
+       Returns false if the library has none*/
+    std::function<bool(const juce::File& file, double& bpm, double& firstDownbeat)> findBeatGrid;
+
 private:
     int id;
     
     juce::TextButton playButton{ "PLAY" };
     juce::TextButton stopButton{ "STOP" };
     juce::TextButton loadButton{ "LOAD" };
+    juce::TextButton keyLockButton{ "KEY LOCK" };
+    juce::TextButton syncButton{ "SYNC" };
+    juce::TextButton masterButton{ "MASTER" };
     juce::Slider volSlider;
     juce::Label volLabel;
     juce::Slider speedSlider;
@@ -65,10 +76,16 @@ private:
     CoordinatePlot reverbPlot2;
 
     juce::FileChooser fChooser{"Select a file..."};
-    void loadFile(juce::URL audioURL);
+    /**Loads the player and both waveforms. A bpm of 0 means the track has no
+       beat grid, and can't sync*/
+    void loadFile(juce::URL audioURL, double bpm = 0.0, double firstDownbeat = 0.0);
+    /**Loads a file chosen or dropped on the deck, with its beat grid if it is
+       in the library*/
+    void loadOutsideFile(const juce::File& file);
 
     DJAudioPlayer* player;
     WaveformDisplay waveformDisplay;
+    ZoomedWaveform zoomedWaveform;
     juce::SharedResourcePointer< juce::TooltipWindow > sharedTooltip;
 
     friend class PlaylistComponent;
@@ -0,0 +1,162 @@
+/*
+  ==============================================================================
+
+    DecodedAudioCache.cpp
+    Created: 11 Jun 2023 10:48:26am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "DecodedAudioCache.h"
+#include "FileIdentity.h"
+
+//==============================================================================
+DecodedAudioCache::DecodedAudioCache() : memoryBudget(size_t(1024) * 1024 * 1024)
+{
+}
+
+DecodedAudioCache::~DecodedAudioCache()
+{
+    prefetchPool.removeAllJobs(true, 10000);
+}
+
+DecodedAudioCache::AudioPtr DecodedAudioCache::getOrDecode(const juce::File& file,
+                                                           juce::AudioFormatManager& formatManager)
+{
+    juce::String key = makeKey(file);
+    std::promise<AudioPtr> promise;
+    std::shared_future<AudioPtr> audio;
+    size_t budget;
+    {
+        const juce::ScopedLock sl(lock);
+        budget = memoryBudget;
+        auto it = entries.find(key);
+        if (it != entries.end())
+        {
+            // either already decoded or being decoded by another thread
+            it->second.lastUsed = ++useCounter;
+            audio = it->second.audio;
+        }
+        else
+        {
+            Entry& entry = entries[key];
+            entry.audio = promise.get_future().share();
+            entry.lastUsed = ++useCounter;
+        }
+    }
+    if (audio.valid())
+    {
+        return audio.get();
+    }
+
+    AudioPtr decoded = decode(file, formatManager, budget);
+    promise.set_value(decoded);
+
+    const juce::ScopedLock sl(lock);
+    if (decoded == nullptr)
+    {
+        entries.erase(key);
+        return nullptr;
+    }
+    auto& entry = entries[key];
+    entry.bytes = size_t(decoded->samples.getNumChannels()) * size_t(decoded->samples.getNumSamples()) * sizeof(float);
+    memoryUsed += entry.bytes;
+    evict();
+    return decoded;
+}
+
+DecodedAudioCache::AudioPtr DecodedAudioCache::find(const juce::File& file)
+{
+    juce::String key = makeKey(file);
+    const juce::ScopedLock sl(lock);
+    auto it = entries.find(key);
+    if (it == entries.end() || it->second.bytes == 0)
+    {
+        return nullptr;
+    }
+    it->second.lastUsed = ++useCounter;
+    return it->second.audio.get();
+}
+
+void DecodedAudioCache::prefetch(const juce::File& file, juce::AudioFormatManager& formatManager)
+{
+    prefetchPool.addJob([this, file, &formatManager]
+    {
+        getOrDecode(file, formatManager);
+    });
+}
+
+void DecodedAudioCache::setMemoryBudget(size_t bytes)
+{
+    const juce::ScopedLock sl(lock);
+    memoryBudget = bytes;
+    evict();
+}
+
+size_t DecodedAudioCache::getMemoryUsed() const
+{
+    const juce::ScopedLock sl(lock);
+    return memoryUsed;
+}
+
+juce::String DecodedAudioCache::makeKey(const juce::File& file)
+{
+    FileIdentity identity = FileIdentity::read(file, false);
+    return identity.path + "|" + juce::String(identity.size) + "|" + juce::String(identity.modificationTime);
+}
+
+DecodedAudioCache::AudioPtr DecodedAudioCache::decode(const juce::File& file,
+                                                      juce::AudioFormatManager& formatManager,
+                                                      size_t budget)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader{ formatManager.createReaderFor(file) };
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->lengthInSamples > std::numeric_limits<int>::max())
+    {
+        return nullptr;
+    }
+
+    // a track bigger than the whole budget would only push everything else out
+    auto bytes = juce::uint64(reader->numChannels) * juce::uint64(reader->lengthInSamples) * sizeof(float);
+    if (bytes > budget)
+    {
+        DBG("DecodedAudioCache::decode " << file.getFileName() << " is too big to cache");
+        return nullptr;
+    }
+
+    auto audio = std::make_shared<DecodedAudio>();
+    audio->sampleRate = reader->sampleRate;
+    audio->samples.setSize(int(reader->numChannels), int(reader->lengthInSamples));
+    if (!reader->read(&audio->samples, 0, int(reader->lengthInSamples), 0, true, true))
+    {
+        return nullptr;
+    }
+    DBG("DecodedAudioCache::decode " << file.getFileName() << " (" << int(bytes / (1024 * 1024)) << " MB)");
+    return audio;
+}
+
+void DecodedAudioCache::evict()
+{
+    while (memoryUsed > memoryBudget)
+    {
+        auto oldest = entries.end();
+        for (auto it = entries.begin(); it != entries.end(); ++it)
+        {
+            // still decoding, or held by a deck or a job
+            if (it->second.bytes == 0 || it->second.audio.get().use_count() > 1)
+            {
+                continue;
+            }
+            if (oldest == entries.end() || it->second.lastUsed < oldest->second.lastUsed)
+            {
+                oldest = it;
+            }
+        }
+        if (oldest == entries.end())
+        {
+            return;
+        }
+        memoryUsed -= oldest->second.bytes;
+        entries.erase(oldest);
+    }
+}
@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    DecodedAudioCache.h
+    Created: 11 Jun 2023 10:48:26am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <future>
+#include <memory>
+#include <unordered_map>
+
+//==============================================================================
+/*
+    Decoded audio shared by everything in the app that needs a track's
+    samples: the decks, the waveforms and the analysis jobs. Each file is
+    decoded once however many of them ask for it at the same time.
+
+    Audio stays cached until the cache is over its memory budget, and then
+    the least recently used tracks go first. A track is never dropped while
+    something still holds it.
+
+    Use it through juce::SharedResourcePointer so there is one per app.
+*/
+class DecodedAudioCache
+{
+    public:
+        /**A whole decoded file*/
+        struct DecodedAudio
+        {
+            juce::AudioBuffer<float> samples;
+            double sampleRate{ 0.0 };
+        };
+        using AudioPtr = std::shared_ptr<const DecodedAudio>;
+
+        DecodedAudioCache();
+        ~DecodedAudioCache();
+
+        /**Gets a file's audio, decoding it if it isn't cached. This blocks until
+           it is decoded, so don't call it on the message or audio thread.
+           Returns nullptr if the file can't be read or wouldn't fit in the budget*/
+        AudioPtr getOrDecode(const juce::File& file, juce::AudioFormatManager& formatManager);
+        /**Gets a file's audio only if it is already decoded*/
+        AudioPtr find(const juce::File& file);
+        /**Starts decoding a file in the background so it is cached for later*/
+        void prefetch(const juce::File& file, juce::AudioFormatManager& formatManager);
+
+        /**Sets how many bytes of audio to keep, dropping tracks if it is already over*/
+        void setMemoryBudget(size_t bytes);
+        size_t getMemoryUsed() const;
+
+    private:
+        struct Entry
+        {
+            std::shared_future<AudioPtr> audio;
+            size_t bytes{ 0 };
+            juce::uint64 lastUsed{ 0 };
+        };
+
+        /**Path, size and modification time, so an edited file isn't served stale audio*/
+        static juce::String makeKey(const juce::File& file);
+        static AudioPtr decode(const juce::File& file, juce::AudioFormatManager& formatManager, size_t budget);
+        /**Drops the least recently used tracks nobody else holds until it is within budget*/
+        void evict();
+
+        juce::CriticalSection lock;
+        std::unordered_map<juce::String, Entry> entries;
+        size_t memoryBudget;
+        size_t memoryUsed{ 0 };
+        juce::uint64 useCounter{ 0 };
+
+        juce::ThreadPool prefetchPool{ 1 };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DecodedAudioCache)
+};
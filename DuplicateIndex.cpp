@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    DuplicateIndex.cpp
+    Created: 30 Apr 2023 10:41:52am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "DuplicateIndex.h"
+
+DuplicateIndex::DuplicateIndex()
+{
+}
+
+void DuplicateIndex::add(juce::uint32 trackId, const FileIdentity& identity)
+{
+    byPath[identity.path] = { trackId, identity.size, identity.modificationTime };
+    if (identity.contentHash != 0)
+    {
+        byContent[contentKey(identity)] = trackId;
+    }
+}
+
+void DuplicateIndex::remove(juce::uint32 trackId, const FileIdentity& identity)
+{
+    auto path = byPath.find(identity.path);
+    if (path != byPath.end() && path->second.trackId == trackId)
+    {
+        byPath.erase(path);
+    }
+    if (identity.contentHash != 0)
+    {
+        auto content = byContent.find(contentKey(identity));
+        if (content != byContent.end() && content->second == trackId)
+        {
+            byContent.erase(content);
+        }
+    }
+}
+
+void DuplicateIndex::clear()
+{
+    byPath.clear();
+    byContent.clear();
+}
+
+DuplicateIndex::Result DuplicateIndex::find(const FileIdentity& identity) const
+{
+    auto path = byPath.find(identity.path);
+    if (path != byPath.end())
+    {
+        const PathEntry& entry = path->second;
+        // tracks saved before identities were stored have no size or time to compare
+        bool isKnown = entry.size != 0 && identity.size != 0;
+        bool hasChanged = isKnown && (entry.size != identity.size
+                                      || entry.modificationTime != identity.modificationTime);
+        return { hasChanged ? Match::changedFile : Match::sameFile, entry.trackId };
+    }
+
+    if (identity.contentHash != 0)
+    {
+        auto content = byContent.find(contentKey(identity));
+        if (content != byContent.end())
+        {
+            return { Match::sameContent, content->second };
+        }
+    }
+    return { Match::none, 0 };
+}
+
+juce::uint64 DuplicateIndex::contentKey(const FileIdentity& identity)
+{
+    // the hash already covers the size, mixing it in again guards against
+    // two hashes colliding between files of different lengths
+    return identity.contentHash ^ (juce::uint64(identity.size) * 0x9e3779b97f4a7c15ull);
+}
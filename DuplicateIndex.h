@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    DuplicateIndex.h
+    Created: 30 Apr 2023 10:41:52am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <unordered_map>
+#include "FileIdentity.h"
+
+//==============================================================================
+/*
+    Finds whether a file is already in the library in constant time.
+
+    Tracks are looked up by their canonical path first. A file at a new path
+    with the same size and content hash as a library track is probably a copy
+    of it, but the hash only covers the ends of the file, so the two have to
+    be compared in full before it is turned away. Tracks that only share a
+    title are not duplicates.
+*/
+class DuplicateIndex
+{
+    public:
+        enum class Match
+        {
+            none,           // not in the library
+            sameFile,       // this path is in the library, unchanged
+            changedFile,    // this path is in the library but the file has changed since
+            sameContent     // probably a copy of a library track at another path
+        };
+        struct Result
+        {
+            Match match;
+            juce::uint32 trackId;
+        };
+
+        DuplicateIndex();
+
+        void add(juce::uint32 trackId, const FileIdentity& identity);
+        void remove(juce::uint32 trackId, const FileIdentity& identity);
+        void clear();
+        /**Looks a file up by path, then by content*/
+        Result find(const FileIdentity& identity) const;
+
+    private:
+        struct PathEntry
+        {
+            juce::uint32 trackId;
+            juce::int64 size;
+            juce::int64 modificationTime;
+        };
+
+        static juce::uint64 contentKey(const FileIdentity& identity);
+
+        std::unordered_map<juce::String, PathEntry> byPath;
+        std::unordered_map<juce::uint64, juce::uint32> byContent;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DuplicateIndex)
+};
@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    FileIdentity.cpp
+    Created: 30 Apr 2023 10:05:19am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "FileIdentity.h"
+#include <filesystem>
+
+namespace
+{
+    /**64-bit FNV-1a*/
+    juce::uint64 hashBytes(juce::uint64 hash, const void* data, size_t size)
+    {
+        auto* bytes = static_cast<const juce::uint8*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+}
+
+FileIdentity FileIdentity::read(const juce::File& file, bool withContentHash)
+{
+    FileIdentity identity;
+    auto canonical = canonicalFile(file);
+    identity.path = canonical.getFullPathName();
+    identity.size = canonical.getSize();
+    identity.modificationTime = canonical.getLastModificationTime().toMilliseconds();
+
+    if (withContentHash && identity.size > 0)
+    {
+        juce::FileInputStream in{ canonical };
+        if (in.openedOk())
+        {
+            juce::HeapBlock<char> block(size_t(contentHashBlockSize));
+            juce::uint64 hash = hashBytes(14695981039346656037ull, &identity.size, sizeof(identity.size));
+
+            int numRead = in.read(block, contentHashBlockSize);
+            hash = hashBytes(hash, block, size_t(juce::jmax(0, numRead)));
+
+            // small files are covered by the first block
+            if (identity.size > contentHashBlockSize)
+            {
+                in.setPosition(juce::jmax(juce::int64(contentHashBlockSize), identity.size - contentHashBlockSize));
+                numRead = in.read(block, contentHashBlockSize);
+                hash = hashBytes(hash, block, size_t(juce::jmax(0, numRead)));
+            }
+            identity.contentHash = hash == 0 ? 1 : hash;
+        }
+    }
+    return identity;
+}
+
+juce::File FileIdentity::canonicalFile(const juce::File& file)
+{
+    // a linked folder higher up has to be resolved too, not just the file itself
+    std::error_code error;
+    auto resolved = std::filesystem::canonical(std::filesystem::u8path(file.getFullPathName().toStdString()), error);
+    if (error)
+    {
+        return file.isSymbolicLink() ? file.getLinkedTarget() : file;
+    }
+    return juce::File{ juce::String::fromUTF8(reinterpret_cast<const char*>(resolved.u8string().c_str())) };
+}
+
+bool FileIdentity::haveSameContent(const juce::File& a, const juce::File& b)
+{
+    if (a.getSize() != b.getSize())
+    {
+        return false;
+    }
+    juce::FileInputStream inA{ a };
+    juce::FileInputStream inB{ b };
+    if (!inA.openedOk() || !inB.openedOk())
+    {
+        return false;
+    }
+
+    const int blockSize = 1024 * 1024;
+    juce::HeapBlock<char> blockA(size_t(blockSize)), blockB(size_t(blockSize));
+    for (;;)
+    {
+        int numReadA = inA.read(blockA, blockSize);
+        int numReadB = inB.read(blockB, blockSize);
+        if (numReadA != numReadB || std::memcmp(blockA, blockB, size_t(juce::jmax(0, numReadA))) != 0)
+        {
+            return false;
+        }
+        if (numReadA < blockSize)
+        {
+            return true;
+        }
+    }
+}
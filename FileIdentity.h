@@ -0,0 +1,40 @@
+/*
+  ==============================================================================
+
+    FileIdentity.h
+    Created: 30 Apr 2023 10:05:19am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**What makes two library entries the same file. A size, time or hash of 0
+   means it hasn't been read*/
+struct FileIdentity
+{
+    /**full path with any symbolic links resolved*/
+    juce::String path;
+    juce::int64 size{ 0 };
+    /**milliseconds since the epoch*/
+    juce::int64 modificationTime{ 0 };
+    /**hash of the size and the first and last blocks of the file, so files
+       that only differ in the middle share it*/
+    juce::uint64 contentHash{ 0 };
+
+    /**Reads the identity of a file from disk. The content hash reads two
+       blocks of the file, so it is best done off the message thread*/
+    static FileIdentity read(const juce::File& file, bool withContentHash);
+    /**Resolves symbolic links anywhere in the path, and any . and .., so the
+       same file always gets the same path*/
+    static juce::File canonicalFile(const juce::File& file);
+    /**Compares two files byte for byte. This reads both in full, so it must
+       be done off the message thread*/
+    static bool haveSameContent(const juce::File& a, const juce::File& b);
+
+    /**Bytes hashed from each end of the file*/
+    static constexpr int contentHashBlockSize = 64 * 1024;
+};
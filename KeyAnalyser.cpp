@@ -0,0 +1,175 @@
+/*
+  ==============================================================================
+
+    KeyAnalyser.cpp
+    Created: 27 Aug 2023 4:52:09pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "KeyAnalyser.h"
+
+namespace
+{
+    /**How strongly each degree of the scale suggests a key, from the tonic up*/
+    const float majorProfile[12] = { 6.35f, 2.23f, 3.48f, 2.33f, 4.38f, 4.09f, 2.52f, 5.19f, 2.39f, 3.66f, 2.29f, 2.88f };
+    const float minorProfile[12] = { 6.33f, 2.68f, 3.52f, 5.38f, 2.60f, 3.53f, 2.54f, 4.75f, 3.98f, 2.69f, 3.34f, 3.17f };
+
+    const char* const pitchClassNames[12] = { "C", "Db", "D", "Eb", "E", "F", "Gb", "G", "Ab", "A", "Bb", "B" };
+
+    /**The key's number on the Camelot wheel, from 1 to 12*/
+    int getCamelotNumber(int key)
+    {
+        // a minor key shares its number with the major key a minor third above it
+        int major = key >= 12 ? (key + 3) % 12 : key;
+        // each step round the wheel is a fifth, with C major at 8
+        return (7 * major + 7) % 12 + 1;
+    }
+
+    /**Takes the mean out and scales to unit length, false if there's nothing left*/
+    bool normalise(float* values)
+    {
+        float mean = 0.0f;
+        for (int i = 0; i < 12; ++i)
+        {
+            mean += values[i] / 12.0f;
+        }
+        float sumOfSquares = 0.0f;
+        for (int i = 0; i < 12; ++i)
+        {
+            values[i] -= mean;
+            sumOfSquares += values[i] * values[i];
+        }
+        if (sumOfSquares <= 1.0e-12f)
+        {
+            return false;
+        }
+        float scale = 1.0f / std::sqrt(sumOfSquares);
+        for (int i = 0; i < 12; ++i)
+        {
+            values[i] *= scale;
+        }
+        return true;
+    }
+}
+
+KeyAnalyser::KeyAnalyser()
+{
+    int frameSize = fft.getSize();
+    window.resize(size_t(frameSize));
+    for (int i = 0; i < frameSize; ++i)
+    {
+        window[size_t(i)] = 0.5f - 0.5f * std::cos(2.0f * juce::MathConstants<float>::pi * float(i) / float(frameSize));
+    }
+    frame.resize(size_t(frameSize));
+    magnitudes.resize(size_t(frameSize / 2 + 1));
+    spectrum.resize(magnitudes.size());
+
+    std::copy(majorProfile, majorProfile + 12, profiles[0].begin());
+    std::copy(minorProfile, minorProfile + 12, profiles[1].begin());
+    for (auto& profile : profiles)
+    {
+        normalise(profile.data());
+    }
+}
+
+KeyAnalyser::Result KeyAnalyser::analyse(const float* samples, int numSamples, double sampleRate)
+{
+    Result result;
+    int frameSize = fft.getSize();
+    if (numSamples < frameSize || sampleRate <= 0.0)
+    {
+        return result;
+    }
+    if (sampleRate != mappedSampleRate)
+    {
+        mapBinsToPitchClasses(sampleRate);
+    }
+
+    // the key is the same in every frame, so only the sum is needed
+    std::fill(spectrum.begin(), spectrum.end(), 0.0f);
+    int numFrames = 1 + (numSamples - frameSize) / hopSize;
+    for (int f = 0; f < numFrames; ++f)
+    {
+        juce::FloatVectorOperations::multiply(frame.data(), samples + f * hopSize, window.data(), frameSize);
+        fft.performMagnitudes(frame.data(), magnitudes.data());
+        juce::FloatVectorOperations::add(spectrum.data(), magnitudes.data(), int(magnitudes.size()));
+    }
+
+    float chroma[12] = {};
+    for (size_t i = 0; i < binPitchClasses.size(); ++i)
+    {
+        chroma[binPitchClasses[i]] += binWeights[i] * spectrum[size_t(firstMappedBin) + i];
+    }
+    if (!normalise(chroma))
+    {
+        return result;
+    }
+
+    float bestCorrelation = -2.0f;
+    for (int key = 0; key < numKeys; ++key)
+    {
+        int tonic = key % 12;
+        const auto& profile = profiles[size_t(key / 12)];
+        float correlation = 0.0f;
+        for (int degree = 0; degree < 12; ++degree)
+        {
+            correlation += chroma[(tonic + degree) % 12] * profile[size_t(degree)];
+        }
+        if (correlation > bestCorrelation)
+        {
+            bestCorrelation = correlation;
+            result.key = key;
+        }
+    }
+    return result;
+}
+
+void KeyAnalyser::mapBinsToPitchClasses(double sampleRate)
+{
+    int frameSize = fft.getSize();
+    double binWidth = sampleRate / frameSize;
+    firstMappedBin = juce::jmax(1, int(std::ceil(lowestFrequency / binWidth)));
+    int lastMappedBin = juce::jmin(frameSize / 2, int(highestFrequency / binWidth));
+    binPitchClasses.clear();
+    binWeights.clear();
+    for (int bin = firstMappedBin; bin <= lastMappedBin; ++bin)
+    {
+        // as a MIDI note, so C is pitch class 0, with A4 at 440Hz
+        double pitch = 12.0 * std::log2(bin * binWidth / 440.0) + 69.0;
+        double nearest = std::round(pitch);
+        double offset = pitch - nearest;
+        double weight = std::cos(juce::MathConstants<double>::pi * offset);
+        binPitchClasses.push_back(((int(nearest) % 12) + 12) % 12);
+        binWeights.push_back(float(weight * weight));
+    }
+    mappedSampleRate = sampleRate;
+}
+
+juce::String KeyAnalyser::getKeyName(int key)
+{
+    if (key < 0 || key >= numKeys)
+    {
+        return {};
+    }
+    return juce::String(pitchClassNames[key % 12]) + (key >= 12 ? "m" : "");
+}
+
+juce::String KeyAnalyser::getCamelot(int key)
+{
+    if (key < 0 || key >= numKeys)
+    {
+        return {};
+    }
+    return juce::String(getCamelotNumber(key)) + (key >= 12 ? "A" : "B");
+}
+
+int KeyAnalyser::getCamelotOrder(int key)
+{
+    if (key < 0 || key >= numKeys)
+    {
+        return numKeys;
+    }
+    return 2 * (getCamelotNumber(key) - 1) + (key >= 12 ? 0 : 1);
+}
@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    KeyAnalyser.h
+    Created: 27 Aug 2023 4:52:09pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+#include "RealFft.h"
+
+//==============================================================================
+/*
+    Finds the musical key of a track from mono audio that has been brought
+    down to around 11kHz.
+
+    The magnitude spectra of long frames are summed over the whole track,
+    a vector add a frame, and the sum is folded into a chromagram: every
+    bin from A1 to A6 adds to the pitch class nearest it, weighted by how
+    close it is to the middle of the semitone. The key is whichever of the
+    24 major and minor Krumhansl-Kessler profiles correlates best with the
+    chromagram, so a track that changes key gets the one it spends the most
+    time in. The tuning is taken to be A440.
+
+    One analyser can be used for any number of tracks, but only by one
+    thread at a time.
+*/
+class KeyAnalyser
+{
+    public:
+        /**0 to 11 are C to B major and 12 to 23 are C to B minor*/
+        static constexpr int noKey = -1;
+        static constexpr int numKeys = 24;
+
+        struct Result
+        {
+            /**noKey if there was nothing tonal to go on*/
+            int key{ noKey };
+        };
+
+        KeyAnalyser();
+
+        Result analyse(const float* samples, int numSamples, double sampleRate);
+
+        /**The key's name, like "Eb" or "Am", or an empty string for noKey*/
+        static juce::String getKeyName(int key);
+        /**The key's place on the Camelot wheel, like "8A" for A minor, or an
+           empty string for noKey*/
+        static juce::String getCamelot(int key);
+        /**Orders keys round the Camelot wheel, 1A, 1B, 2A and so on, with
+           noKey after the rest*/
+        static int getCamelotOrder(int key);
+
+    private:
+        /**Works out which pitch class each bin adds to, and how much*/
+        void mapBinsToPitchClasses(double sampleRate);
+
+        static constexpr int fftOrder = 13;
+        static constexpr int hopSize = 4096;
+        static constexpr double lowestFrequency = 55.0;
+        static constexpr double highestFrequency = 1760.0;
+
+        RealFft fft{ fftOrder };
+        std::vector<float> window, frame, magnitudes, spectrum;
+        /**Mean-free and of unit length, so a dot product is the correlation*/
+        std::array<std::array<float, 12>, 2> profiles;
+
+        double mappedSampleRate{ 0.0 };
+        int firstMappedBin{ 0 };
+        /**From firstMappedBin on*/
+        std::vector<int> binPitchClasses;
+        std::vector<float> binWeights;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (KeyAnalyser)
+};
@@ -0,0 +1,751 @@
+/*
+  ==============================================================================
+
+    LibraryFile.cpp
+    Created: 16 Apr 2023 11:20:37am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "LibraryFile.h"
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+
+namespace
+{
+    const char snapshotMagic[4] = { 'D', 'J', 'L', 'B' };
+    const char journalMagic[4] = { 'D', 'J', 'J', 'L' };
+
+    /**Reads the analysis flags. Before version 6 there was no flag for a beat
+       grid being found, and an analysed track without one kept a downbeat of 0*/
+    juce::uint8 readAnalysisFlags(juce::uint32 flags, double bpm, double firstDownbeat, juce::uint32 version)
+    {
+        auto read = juce::uint8(flags & (TrackStore::beatsAnalysedFlag
+                                         | TrackStore::keyAnalysedFlag
+                                         | TrackStore::beatGridFoundFlag));
+        if (version < 6)
+        {
+            bool gridFound = (read & TrackStore::beatsAnalysedFlag) != 0 && bpm > 0.0 && firstDownbeat > 0.0;
+            read = juce::uint8((read & ~TrackStore::beatGridFoundFlag) | (gridFound ? TrackStore::beatGridFoundFlag : 0));
+        }
+        return read;
+    }
+
+    /**FNV-1a, used to spot entries torn by a crash part way through a write*/
+    juce::uint32 checksum(const void* data, size_t size)
+    {
+        auto* bytes = static_cast<const juce::uint8*>(data);
+        juce::uint32 hash = 2166136261u;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    void writeString(juce::OutputStream& out, const juce::String& text)
+    {
+        auto numBytes = text.getNumBytesAsUTF8();
+        out.writeInt(int(numBytes));
+        out.write(text.toRawUTF8(), numBytes);
+    }
+
+    bool readString(juce::MemoryInputStream& in, juce::String& text)
+    {
+        auto numBytes = juce::int64(juce::uint32(in.readInt()));
+        if (numBytes > in.getNumBytesRemaining())
+        {
+            return false;
+        }
+        auto* data = static_cast<const char*>(in.getData()) + in.getPosition();
+        text = juce::String::fromUTF8(data, int(numBytes));
+        in.skipNextBytes(numBytes);
+        return true;
+    }
+
+    void writeTrackPayload(juce::OutputStream& out, const Track& track)
+    {
+        out.writeInt(juce::roundToInt(track.lengthInSeconds * 1000.0));
+        out.writeFloat(float(track.bpm));
+        writeString(out, track.file.getFullPathName());
+        writeString(out, track.title);
+        writeString(out, track.artist);
+        out.writeInt64(track.identity.size);
+        out.writeInt64(track.identity.modificationTime);
+        out.writeInt64(juce::int64(track.identity.contentHash));
+        out.writeInt(int(track.id));
+        out.writeFloat(float(track.firstDownbeat));
+        out.writeInt(int(TrackStore::packAnalysisFlags(track)));
+        out.writeInt(track.key);
+    }
+}
+
+//==============================================================================
+LibraryFile::LibraryFile(juce::File _snapshotFile
+                        ) : snapshotFile(_snapshotFile),
+                            journalFile(_snapshotFile.withFileExtension("djlog")),
+                            compactingJournalFile(_snapshotFile.withFileExtension("djlog.compacting"))
+{
+}
+
+LibraryFile::~LibraryFile()
+{
+    // let a snapshot that is being written finish rather than leave it half done
+    compactionPool.removeAllJobs(false, 10000);
+    journal.reset();
+}
+
+void LibraryFile::load(const juce::File& legacyPlaylist, TrackStore& store)
+{
+    store.clear();
+    juce::uint32 version = 0;
+    bool hasSnapshot = readSnapshot(store, version);
+    bool snapshotIsCurrent = hasSnapshot && version == currentVersion;
+
+    if (!hasSnapshot && !journalFile.exists() && legacyPlaylist.existsAsFile())
+    {
+        DBG("LibraryFile::load migrating " << legacyPlaylist.getFullPathName());
+        readLegacyPlaylist(legacyPlaylist, store);
+        snapshotIsCurrent = writeSnapshot(snapshotFile, store);
+    }
+
+    // a journal left over from a compaction that didn't finish comes first
+    bool interruptedCompaction = compactingJournalFile.exists();
+    for (auto* journalToReplay : { &compactingJournalFile, &journalFile })
+    {
+        if (!replayJournal(*journalToReplay, store))
+        {
+            auto setAside = journalToReplay->getSiblingFile(journalToReplay->getFileName() + ".unreadable")
+                                            .getNonexistentSibling();
+            DBG("LibraryFile::load setting " << journalToReplay->getFileName() << " aside as " << setAside.getFileName());
+            journalToReplay->moveFileTo(setAside);
+        }
+    }
+
+    if (interruptedCompaction)
+    {
+        if (writeSnapshot(snapshotFile, store))
+        {
+            compactingJournalFile.deleteFile();
+            journalFile.deleteFile();
+            journalEntries = 0;
+            snapshotIsCurrent = true;
+        }
+    }
+
+    openJournal();
+    // an older snapshot is rewritten with an id index, so it's only built once
+    if (hasSnapshot && !snapshotIsCurrent)
+    {
+        compact();
+    }
+    DBG("LibraryFile::load " << store.size() << " track(s), "
+        << journalEntries << " journal entries");
+}
+
+void LibraryFile::trackAdded(const Track& track)
+{
+    juce::MemoryBlock payload;
+    juce::MemoryOutputStream out{ payload, false };
+    writeTrackPayload(out, track);
+    out.flush();
+    appendToJournal(addOp, payload);
+}
+
+void LibraryFile::trackRemoved(const Track& track)
+{
+    juce::MemoryBlock payload;
+    juce::MemoryOutputStream out{ payload, false };
+    writeString(out, track.file.getFullPathName());
+    out.writeInt(int(track.id));
+    out.flush();
+    appendToJournal(removeOp, payload);
+}
+
+void LibraryFile::compactIfNeeded()
+{
+    if (journalEntries >= maxJournalEntries)
+    {
+        compact();
+    }
+}
+
+void LibraryFile::compact()
+{
+    if (compacting)
+    {
+        return;
+    }
+    DBG("LibraryFile::compact folding " << journalEntries << " journal entries");
+    compacting = true;
+
+    // edits made while the snapshot is written go to a fresh journal. The old
+    // one is kept until the snapshot is in place in case the app quits first
+    journal.reset();
+    if (!moveJournalAside())
+    {
+        DBG("LibraryFile::compact could not move the journal aside");
+        compacting = false;
+        openJournal();
+        return;
+    }
+    journalEntries = 0;
+    openJournal();
+
+    // the library is rebuilt from the files rather than copied from the
+    // store, which would stall the message thread on a large library
+    compactionPool.addJob([this]
+    {
+        TrackStore merged;
+        juce::uint32 version = 0;
+        bool hasSnapshot = readSnapshot(merged, version);
+        // a snapshot that can't be read is left for someone to look at, not replaced
+        if ((hasSnapshot || !snapshotFile.exists())
+            && replayJournal(compactingJournalFile, merged)
+            && writeSnapshot(snapshotFile, merged))
+        {
+            compactingJournalFile.deleteFile();
+        }
+        compacting = false;
+    });
+}
+
+bool LibraryFile::isCompacting() const
+{
+    return compacting;
+}
+
+bool LibraryFile::moveJournalAside()
+{
+    if (!compactingJournalFile.exists())
+    {
+        return journalFile.moveFileTo(compactingJournalFile);
+    }
+
+    // the last compaction didn't write its snapshot, so its journal still holds
+    // edits that aren't anywhere else. The new entries go after them
+    juce::MemoryBlock contents;
+    if (!journalFile.loadFileAsData(contents))
+    {
+        return false;
+    }
+    if (contents.getSize() > 8)
+    {
+        juce::FileOutputStream out{ compactingJournalFile };
+        if (out.failedToOpen())
+        {
+            return false;
+        }
+        out.write(static_cast<const char*>(contents.getData()) + 8, contents.getSize() - 8);
+        out.flush();
+        if (out.getStatus().failed())
+        {
+            return false;
+        }
+    }
+    return journalFile.deleteFile();
+}
+
+bool LibraryFile::readSnapshot(TrackStore& store, juce::uint32& version)
+{
+    auto snapshot = MappedSnapshot::open(snapshotFile);
+    if (snapshot == nullptr)
+    {
+        if (snapshotFile.existsAsFile())
+        {
+            DBG("LibraryFile::readSnapshot " << snapshotFile.getFileName() << " is not a valid library");
+        }
+        return false;
+    }
+    version = snapshot->getVersion();
+    store.open(snapshot);
+    return true;
+}
+
+bool LibraryFile::replayJournal(const juce::File& journalToReplay, TrackStore& store)
+{
+    juce::MemoryBlock contents;
+    if (!journalToReplay.loadFileAsData(contents) || contents.getSize() == 0)
+    {
+        return true;
+    }
+    // every version so far only added fields to the end of an entry, so any
+    // of them can be replayed, but a newer one might not be
+    auto* data = static_cast<const char*>(contents.getData());
+    auto version = contents.getSize() < 8 ? 0 : juce::ByteOrder::littleEndianInt(data + 4);
+    if (contents.getSize() < 8 || std::memcmp(data, journalMagic, 4) != 0 || version > currentVersion)
+    {
+        DBG("LibraryFile::replayJournal can't read " << journalToReplay.getFileName());
+        return false;
+    }
+
+    // edits are made in order to the track with the entry's id. Entries from
+    // before ids were journalled are matched by path, which reads every row
+    std::unordered_map<juce::String, juce::uint32> idsByPath;
+    bool pathsIndexed = false;
+    auto findRow = [&store, &idsByPath, &pathsIndexed](const juce::String& path, juce::uint32 id)
+    {
+        if (id == 0)
+        {
+            if (!pathsIndexed)
+            {
+                for (int row = 0; row < store.size(); ++row)
+                {
+                    idsByPath[store.getFile(row).getFullPathName()] = store.getId(row);
+                }
+                pathsIndexed = true;
+            }
+            auto found = idsByPath.find(path);
+            id = found != idsByPath.end() ? found->second : 0;
+        }
+        return id != 0 ? store.getRow(id) : -1;
+    };
+
+    juce::MemoryInputStream in{ contents, false };
+    in.setPosition(8);
+    int numReplayed = 0;
+    while (in.getNumBytesRemaining() >= 9)
+    {
+        auto op = juce::uint8(in.readByte());
+        auto payloadSize = juce::int64(juce::uint32(in.readInt()));
+        if (payloadSize + 4 > in.getNumBytesRemaining())
+        {
+            break;
+        }
+        auto* payload = static_cast<const char*>(contents.getData()) + in.getPosition();
+        in.skipNextBytes(payloadSize);
+        if (juce::uint32(in.readInt()) != checksum(payload, size_t(payloadSize)))
+        {
+            DBG("LibraryFile::replayJournal stopping at a torn entry");
+            break;
+        }
+
+        juce::MemoryInputStream entry{ payload, size_t(payloadSize), false };
+        juce::String path;
+        juce::uint32 id = 0;
+        std::optional<Track> added;
+        if (op == addOp)
+        {
+            auto lengthMillis = juce::uint32(entry.readInt());
+            auto bpm = entry.readFloat();
+            juce::String title, artist;
+            if (!readString(entry, path) || !readString(entry, title) || !readString(entry, artist))
+            {
+                break;
+            }
+            Track track{ juce::File{ path } };
+            track.title = title;
+            track.artist = artist;
+            track.lengthInSeconds = lengthMillis / 1000.0;
+            track.bpm = bpm;
+            // entries journalled before file identities were stored end here
+            if (entry.getNumBytesRemaining() >= 24)
+            {
+                track.identity.size = entry.readInt64();
+                track.identity.modificationTime = entry.readInt64();
+                track.identity.contentHash = juce::uint64(entry.readInt64());
+            }
+            if (entry.getNumBytesRemaining() >= 4)
+            {
+                track.id = juce::uint32(entry.readInt());
+            }
+            if (entry.getNumBytesRemaining() >= 8)
+            {
+                track.firstDownbeat = entry.readFloat();
+                auto flags = juce::uint32(entry.readInt());
+                TrackStore::unpackAnalysisFlags(track, readAnalysisFlags(flags, track.bpm, track.firstDownbeat, version));
+            }
+            if (entry.getNumBytesRemaining() >= 4)
+            {
+                track.key = entry.readInt();
+            }
+            id = track.id;
+            added = track;
+        }
+        else if (op == removeOp && readString(entry, path))
+        {
+            // removals journalled before version 7 only have the path
+            if (entry.getNumBytesRemaining() >= 4)
+            {
+                id = juce::uint32(entry.readInt());
+            }
+        }
+        else
+        {
+            break;
+        }
+
+        // replaying the same entry twice leaves the store the same
+        int row = findRow(path, id);
+        if (added.has_value())
+        {
+            if (row >= 0)
+            {
+                added->id = store.getId(row);
+                store.update(*added);
+            }
+            else
+            {
+                added->id = store.add(*added);
+            }
+            if (pathsIndexed)
+            {
+                idsByPath[path] = added->id;
+            }
+        }
+        else if (row >= 0)
+        {
+            store.remove(store.getId(row));
+            if (pathsIndexed)
+            {
+                idsByPath.erase(path);
+            }
+        }
+        ++numReplayed;
+    }
+
+    if (journalToReplay == journalFile)
+    {
+        journalEntries = numReplayed;
+    }
+    return true;
+}
+
+void LibraryFile::readLegacyPlaylist(const juce::File& legacyPlaylist, TrackStore& store)
+{
+    juce::StringArray lines;
+    legacyPlaylist.readLines(lines);
+    for (const juce::String& line : lines)
+    {
+        if (line.trim().isEmpty())
+        {
+            continue;
+        }
+        // the length never has a comma in it but the path might
+        juce::String path = line.upToLastOccurrenceOf(",", false, false);
+        juce::String length = line.fromLastOccurrenceOf(",", false, false).trim();
+
+        Track track{ juce::File{ path } };
+        track.lengthInSeconds = length.upToFirstOccurrenceOf(":", false, false).getIntValue() * 60
+                              + length.fromFirstOccurrenceOf(":", false, false).getIntValue();
+        store.add(track);
+    }
+}
+
+bool LibraryFile::writeSnapshot(const juce::File& file, const TrackStore& store)
+{
+    juce::MemoryOutputStream stringPool;
+    std::vector<Record> records;
+    records.reserve(size_t(store.size()));
+
+    auto addString = [&stringPool](const juce::String& text, juce::uint32& offset, juce::uint32& length)
+    {
+        offset = juce::uint32(stringPool.getDataSize());
+        length = juce::uint32(text.getNumBytesAsUTF8());
+        stringPool.write(text.toRawUTF8(), length);
+    };
+
+    for (int row = 0; row < store.size(); ++row)
+    {
+        auto identity = store.getIdentity(row);
+        Record record{};
+        addString(identity.path, record.pathOffset, record.pathLength);
+        addString(store.getTitle(row), record.titleOffset, record.titleLength);
+        addString(store.getArtist(row), record.artistOffset, record.artistLength);
+        record.lengthMillis = juce::uint32(juce::jmax(0, juce::roundToInt(store.getLengthInSeconds(row) * 1000.0)));
+        record.bpm = float(store.getBpm(row));
+        record.fileSize = identity.size;
+        record.modificationTime = identity.modificationTime;
+        record.contentHash = identity.contentHash;
+        record.trackId = store.getId(row);
+        record.firstDownbeat = float(store.getFirstDownbeat(row));
+        record.analysisFlags = store.getAnalysisFlags(row);
+        record.key = store.getKey(row);
+        records.push_back(record);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, snapshotMagic, 4);
+    header.version = currentVersion;
+    header.headerSize = sizeof(Header);
+    header.recordSize = sizeof(Record);
+    header.recordCount = records.size();
+    header.stringPoolOffset = sizeof(Header) + records.size() * sizeof(Record);
+    header.stringPoolSize = stringPool.getDataSize();
+    header.idIndexOffset = header.stringPoolOffset + header.stringPoolSize;
+
+    // lets the store find a track by id without reading every record
+    std::vector<IdEntry> idIndex;
+    idIndex.reserve(records.size());
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        idIndex.push_back({ records[i].trackId, juce::uint32(i) });
+    }
+    std::sort(idIndex.begin(), idIndex.end(), [](const IdEntry& a, const IdEntry& b) { return a.trackId < b.trackId; });
+
+    // written next to the library and swapped in, so a crash never leaves half a file
+    juce::TemporaryFile temp{ file };
+    {
+        juce::FileOutputStream out{ temp.getFile() };
+        if (out.failedToOpen())
+        {
+            return false;
+        }
+        out.write(&header, sizeof(Header));
+        out.write(records.data(), records.size() * sizeof(Record));
+        out.write(stringPool.getData(), stringPool.getDataSize());
+        out.write(idIndex.data(), idIndex.size() * sizeof(IdEntry));
+        out.flush();
+        if (out.getStatus().failed())
+        {
+            return false;
+        }
+    }
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+void LibraryFile::appendToJournal(JournalOp op, const juce::MemoryBlock& payload)
+{
+    if (journal == nullptr)
+    {
+        return;
+    }
+    juce::MemoryOutputStream entry;
+    entry.writeByte(char(op));
+    entry.writeInt(int(payload.getSize()));
+    entry.write(payload.getData(), payload.getSize());
+    entry.writeInt(int(checksum(payload.getData(), payload.getSize())));
+
+    journal->write(entry.getData(), entry.getDataSize());
+    journal->flush();
+    ++journalEntries;
+}
+
+void LibraryFile::openJournal()
+{
+    bool isNew = !journalFile.existsAsFile() || journalFile.getSize() == 0;
+    journal = std::make_unique<juce::FileOutputStream>(journalFile);
+    if (journal->failedToOpen())
+    {
+        DBG("LibraryFile::openJournal could not open " << journalFile.getFullPathName());
+        journal.reset();
+        return;
+    }
+    if (isNew)
+    {
+        journal->write(journalMagic, 4);
+        journal->writeInt(int(currentVersion));
+        journal->flush();
+    }
+}
+
+//==============================================================================
+LibraryFile::MappedSnapshot::MappedSnapshot(const juce::File& file) : mapped(file, juce::MemoryMappedFile::readOnly)
+{
+}
+
+std::shared_ptr<LibraryFile::MappedSnapshot> LibraryFile::MappedSnapshot::open(const juce::File& file)
+{
+    auto snapshot = std::make_shared<MappedSnapshot>(file);
+    if (!snapshot->readHeader())
+    {
+        return nullptr;
+    }
+    return snapshot;
+}
+
+bool LibraryFile::MappedSnapshot::readHeader()
+{
+    auto* data = static_cast<const char*>(mapped.getData());
+    auto fileSize = juce::uint64(mapped.getSize());
+    // headers before version 7 end where the id index's offset is now
+    const juce::uint64 oldHeaderSize = offsetof(Header, idIndexOffset);
+    if (data == nullptr || fileSize < oldHeaderSize)
+    {
+        return false;
+    }
+    std::memcpy(&header, data, size_t(juce::jmin(fileSize, juce::uint64(sizeof(Header)))));
+    if (header.headerSize < sizeof(Header))
+    {
+        header.idIndexOffset = 0;
+    }
+
+    bool isValid = std::memcmp(header.magic, snapshotMagic, 4) == 0
+                && header.version <= currentVersion
+                && header.headerSize >= oldHeaderSize
+                && header.recordSize >= 2 * sizeof(juce::uint32)
+                && header.recordCount <= juce::uint64(std::numeric_limits<int>::max())
+                && header.headerSize + header.recordCount * header.recordSize <= header.stringPoolOffset
+                && header.stringPoolOffset + header.stringPoolSize <= fileSize
+                && (header.idIndexOffset == 0
+                    || header.idIndexOffset + header.recordCount * sizeof(IdEntry) <= fileSize);
+    if (!isValid)
+    {
+        return false;
+    }
+
+    records = data + header.headerSize;
+    stringPool = data + header.stringPoolOffset;
+    if (header.idIndexOffset != 0)
+    {
+        idIndex = data + header.idIndexOffset;
+    }
+    else
+    {
+        // older snapshots are read through once to index them
+        builtIdIndex.reserve(size_t(header.recordCount));
+        for (int i = 0; i < size(); ++i)
+        {
+            builtIdIndex.push_back({ getId(i), juce::uint32(i) });
+        }
+        std::sort(builtIdIndex.begin(), builtIdIndex.end(),
+                  [](const IdEntry& a, const IdEntry& b) { return a.trackId < b.trackId; });
+    }
+    if (size() > 0)
+    {
+        maxId = getIdEntry(size_t(size() - 1)).trackId;
+    }
+    return true;
+}
+
+juce::uint32 LibraryFile::MappedSnapshot::getVersion() const
+{
+    return header.version;
+}
+
+int LibraryFile::MappedSnapshot::size() const
+{
+    return int(header.recordCount);
+}
+
+int LibraryFile::MappedSnapshot::find(juce::uint32 id) const
+{
+    size_t low = 0;
+    size_t high = size_t(size());
+    while (low < high)
+    {
+        size_t middle = (low + high) / 2;
+        if (getIdEntry(middle).trackId < id)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    if (low == size_t(size()))
+    {
+        return -1;
+    }
+    auto entry = getIdEntry(low);
+    return entry.trackId == id && entry.record < header.recordCount ? int(entry.record) : -1;
+}
+
+juce::uint32 LibraryFile::MappedSnapshot::getMaxId() const
+{
+    return maxId;
+}
+
+juce::uint32 LibraryFile::MappedSnapshot::getId(int index) const
+{
+    // before ids were stored a track's id was its place in the library, as
+    // adding them in order to an empty store gave them
+    if (header.version < 3)
+    {
+        return juce::uint32(index + 1);
+    }
+    return getRecord(index).trackId;
+}
+
+juce::String LibraryFile::MappedSnapshot::getPath(int index) const
+{
+    auto record = getRecord(index);
+    return getString(record.pathOffset, record.pathLength);
+}
+
+juce::String LibraryFile::MappedSnapshot::getTitle(int index) const
+{
+    auto record = getRecord(index);
+    return getString(record.titleOffset, record.titleLength);
+}
+
+juce::String LibraryFile::MappedSnapshot::getArtist(int index) const
+{
+    auto record = getRecord(index);
+    return getString(record.artistOffset, record.artistLength);
+}
+
+juce::uint32 LibraryFile::MappedSnapshot::getLengthMillis(int index) const
+{
+    return getRecord(index).lengthMillis;
+}
+
+float LibraryFile::MappedSnapshot::getBpm(int index) const
+{
+    return getRecord(index).bpm;
+}
+
+float LibraryFile::MappedSnapshot::getFirstDownbeat(int index) const
+{
+    return getRecord(index).firstDownbeat;
+}
+
+int LibraryFile::MappedSnapshot::getKey(int index) const
+{
+    // older snapshots have a zero here, which is a key only once it's been analysed
+    if ((getAnalysisFlags(index) & TrackStore::keyAnalysedFlag) == 0)
+    {
+        return -1;
+    }
+    return juce::jlimit(-1, 23, int(getRecord(index).key));
+}
+
+juce::uint8 LibraryFile::MappedSnapshot::getAnalysisFlags(int index) const
+{
+    auto record = getRecord(index);
+    return readAnalysisFlags(record.analysisFlags, record.bpm, record.firstDownbeat, header.version);
+}
+
+FileIdentity LibraryFile::MappedSnapshot::getIdentity(int index) const
+{
+    auto record = getRecord(index);
+    FileIdentity identity;
+    identity.path = getString(record.pathOffset, record.pathLength);
+    identity.size = record.fileSize;
+    identity.modificationTime = record.modificationTime;
+    identity.contentHash = record.contentHash;
+    return identity;
+}
+
+LibraryFile::Record LibraryFile::MappedSnapshot::getRecord(int index) const
+{
+    Record record{};
+    std::memcpy(&record, records + size_t(index) * header.recordSize,
+                juce::jmin(size_t(header.recordSize), sizeof(Record)));
+    return record;
+}
+
+LibraryFile::IdEntry LibraryFile::MappedSnapshot::getIdEntry(size_t entry) const
+{
+    if (idIndex == nullptr)
+    {
+        return builtIdIndex[entry];
+    }
+    IdEntry read;
+    std::memcpy(&read, idIndex + entry * sizeof(IdEntry), sizeof(IdEntry));
+    return read;
+}
+
+juce::String LibraryFile::MappedSnapshot::getString(juce::uint32 offset, juce::uint32 length) const
+{
+    if (juce::uint64(offset) + length > header.stringPoolSize)
+    {
+        return {};
+    }
+    return juce::String::fromUTF8(stringPool + offset, int(length));
+}
@@ -0,0 +1,183 @@
+/*
+  ==============================================================================
+
+    LibraryFile.h
+    Created: 16 Apr 2023 11:20:37am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "Track.h"
+#include "TrackStore.h"
+
+//==============================================================================
+/*
+    Saves the library as a binary snapshot plus an append-only journal.
+
+    The snapshot is a header, a table of fixed-width records, a pool of
+    UTF-8 strings and an index of the records by track id. It is memory-
+    mapped when the library is opened and the TrackStore reads its tracks
+    from the mapping, so only the journal is read in full. Every edit is
+    appended to the journal straight away, with the track's id, so nothing
+    is lost if the app doesn't shut down cleanly.
+    Once the journal grows large enough it is folded into a fresh snapshot
+    on a background thread, which reads the old snapshot and replays the
+    journal itself, so compacting costs the message thread no more than
+    moving the journal aside.
+
+    New record fields are added at the end of the record, and new journal
+    fields at the end of an entry. The header stores the record size, so
+    older snapshots are still read with the missing fields set to zero.
+    A snapshot from before the id index has one built when it is opened,
+    and is rewritten in the background. A journal written by a newer
+    version is set aside rather than replayed or appended to.
+*/
+class LibraryFile
+{
+    public:
+        LibraryFile(juce::File _snapshotFile);
+        ~LibraryFile();
+
+        /**Opens the store on the snapshot and replays the journal into it. If there
+           is no snapshot yet the old comma separated playlist is migrated into a new one*/
+        void load(const juce::File& legacyPlaylist, TrackStore& store);
+        /**Records a track being added to the library*/
+        void trackAdded(const Track& track);
+        /**Records a track being removed from the library*/
+        void trackRemoved(const Track& track);
+        /**Folds the journal into a new snapshot in the background once it is large
+           enough*/
+        void compactIfNeeded();
+        /**Writes a new snapshot in the background and starts a new journal*/
+        void compact();
+        /**Returns true while a new snapshot is being written*/
+        bool isCompacting() const;
+
+        static constexpr juce::uint32 currentVersion = 7;
+
+    private:
+        /**On-disk layout, stored little-endian*/
+        struct Header
+        {
+            char magic[4];
+            juce::uint32 version;
+            juce::uint32 headerSize;
+            juce::uint32 recordSize;
+            juce::uint64 recordCount;
+            juce::uint64 stringPoolOffset;
+            juce::uint64 stringPoolSize;
+            // version 7, 0 before
+            juce::uint64 idIndexOffset;
+        };
+        struct Record
+        {
+            juce::uint32 pathOffset;
+            juce::uint32 pathLength;
+            juce::uint32 titleOffset;
+            juce::uint32 titleLength;
+            juce::uint32 artistOffset;
+            juce::uint32 artistLength;
+            juce::uint32 lengthMillis;
+            float bpm;
+            // version 2
+            juce::int64 fileSize;
+            juce::int64 modificationTime;
+            juce::uint64 contentHash;
+            // version 3
+            juce::uint32 trackId;
+            juce::uint32 reserved;
+            // version 4
+            float firstDownbeat;
+            juce::uint32 analysisFlags;
+            // version 5
+            juce::int32 key;
+            juce::uint32 reserved2;
+            // version 6 added TrackStore::beatGridFoundFlag to analysisFlags
+        };
+        /**The id index holds one of these per record, in id order*/
+        struct IdEntry
+        {
+            juce::uint32 trackId;
+            juce::uint32 record;
+        };
+        enum JournalOp : juce::uint8
+        {
+            addOp = 1,
+            removeOp = 2
+        };
+
+        /**A snapshot file mapped into memory, which a TrackStore reads its
+           tracks from in place*/
+        class MappedSnapshot : public TrackStore::Snapshot
+        {
+            public:
+                MappedSnapshot(const juce::File& file);
+
+                /**Maps a snapshot, or returns nullptr if it can't be read*/
+                static std::shared_ptr<MappedSnapshot> open(const juce::File& file);
+                juce::uint32 getVersion() const;
+
+                int size() const override;
+                int find(juce::uint32 id) const override;
+                juce::uint32 getMaxId() const override;
+                juce::uint32 getId(int index) const override;
+                juce::String getPath(int index) const override;
+                juce::String getTitle(int index) const override;
+                juce::String getArtist(int index) const override;
+                juce::uint32 getLengthMillis(int index) const override;
+                float getBpm(int index) const override;
+                float getFirstDownbeat(int index) const override;
+                int getKey(int index) const override;
+                juce::uint8 getAnalysisFlags(int index) const override;
+                FileIdentity getIdentity(int index) const override;
+
+            private:
+                bool readHeader();
+                /**Fields added after the snapshot was written are left at zero*/
+                Record getRecord(int index) const;
+                IdEntry getIdEntry(size_t entry) const;
+                juce::String getString(juce::uint32 offset, juce::uint32 length) const;
+
+                juce::MemoryMappedFile mapped;
+                Header header{};
+                const char* records{ nullptr };
+                const char* stringPool{ nullptr };
+                const char* idIndex{ nullptr };
+                /**Built when the snapshot is opened if it is too old to have one*/
+                std::vector<IdEntry> builtIdIndex;
+                juce::uint32 maxId{ 0 };
+        };
+
+        /**Opens the store on the snapshot. Returns false if there isn't one that
+           can be read, otherwise sets version to the snapshot's*/
+        bool readSnapshot(TrackStore& store, juce::uint32& version);
+        /**Returns false if the journal is there but can't be read, like one
+           from a newer version*/
+        bool replayJournal(const juce::File& journal, TrackStore& store);
+        /**Moves the journal out of a compaction's way, after the entries of
+           one that failed if there is one*/
+        bool moveJournalAside();
+        void readLegacyPlaylist(const juce::File& legacyPlaylist, TrackStore& store);
+        static bool writeSnapshot(const juce::File& file, const TrackStore& store);
+        void appendToJournal(JournalOp op, const juce::MemoryBlock& payload);
+        void openJournal();
+
+        juce::File snapshotFile;
+        juce::File journalFile;
+        juce::File compactingJournalFile;
+        std::unique_ptr<juce::FileOutputStream> journal;
+        int journalEntries{ 0 };
+
+        /**Journal entries allowed before it is folded into the snapshot*/
+        static constexpr int maxJournalEntries = 1000;
+
+        std::atomic<bool> compacting{ false };
+        juce::ThreadPool compactionPool{ 1 };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibraryFile)
+};
@@ -0,0 +1,310 @@
+/*
+  ==============================================================================
+
+    LibraryImporter.cpp
+    Created: 2 Apr 2023 4:12:51pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "LibraryImporter.h"
+
+//==============================================================================
+/*
+    Walks a folder recursively and queues every audio file it finds.
+*/
+class LibraryImporter::ScanJob : public juce::ThreadPoolJob
+{
+    public:
+        ScanJob(LibraryImporter& _owner, juce::File _folder, int _generation)
+            : juce::ThreadPoolJob("Library scan"),
+              owner(_owner),
+              folder(_folder),
+              generation(_generation)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            auto wildcard = owner.formatManager.getWildcardForAllFormats();
+            for (const auto& entry : juce::RangedDirectoryIterator(folder, true, wildcard,
+                                                                   juce::File::findFiles))
+            {
+                if (shouldExit() || generation != owner.generation)
+                {
+                    break;
+                }
+                owner.queueFile(entry.getFile(), generation);
+            }
+            owner.scanFinished(generation);
+            return jobHasFinished;
+        }
+
+    private:
+        LibraryImporter& owner;
+        juce::File folder;
+        int generation;
+};
+
+//==============================================================================
+/*
+    Reads the metadata of a single file.
+*/
+class LibraryImporter::ProbeJob : public juce::ThreadPoolJob
+{
+    public:
+        ProbeJob(LibraryImporter& _owner, juce::File _file, int _generation)
+            : juce::ThreadPoolJob("Library probe"),
+              owner(_owner),
+              file(_file),
+              generation(_generation)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            if (shouldExit() || generation != owner.generation)
+            {
+                return jobHasFinished;
+            }
+
+            Result result;
+            result.identity = FileIdentity::read(file, true);
+            result.file = juce::File{ result.identity.path };
+            owner.probe.probe(result.file, result.metadata);
+            owner.addResult(std::move(result), generation);
+            return jobHasFinished;
+        }
+
+    private:
+        LibraryImporter& owner;
+        juce::File file;
+        int generation;
+};
+
+//==============================================================================
+/*
+    Compares a file with the library track whose content hash it shares.
+*/
+class LibraryImporter::CompareJob : public juce::ThreadPoolJob
+{
+    public:
+        CompareJob(LibraryImporter& _owner, Result _result, juce::File _libraryTrack, int _generation)
+            : juce::ThreadPoolJob("Library compare"),
+              owner(_owner),
+              result(std::move(_result)),
+              libraryTrack(_libraryTrack),
+              generation(_generation)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            if (shouldExit() || generation != owner.generation)
+            {
+                return jobHasFinished;
+            }
+            if (FileIdentity::haveSameContent(result.file, libraryTrack))
+            {
+                DBG("LibraryImporter " << result.file.getFileName() << " is a copy of " << libraryTrack.getFullPathName());
+                owner.dropResult(generation);
+            }
+            else
+            {
+                result.isDistinct = true;
+                owner.addResult(std::move(result), generation);
+            }
+            return jobHasFinished;
+        }
+
+    private:
+        LibraryImporter& owner;
+        Result result;
+        juce::File libraryTrack;
+        int generation;
+};
+
+//==============================================================================
+LibraryImporter::LibraryImporter(juce::AudioFormatManager& _formatManager
+                                ) : formatManager(_formatManager),
+                                    probe(_formatManager)
+{
+}
+
+LibraryImporter::~LibraryImporter()
+{
+    stopTimer();
+    ++generation;
+    pool.removeAllJobs(true, 5000);
+}
+
+LibraryImporter::Listener::Listener() {}
+LibraryImporter::Listener::~Listener() {}
+
+void LibraryImporter::addListener(Listener* l)
+{
+    listeners.add(l);
+}
+
+void LibraryImporter::removeListener(Listener* l)
+{
+    listeners.remove(l);
+}
+
+void LibraryImporter::importFiles(const juce::StringArray& paths)
+{
+    DBG("LibraryImporter::importFiles called with " << paths.size() << " path(s)");
+    if (!importing)
+    {
+        numQueued = 0;
+        numProbed = 0;
+        importing = true;
+        startTimer(50);
+    }
+
+    for (const juce::String& path : paths)
+    {
+        juce::File file{ path };
+        if (file.isDirectory())
+        {
+            ++numScansRunning;
+            pool.addJob(new ScanJob(*this, file, generation), true);
+        }
+        else if (formatManager.findFormatForFileExtension(file.getFileExtension()) != nullptr)
+        {
+            queueFile(file, generation);
+        }
+        else
+        {
+            DBG("LibraryImporter::importFiles unsupported file: " << file.getFileName());
+        }
+    }
+}
+
+void LibraryImporter::checkCopy(const Result& result, const juce::File& libraryTrack)
+{
+    ++numQueued;
+    pool.addJob(new CompareJob(*this, result, libraryTrack, generation), true);
+}
+
+void LibraryImporter::cancel()
+{
+    if (!importing)
+    {
+        return;
+    }
+    DBG("LibraryImporter::cancel called");
+
+    // bumping the generation makes any job still in flight drop its result,
+    // and stops a scan that outlives the wait below from being uncounted twice
+    {
+        const juce::ScopedLock sl(lock);
+        ++generation;
+        numScansRunning = 0;
+        pending.clear();
+    }
+    pool.removeAllJobs(true, 2000);
+    finishImport(true);
+}
+
+bool LibraryImporter::isImporting() const
+{
+    return importing;
+}
+
+double LibraryImporter::getProgress() const
+{
+    int queued = numQueued;
+    if (queued == 0)
+    {
+        return importing ? -1.0 : 0.0; // -1 shows a spinning bar while scanning
+    }
+    return double(numProbed) / double(queued);
+}
+
+int LibraryImporter::getNumProbed() const
+{
+    return numProbed;
+}
+
+int LibraryImporter::getNumQueued() const
+{
+    return numQueued;
+}
+
+void LibraryImporter::queueFile(const juce::File& file, int jobGeneration)
+{
+    // checked under the lock so a scan that outlives cancel() can't count a
+    // file after the counts have been reset
+    const juce::ScopedLock sl(lock);
+    if (jobGeneration != generation)
+    {
+        return;
+    }
+    ++numQueued;
+    pool.addJob(new ProbeJob(*this, file, jobGeneration), true);
+}
+
+void LibraryImporter::scanFinished(int jobGeneration)
+{
+    const juce::ScopedLock sl(lock);
+    if (jobGeneration == generation)
+    {
+        --numScansRunning;
+    }
+}
+
+void LibraryImporter::addResult(Result result, int jobGeneration)
+{
+    const juce::ScopedLock sl(lock);
+    if (jobGeneration == generation)
+    {
+        pending.push_back(std::move(result));
+        ++numProbed;
+    }
+}
+
+void LibraryImporter::dropResult(int jobGeneration)
+{
+    const juce::ScopedLock sl(lock);
+    if (jobGeneration == generation)
+    {
+        ++numProbed;
+    }
+}
+
+void LibraryImporter::timerCallback()
+{
+    std::vector<Result> batch;
+    {
+        const juce::ScopedLock sl(lock);
+        batch.swap(pending);
+    }
+
+    if (!batch.empty())
+    {
+        listeners.call([&batch](Listener& l) { l.tracksImported(batch); });
+    }
+
+    // checked after the listeners, which may have queued files to compare.
+    // Results are counted under the lock, so once everything queued has been
+    // probed and nothing is pending the batch above was the last one
+    bool allProbed;
+    {
+        const juce::ScopedLock sl(lock);
+        allProbed = numScansRunning == 0 && numProbed == numQueued && pending.empty();
+    }
+    if (allProbed)
+    {
+        finishImport(false);
+    }
+}
+
+void LibraryImporter::finishImport(bool wasCancelled)
+{
+    DBG("LibraryImporter finished: " << numProbed << " of " << numQueued << " file(s) probed");
+    stopTimer();
+    importing = false;
+    listeners.call([wasCancelled](Listener& l) { l.importFinished(wasCancelled); });
+}
@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+
+    LibraryImporter.h
+    Created: 2 Apr 2023 4:12:51pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+#include "MetadataProbe.h"
+#include "FileIdentity.h"
+
+//==============================================================================
+/*
+    Imports files and folders into the library off the message thread.
+    Folders are scanned recursively and every audio file found is probed
+    for its metadata on a pool of worker threads. Results are collected and
+    handed to the listeners in batches on the message thread.
+*/
+class LibraryImporter : private juce::Timer
+{
+    public:
+        LibraryImporter(juce::AudioFormatManager& _formatManager);
+        ~LibraryImporter() override;
+
+        /**Metadata gathered for one imported file*/
+        struct Result
+        {
+            juce::File file;
+            FileIdentity identity;
+            TrackMetadata metadata;
+            /**Set once the file has been compared in full with the library track
+               it shares a content hash with, and found to differ*/
+            bool isDistinct{ false };
+        };
+
+        class Listener
+        {
+            public:
+                Listener();
+                virtual ~Listener();
+
+                /**Called on the message thread with the next batch of probed files*/
+                virtual void tracksImported(const std::vector<Result>& batch) = 0;
+                /**Called on the message thread when an import finishes or is cancelled*/
+                virtual void importFinished(bool wasCancelled) = 0;
+        };
+        void addListener(Listener* l);
+        void removeListener(Listener* l);
+
+        /**Queues files and folders (scanned recursively) for import*/
+        void importFiles(const juce::StringArray& paths);
+        /**Compares a file with the library track it shares a content hash with,
+           in the background. If they differ the file comes back through
+           tracksImported with isDistinct set, otherwise it is dropped as a copy*/
+        void checkCopy(const Result& result, const juce::File& libraryTrack);
+        /**Stops the current import, dropping any files not yet probed*/
+        void cancel();
+        /**Returns true while files are being scanned or probed*/
+        bool isImporting() const;
+        /**Gets the fraction of queued files that have been probed (0 to 1)*/
+        double getProgress() const;
+        /**Gets the number of files probed and queued in the current import*/
+        int getNumProbed() const;
+        int getNumQueued() const;
+
+    private:
+        class ScanJob;
+        class ProbeJob;
+        class CompareJob;
+
+        void timerCallback() override;
+        void queueFile(const juce::File& file, int generation);
+        /**Uncounts a finished scan, unless it belongs to a cancelled import*/
+        void scanFinished(int generation);
+        void addResult(Result result, int generation);
+        /**Counts a queued file that won't be imported*/
+        void dropResult(int generation);
+        void finishImport(bool wasCancelled);
+
+        juce::AudioFormatManager& formatManager;
+        MetadataProbe probe;
+        juce::ListenerList<Listener> listeners;
+
+        juce::CriticalSection lock;
+        std::vector<Result> pending;
+
+        std::atomic<int> generation{ 0 };
+        std::atomic<int> numQueued{ 0 };
+        std::atomic<int> numProbed{ 0 };
+        std::atomic<int> numScansRunning{ 0 };
+        bool importing{ false };
+
+        juce::ThreadPool pool{ juce::jmax(1, juce::SystemStats::getNumCpus() - 1) };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibraryImporter)
+};
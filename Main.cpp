@@ -8,6 +8,7 @@
 
 #include <JuceHeader.h>
 #include "MainComponent.h"
+#include "Benchmarks.h"
 
 //==============================================================================
 class DJAPPOtodecksApplication  : public juce::JUCEApplication
@@ -25,7 +26,20 @@ public:
     {
         // This method is where you should put your application's initialisation code..
 
-        mainWindow.reset (new MainWindow (getApplicationName()));
+        // benchmarks run headless and quit straight away
+        if (Benchmarks::isBenchmarkCommandLine(commandLine))
+        {
+            setApplicationReturnValue(Benchmarks::run(commandLine));
+            quit();
+            return;
+        }
+
+        // --decks n opens more than the usual two decks
+        auto args = juce::StringArray::fromTokens(commandLine, " ", "\"");
+        int decksIndex = args.indexOf("--decks");
+        int numDecks = decksIndex >= 0 ? args[decksIndex + 1].getIntValue() : 2;
+
+        mainWindow.reset (new MainWindow (getApplicationName(), numDecks));
     }
 
     void shutdown() override
@@ -58,14 +72,14 @@ public:
     class MainWindow    : public juce::DocumentWindow
     {
     public:
-        MainWindow (juce::String name)
+        MainWindow (juce::String name, int numDecks)
             : DocumentWindow (name,
                               juce::Desktop::getInstance().getDefaultLookAndFeel()
                                                           .findColour (juce::ResizableWindow::backgroundColourId),
                               DocumentWindow::allButtons)
         {
             setUsingNativeTitleBar (true);
-            setContentOwned (new MainComponent(), true);
+            setContentOwned (new MainComponent (numDecks), true);
 
            #if JUCE_IOS || JUCE_ANDROID
             setFullScreen (true);
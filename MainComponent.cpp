@@ -1,11 +1,28 @@
 #include "MainComponent.h"
 
 //==============================================================================
-MainComponent::MainComponent()
+MainComponent::MainComponent(int _numDecks)
+    : numDecks(juce::jlimit(1, maxDecks, _numDecks)),
+      // the audio thread renders a deck too, and leaves a core for everything else
+      deckEngine(juce::jmax(0, juce::jmin(numDecks - 1, juce::SystemStats::getNumCpus() - 1)))
 {
+    juce::Array<DeckGUI*> guis;
+    for (int deck = 0; deck < numDecks; ++deck)
+    {
+        auto* player = players.add(new DJAudioPlayer{ formatManager });
+        player->setMixBus(&deckEngine.getMixBus(), deck);
+        player->setBeatSync(&beatSync, deck);
+        guis.add(deckGUIs.add(new DeckGUI{ deck + 1, player, formatManager, thumbCache }));
+        deckEngine.addInput(deckTimers.add(new AudioCallbackStats::DeckTimer{ callbackStats, deck, player }));
+    }
+    // the reverb's return is turned down by the master gain with the decks
+    deckEngine.setSendReverb(&sendReverb);
+    playlistComponent = std::make_unique<PlaylistComponent>(guis, formatManager);
+
     // Make sure you set the size of the component after
     // you add any child components.
-    setSize (944, 600);
+    // past two decks they go side by side in pairs
+    setSize (numDecks > 2 ? 1600 : 944, 600);
 
     // Some platforms require permissions to open input channels so request that here
     if (juce::RuntimePermissions::isRequired (juce::RuntimePermissions::recordAudio)
@@ -20,17 +37,70 @@ MainComponent::MainComponent()
         setAudioChannels (2, 2);
     }
 
-    addAndMakeVisible(deckGUI1);
-    addAndMakeVisible(deckGUI2);
-    addAndMakeVisible(playlistComponent);
+    for (auto* deckGUI : deckGUIs)
+    {
+        addAndMakeVisible(deckGUI);
+    }
+    addAndMakeVisible(*playlistComponent);
+    addAndMakeVisible(loadLabel);
+    loadLabel.setFont(12.0f);
+
+    // one reverb on the mix, with each deck's wet level as its send
+    for (int deck = 0; deck < numDecks; ++deck)
+    {
+        players[deck]->setSendBus(&sendReverb, deck);
+    }
+    addAndMakeVisible(sharedReverbButton);
+    sharedReverbButton.setTooltip("Send every deck to one reverb on the mix");
+    sharedReverbButton.onClick = [this]
+    {
+        bool shared = sharedReverbButton.getToggleState();
+        for (auto* player : players)
+        {
+            player->setReverbSend(shared);
+        }
+    };
+    // odd decks are on side A, even decks on side B
+    addAndMakeVisible(crossfader);
+    crossfader.setSliderStyle(juce::Slider::LinearHorizontal);
+    crossfader.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+    crossfader.setRange(0.0, 1.0);
+    crossfader.setValue(0.5);
+    crossfader.setDoubleClickReturnValue(true, 0.5);
+    crossfader.setTooltip("Crossfader: odd decks on the left, even decks on the right");
+    crossfader.onValueChange = [this] { deckEngine.getMixBus().setCrossfader(float(crossfader.getValue())); };
+    addAndMakeVisible(crossfaderCurveBox);
+    crossfaderCurveBox.addItem("Cut", 1);
+    crossfaderCurveBox.addItem("Linear", 2);
+    crossfaderCurveBox.addItem("Constant power", 3);
+    crossfaderCurveBox.setSelectedId(1, juce::dontSendNotification);
+    crossfaderCurveBox.setTooltip("Crossfader curve");
+    crossfaderCurveBox.onChange = [this]
+    {
+        const MixBus::CrossfaderCurve curves[] = { MixBus::CrossfaderCurve::cut,
+                                                   MixBus::CrossfaderCurve::linear,
+                                                   MixBus::CrossfaderCurve::constantPower };
+        deckEngine.getMixBus().setCrossfaderCurve(curves[crossfaderCurveBox.getSelectedId() - 1]);
+    };
+    addAndMakeVisible(masterSlider);
+    masterSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    masterSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+    masterSlider.setRange(0.0, 1.0);
+    masterSlider.setValue(1.0);
+    masterSlider.setTooltip("Master volume");
+    masterSlider.onValueChange = [this] { deckEngine.getMixBus().setMasterGain(float(masterSlider.getValue())); };
+
+    DBG("MainComponent: " << numDecks << " decks, " << deckEngine.getNumWorkers() << " render workers");
 
     formatManager.registerBasicFormats();
+    startTimerHz(4);
 }
 
 MainComponent::~MainComponent()
 {
     // This shuts down the audio device and clears the audio source.
     shutdownAudio();
+    DBG("MainComponent audio callbacks: " << callbackStats.getSnapshot().toString());
 }
 
 //==============================================================================
@@ -44,15 +114,17 @@ void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRat
 
     // For more details, see the help for AudioProcessor::prepareToPlay()
 
-    mixerSource.addInputSource(&player1, false);
-    mixerSource.addInputSource(&player2, false);
-    player1.prepareToPlay(samplesPerBlockExpected, sampleRate);
-    player2.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    callbackStats.prepare(sampleRate);
+    // prepares the decks through their timers
+    deckEngine.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    sendReverb.prepareToPlay(samplesPerBlockExpected, sampleRate);
 
 }
 void MainComponent::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    mixerSource.getNextAudioBlock(bufferToFill);
+    AudioCallbackStats::ScopedCallback timeCallback{ callbackStats, bufferToFill.numSamples };
+    // mixes in the send reverb's return too
+    deckEngine.getNextAudioBlock(bufferToFill);
 }
 
 void MainComponent::releaseResources()
@@ -61,10 +133,8 @@ void MainComponent::releaseResources()
     // restarted due to a setting change.
 
     // For more details, see the help for AudioProcessor::releaseResources()
-    mixerSource.removeAllInputs();
-    mixerSource.releaseResources();
-    player1.releaseResources();
-    player2.releaseResources();
+    deckEngine.releaseResources();
+    sendReverb.releaseResources();
 }
 
 //==============================================================================
@@ -84,7 +154,51 @@ void MainComponent::resized()
     // update their positions.
     int columns = 100;
     auto playlistRight = 28 * getWidth() / columns;
-    playlistComponent.setBounds(0, 0, playlistRight, getHeight());
-    deckGUI1.setBounds(playlistRight, 0, getWidth() - playlistRight, getHeight() / 2);
-    deckGUI2.setBounds(playlistRight, getHeight() / 2, getWidth() - playlistRight, getHeight() / 2);
+    int loadHeight = 20;
+    int faderHeight = 24;
+    playlistComponent->setBounds(0, 0, playlistRight, getHeight() - loadHeight - faderHeight);
+    int faderTop = getHeight() - loadHeight - faderHeight;
+    crossfaderCurveBox.setBounds(0, faderTop, playlistRight / 4, faderHeight);
+    crossfader.setBounds(playlistRight / 4, faderTop, playlistRight / 2, faderHeight);
+    masterSlider.setBounds(3 * playlistRight / 4, faderTop, playlistRight / 4, faderHeight);
+    loadLabel.setBounds(0, getHeight() - loadHeight, 2 * playlistRight / 3, loadHeight);
+    sharedReverbButton.setBounds(2 * playlistRight / 3, getHeight() - loadHeight, playlistRight / 3, loadHeight);
+
+    // decks 1 and 2 down the first column, then the next pair beside them
+    int rows = juce::jmin(numDecks, 2);
+    int deckColumns = (numDecks + rows - 1) / rows;
+    int decksWidth = getWidth() - playlistRight;
+    for (int deck = 0; deck < numDecks; ++deck)
+    {
+        int column = deck / rows;
+        int row = deck % rows;
+        int left = playlistRight + column * decksWidth / deckColumns;
+        int right = playlistRight + (column + 1) * decksWidth / deckColumns;
+        int top = row * getHeight() / rows;
+        int bottom = (row + 1) * getHeight() / rows;
+        deckGUIs[deck]->setBounds(left, top, right - left, bottom - top);
+    }
+}
+
+void MainComponent::timerCallback()
+{
+    auto stats = callbackStats.getSnapshot();
+    juce::String text;
+    text << "Audio load " << juce::roundToInt(stats.load * 100.0f) << "%, peak "
+         << juce::roundToInt(stats.peakLoad * 100.0f) << "%, overruns " << stats.numOverruns;
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+    {
+        int deviceXRuns = device->getXRunCount();
+        if (deviceXRuns > 0)
+        {
+            text << ", xruns " << deviceXRuns;
+        }
+    }
+    loadLabel.setText(text, juce::dontSendNotification);
+
+    if (stats.numOverruns > loggedOverruns)
+    {
+        loggedOverruns = stats.numOverruns;
+        DBG("MainComponent audio callback overran its deadline: " << stats.toString());
+    }
 }
@@ -4,17 +4,24 @@
 #include "DJAudioPlayer.h"
 #include "DeckGUI.h"
 #include "PlaylistComponent.h"
+#include "PeakCache.h"
+#include "AudioCallbackStats.h"
+#include "SendReverb.h"
+#include "DeckEngine.h"
+#include "BeatSync.h"
 
 //==============================================================================
 /*
     This component lives inside our window, and this is where you should put all
     your controls and content.
 */
-class MainComponent  : public juce::AudioAppComponent
+class MainComponent  : public juce::AudioAppComponent,
+                       public juce::Timer
 {
 public:
     //==============================================================================
-    MainComponent();
+    /**The number of decks is fixed for the life of the window, up to maxDecks*/
+    MainComponent(int _numDecks = 2);
     ~MainComponent() override;
 
     //==============================================================================
@@ -25,21 +32,40 @@ public:
     //==============================================================================
     void paint (juce::Graphics& g) override;
     void resized() override;
+    /**Shows the audio load, and logs the callback stats when there are new overruns*/
+    void timerCallback() override;
+
+    static constexpr int maxDecks = juce::jmin(AudioCallbackStats::maxDecks,
+                                               juce::jmin(SendReverb::maxSenders, BeatSync::maxDecks));
 
 private:
     //==============================================================================
     // Your private member variables go here...
 
     juce::AudioFormatManager formatManager;
-    juce::AudioThumbnailCache thumbCache{100};
+    PeakCache thumbCache{ 100, juce::File::getCurrentWorkingDirectory().getChildFile("peakCache") };
+    /**The reverb the decks share when sharedReverbButton is on*/
+    SendReverb sendReverb;
+    /**The clock synced decks follow the master deck by*/
+    BeatSync beatSync;
+
+    AudioCallbackStats callbackStats;
 
-    DJAudioPlayer player1{formatManager};
-    DJAudioPlayer player2{formatManager};
-    DJAudioPlayer playerForParsingMetaData{formatManager};
-    DeckGUI deckGUI1{1, &player1, formatManager, thumbCache};
-    DeckGUI deckGUI2{2, &player2, formatManager, thumbCache};
-    PlaylistComponent playlistComponent{ &deckGUI1, &deckGUI2, &playerForParsingMetaData };
+    int numDecks;
+    juce::OwnedArray<DJAudioPlayer> players;
+    juce::OwnedArray<DeckGUI> deckGUIs;
+    /**Each deck is timed on its way into the engine*/
+    juce::OwnedArray<AudioCallbackStats::DeckTimer> deckTimers;
+    std::unique_ptr<PlaylistComponent> playlistComponent;
+    juce::Label loadLabel;
+    juce::ToggleButton sharedReverbButton{ "Shared reverb" };
+    /**Fades between the decks on side A and side B of the mix bus*/
+    juce::Slider crossfader;
+    juce::ComboBox crossfaderCurveBox;
+    juce::Slider masterSlider;
+    juce::int64 loggedOverruns{ 0 };
 
-    juce::MixerAudioSource mixerSource;
+    /**Renders the decks across the cores and mixes them*/
+    DeckEngine deckEngine;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainComponent)
 };
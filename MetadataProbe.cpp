@@ -0,0 +1,624 @@
+/*
+  ==============================================================================
+
+    MetadataProbe.cpp
+    Created: 9 Apr 2023 2:37:05pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "MetadataProbe.h"
+
+namespace
+{
+    bool hasId(const char* data, const char* id)
+    {
+        return std::memcmp(data, id, 4) == 0;
+    }
+
+    juce::uint32 readSyncSafe(const juce::uint8* b)
+    {
+        return (juce::uint32(b[0] & 0x7f) << 21) | (juce::uint32(b[1] & 0x7f) << 14)
+             | (juce::uint32(b[2] & 0x7f) << 7) | juce::uint32(b[3] & 0x7f);
+    }
+
+    juce::uint32 readBigEndian(const juce::uint8* b, int numBytes)
+    {
+        juce::uint32 value = 0;
+        for (int i = 0; i < numBytes; ++i)
+        {
+            value = (value << 8) | b[i];
+        }
+        return value;
+    }
+
+    /**Converts the 80-bit extended float AIFF uses for its sample rate*/
+    double readExtended(const juce::uint8* b)
+    {
+        int exponent = ((b[0] & 0x7f) << 8) | b[1];
+        juce::uint64 mantissa = 0;
+        for (int i = 2; i < 10; ++i)
+        {
+            mantissa = (mantissa << 8) | b[i];
+        }
+        if (exponent == 0 && mantissa == 0)
+        {
+            return 0.0;
+        }
+        return std::ldexp(double(mantissa), exponent - 16383 - 63);
+    }
+
+    juce::String latin1ToString(const juce::uint8* data, int size)
+    {
+        juce::String text;
+        text.preallocateBytes(size_t(size));
+        for (int i = 0; i < size && data[i] != 0; ++i)
+        {
+            text += juce::juce_wchar(data[i]);
+        }
+        return text;
+    }
+
+    /**Decodes an ID3v2 text frame, whose first byte gives the encoding*/
+    juce::String decodeId3Text(const juce::uint8* data, int size)
+    {
+        if (size < 2)
+        {
+            return {};
+        }
+        auto* text = data + 1;
+        int textSize = size - 1;
+        switch (data[0])
+        {
+            case 1: // UTF-16 with a byte order mark
+                return juce::String::createStringFromData(text, textSize).trim();
+            case 2: // UTF-16BE without one
+            {
+                juce::String s;
+                for (int i = 0; i + 1 < textSize; i += 2)
+                {
+                    auto c = juce::juce_wchar((text[i] << 8) | text[i + 1]);
+                    if (c == 0) { break; }
+                    s += c;
+                }
+                return s.trim();
+            }
+            case 3:
+                return juce::String::fromUTF8(reinterpret_cast<const char*>(text), textSize).trim();
+            default:
+                return latin1ToString(text, textSize).trim();
+        }
+    }
+
+    //==============================================================================
+    struct MpegFrameHeader
+    {
+        int version{ 0 };           // 1 = MPEG1, 2 = MPEG2, 25 = MPEG2.5
+        int layer{ 0 };
+        int bitrate{ 0 };           // kbit/s
+        int sampleRate{ 0 };
+        int numChannels{ 0 };
+        int samplesPerFrame{ 0 };
+        int frameLength{ 0 };       // bytes
+        int sideInfoSize{ 0 };      // bytes after the 4 byte header
+    };
+
+    bool parseMpegFrameHeader(const juce::uint8* b, MpegFrameHeader& header)
+    {
+        if (b[0] != 0xff || (b[1] & 0xe0) != 0xe0)
+        {
+            return false;
+        }
+
+        static const int bitrates[2][3][15] = {
+            // MPEG1 layers I, II, III
+            { { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+              { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },
+              { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 } },
+            // MPEG2 and 2.5 layers I, II, III
+            { { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+              { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+              { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 } }
+        };
+        static const int sampleRates[3] = { 44100, 48000, 32000 };
+
+        int versionBits = (b[1] >> 3) & 3;
+        int layerBits = (b[1] >> 1) & 3;
+        int bitrateIndex = (b[2] >> 4) & 15;
+        int sampleRateIndex = (b[2] >> 2) & 3;
+        int padding = (b[2] >> 1) & 1;
+        int channelMode = (b[3] >> 6) & 3;
+
+        // reserved values, and free format which has no usable bitrate
+        if (versionBits == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15
+            || sampleRateIndex == 3)
+        {
+            return false;
+        }
+
+        header.version = versionBits == 3 ? 1 : (versionBits == 2 ? 2 : 25);
+        header.layer = 4 - layerBits;
+        bool isMpeg1 = header.version == 1;
+        header.bitrate = bitrates[isMpeg1 ? 0 : 1][header.layer - 1][bitrateIndex];
+        header.sampleRate = sampleRates[sampleRateIndex] / (isMpeg1 ? 1 : (header.version == 2 ? 2 : 4));
+        header.numChannels = channelMode == 3 ? 1 : 2;
+
+        if (header.layer == 1)
+        {
+            header.samplesPerFrame = 384;
+            header.frameLength = (12000 * header.bitrate / header.sampleRate + padding) * 4;
+        }
+        else
+        {
+            header.samplesPerFrame = (header.layer == 3 && !isMpeg1) ? 576 : 1152;
+            header.frameLength = (header.samplesPerFrame / 8) * 1000 * header.bitrate / header.sampleRate
+                               + padding;
+        }
+
+        if (isMpeg1)
+        {
+            header.sideInfoSize = header.numChannels == 1 ? 17 : 32;
+        }
+        else
+        {
+            header.sideInfoSize = header.numChannels == 1 ? 9 : 17;
+        }
+        return true;
+    }
+}
+
+//==============================================================================
+MetadataProbe::MetadataProbe(juce::AudioFormatManager& _formatManager
+                            ) : formatManager(_formatManager)
+{
+}
+
+bool MetadataProbe::probe(const juce::File& file, TrackMetadata& metadata) const
+{
+    juce::FileInputStream in{ file };
+    if (in.failedToOpen())
+    {
+        DBG("MetadataProbe::probe could not open " << file.getFullPathName());
+        return false;
+    }
+
+    char magic[12] = {};
+    if (in.read(magic, 12) != 12)
+    {
+        return false;
+    }
+
+    bool ok = false;
+    if (hasId(magic, "RIFF") && hasId(magic + 8, "WAVE"))
+    {
+        ok = probeWav(in, metadata);
+    }
+    else if (hasId(magic, "FORM") && (hasId(magic + 8, "AIFF") || hasId(magic + 8, "AIFC")))
+    {
+        ok = probeAiff(in, metadata);
+    }
+    else if (hasId(magic, "fLaC"))
+    {
+        in.setPosition(4);
+        ok = probeFlac(in, metadata);
+    }
+    else if (file.hasFileExtension("mp3"))
+    {
+        juce::int64 audioStart = 0;
+        if (magic[0] == 'I' && magic[1] == 'D' && magic[2] == '3')
+        {
+            in.setPosition(0);
+            readId3v2(in, metadata);
+            audioStart = 10 + readSyncSafe(reinterpret_cast<const juce::uint8*>(magic + 6));
+        }
+        ok = probeMp3(in, audioStart, metadata);
+    }
+
+    // anything the headers didn't cover is read the slow way
+    if (!ok || metadata.lengthInSeconds <= 0)
+    {
+        ok = probeWithReader(file, metadata);
+    }
+
+    if (metadata.title.isEmpty())
+    {
+        metadata.title = file.getFileNameWithoutExtension();
+    }
+    return ok;
+}
+
+bool MetadataProbe::probeWav(juce::InputStream& in, TrackMetadata& metadata) const
+{
+    int formatTag = 0;
+    int blockAlign = 0;
+    juce::int64 dataSize = 0;
+
+    in.setPosition(12);
+    while (!in.isExhausted())
+    {
+        char id[4];
+        if (in.read(id, 4) != 4)
+        {
+            break;
+        }
+        juce::int64 size = juce::uint32(in.readInt());
+        juce::int64 chunkStart = in.getPosition();
+        juce::int64 nextChunk = chunkStart + size + (size & 1);
+
+        if (hasId(id, "fmt "))
+        {
+            formatTag = juce::uint16(in.readShort());
+            metadata.numChannels = juce::uint16(in.readShort());
+            metadata.sampleRate = juce::uint32(in.readInt());
+            in.readInt(); // byte rate
+            blockAlign = juce::uint16(in.readShort());
+        }
+        else if (hasId(id, "data"))
+        {
+            // streamed files can leave the size at 0 or 0xffffffff, so clamp to the file
+            dataSize = juce::jmin(size, in.getTotalLength() - chunkStart);
+            if (dataSize <= 0)
+            {
+                dataSize = in.getTotalLength() - chunkStart;
+            }
+        }
+        else if (hasId(id, "LIST"))
+        {
+            char listType[4];
+            if (in.read(listType, 4) == 4 && hasId(listType, "INFO"))
+            {
+                while (in.getPosition() + 8 <= nextChunk)
+                {
+                    char infoId[4];
+                    in.read(infoId, 4);
+                    int infoSize = in.readInt();
+                    if (infoSize < 0)
+                    {
+                        break;
+                    }
+                    juce::int64 nextInfo = in.getPosition() + infoSize + (infoSize & 1);
+                    if (infoSize > 0 && infoSize < 1024 && (hasId(infoId, "INAM") || hasId(infoId, "IART")))
+                    {
+                        juce::HeapBlock<juce::uint8> text(size_t(infoSize));
+                        in.read(text, infoSize);
+                        auto value = latin1ToString(text, infoSize).trim();
+                        (hasId(infoId, "INAM") ? metadata.title : metadata.artist) = value;
+                    }
+                    in.setPosition(nextInfo);
+                }
+            }
+        }
+        else if (hasId(id, "id3 ") || hasId(id, "ID3 "))
+        {
+            readId3v2(in, metadata);
+        }
+
+        if (size < 0 || !in.setPosition(nextChunk))
+        {
+            break;
+        }
+    }
+
+    // compressed WAVs don't have a fixed frame size, leave those to a reader
+    bool isPcm = formatTag == 1 || formatTag == 3 || formatTag == 0xfffe;
+    if (!isPcm || blockAlign <= 0 || metadata.sampleRate <= 0)
+    {
+        return false;
+    }
+    metadata.lengthInSeconds = double(dataSize / blockAlign) / metadata.sampleRate;
+    return true;
+}
+
+bool MetadataProbe::probeAiff(juce::InputStream& in, TrackMetadata& metadata) const
+{
+    juce::int64 numFrames = 0;
+
+    in.setPosition(12);
+    while (!in.isExhausted())
+    {
+        char id[4];
+        if (in.read(id, 4) != 4)
+        {
+            break;
+        }
+        juce::int64 size = juce::uint32(in.readIntBigEndian());
+        juce::int64 nextChunk = in.getPosition() + size + (size & 1);
+
+        if (hasId(id, "COMM") && size >= 18)
+        {
+            juce::uint8 comm[18];
+            in.read(comm, 18);
+            metadata.numChannels = int(readBigEndian(comm, 2));
+            numFrames = readBigEndian(comm + 2, 4);
+            metadata.sampleRate = readExtended(comm + 8);
+        }
+        else if ((hasId(id, "NAME") || hasId(id, "AUTH")) && size > 0 && size < 1024)
+        {
+            juce::HeapBlock<juce::uint8> text(size_t(size));
+            in.read(text, int(size));
+            auto value = latin1ToString(text, int(size)).trim();
+            (hasId(id, "NAME") ? metadata.title : metadata.artist) = value;
+        }
+        else if (hasId(id, "ID3 "))
+        {
+            readId3v2(in, metadata);
+        }
+
+        if (!in.setPosition(nextChunk))
+        {
+            break;
+        }
+    }
+
+    if (metadata.sampleRate <= 0)
+    {
+        return false;
+    }
+    metadata.lengthInSeconds = double(numFrames) / metadata.sampleRate;
+    return true;
+}
+
+bool MetadataProbe::probeFlac(juce::InputStream& in, TrackMetadata& metadata) const
+{
+    bool foundStreamInfo = false;
+    bool isLastBlock = false;
+
+    while (!isLastBlock && !in.isExhausted())
+    {
+        juce::uint8 blockHeader[4];
+        if (in.read(blockHeader, 4) != 4)
+        {
+            break;
+        }
+        isLastBlock = (blockHeader[0] & 0x80) != 0;
+        int blockType = blockHeader[0] & 0x7f;
+        juce::int64 blockSize = readBigEndian(blockHeader + 1, 3);
+        juce::int64 nextBlock = in.getPosition() + blockSize;
+
+        if (blockType == 0 && blockSize >= 18) // STREAMINFO
+        {
+            juce::uint8 info[18];
+            in.read(info, 18);
+            int sampleRate = (info[10] << 12) | (info[11] << 4) | (info[12] >> 4);
+            metadata.sampleRate = sampleRate;
+            metadata.numChannels = ((info[12] >> 1) & 7) + 1;
+            juce::uint64 totalSamples = (juce::uint64(info[13] & 0x0f) << 32) | readBigEndian(info + 14, 4);
+            if (sampleRate > 0)
+            {
+                metadata.lengthInSeconds = double(totalSamples) / sampleRate;
+            }
+            foundStreamInfo = true;
+        }
+        else if (blockType == 4) // VORBIS_COMMENT, little endian unlike the rest of FLAC
+        {
+            juce::int64 vendorLength = juce::uint32(in.readInt());
+            in.skipNextBytes(vendorLength);
+            int numComments = in.readInt();
+            for (int i = 0; i < numComments && in.getPosition() < nextBlock; ++i)
+            {
+                juce::int64 length = juce::uint32(in.readInt());
+                if (length <= 0 || length > 1024)
+                {
+                    in.skipNextBytes(length);
+                    continue;
+                }
+                juce::MemoryBlock comment;
+                in.readIntoMemoryBlock(comment, ssize_t(length));
+                auto text = comment.toString();
+                auto key = text.upToFirstOccurrenceOf("=", false, false).toUpperCase();
+                auto value = text.fromFirstOccurrenceOf("=", false, false).trim();
+                if (key == "TITLE")                        { metadata.title = value; }
+                else if (key == "ARTIST")                  { metadata.artist = value; }
+                else if (key == "BPM" || key == "TEMPO")   { metadata.bpm = value.getDoubleValue(); }
+            }
+        }
+
+        if (!in.setPosition(nextBlock))
+        {
+            break;
+        }
+    }
+    return foundStreamInfo && metadata.sampleRate > 0;
+}
+
+bool MetadataProbe::probeMp3(juce::InputStream& in, juce::int64 audioStart, TrackMetadata& metadata) const
+{
+    // the first frame is normally right after the ID3 tag, but encoders
+    // sometimes leave junk in between so search a little way in
+    const int searchSize = 64 * 1024;
+    juce::HeapBlock<juce::uint8> buffer(size_t(searchSize), true);
+    in.setPosition(audioStart);
+    int bytesRead = in.read(buffer, searchSize);
+
+    MpegFrameHeader header;
+    int frameStart = -1;
+    for (int i = 0; i + 4 <= bytesRead; ++i)
+    {
+        if (parseMpegFrameHeader(buffer + i, header))
+        {
+            // a random 0xff byte can look like a sync word, so check the next frame too
+            MpegFrameHeader next;
+            int nextFrame = i + header.frameLength;
+            if (nextFrame + 4 > bytesRead || parseMpegFrameHeader(buffer + nextFrame, next))
+            {
+                frameStart = i;
+                break;
+            }
+        }
+    }
+    if (frameStart < 0)
+    {
+        return false;
+    }
+
+    metadata.sampleRate = header.sampleRate;
+    metadata.numChannels = header.numChannels;
+
+    juce::int64 numFrames = 0;
+    int xingOffset = frameStart + 4 + header.sideInfoSize;
+    int vbriOffset = frameStart + 4 + 32;
+    if (xingOffset + 12 <= bytesRead
+        && (hasId(reinterpret_cast<const char*>(buffer + xingOffset), "Xing")
+            || hasId(reinterpret_cast<const char*>(buffer + xingOffset), "Info")))
+    {
+        // "Info" is the same header written by LAME for CBR files
+        metadata.isVariableBitRate = buffer[xingOffset] == 'X';
+        auto flags = readBigEndian(buffer + xingOffset + 4, 4);
+        if ((flags & 1) != 0)
+        {
+            numFrames = readBigEndian(buffer + xingOffset + 8, 4);
+        }
+    }
+    else if (vbriOffset + 18 <= bytesRead && hasId(reinterpret_cast<const char*>(buffer + vbriOffset), "VBRI"))
+    {
+        metadata.isVariableBitRate = true;
+        numFrames = readBigEndian(buffer + vbriOffset + 14, 4);
+    }
+
+    // a tag might have been left at the end as well
+    readId3v1(in, metadata);
+
+    if (numFrames > 0)
+    {
+        metadata.lengthInSeconds = double(numFrames * header.samplesPerFrame) / header.sampleRate;
+    }
+    else
+    {
+        // no frame count, so estimate from the bitrate of the first frame
+        juce::int64 audioBytes = in.getTotalLength() - (audioStart + frameStart);
+        if (in.getTotalLength() >= 128)
+        {
+            char tag[3];
+            in.setPosition(in.getTotalLength() - 128);
+            if (in.read(tag, 3) == 3 && tag[0] == 'T' && tag[1] == 'A' && tag[2] == 'G')
+            {
+                audioBytes -= 128;
+            }
+        }
+        metadata.lengthInSeconds = double(audioBytes) * 8.0 / (header.bitrate * 1000.0);
+    }
+    return true;
+}
+
+bool MetadataProbe::probeWithReader(const juce::File& file, TrackMetadata& metadata) const
+{
+    std::unique_ptr<juce::AudioFormatReader> reader{ formatManager.createReaderFor(file) };
+    if (reader == nullptr || reader->sampleRate <= 0)
+    {
+        return false;
+    }
+    metadata.sampleRate = reader->sampleRate;
+    metadata.numChannels = int(reader->numChannels);
+    metadata.lengthInSeconds = double(reader->lengthInSamples) / reader->sampleRate;
+
+    // Ogg Vorbis comments are exposed under these keys
+    if (metadata.title.isEmpty())
+    {
+        metadata.title = reader->metadataValues.getValue("id3title", {});
+    }
+    if (metadata.artist.isEmpty())
+    {
+        metadata.artist = reader->metadataValues.getValue("id3artist", {});
+    }
+    return true;
+}
+
+void MetadataProbe::readId3v2(juce::InputStream& in, TrackMetadata& metadata) const
+{
+    juce::uint8 header[10];
+    if (in.read(header, 10) != 10 || header[0] != 'I' || header[1] != 'D' || header[2] != '3')
+    {
+        return;
+    }
+    int majorVersion = header[3];
+    int flags = header[5];
+    juce::int64 tagEnd = in.getPosition() + readSyncSafe(header + 6);
+
+    if ((flags & 0x40) != 0) // extended header
+    {
+        juce::uint8 sizeBytes[4];
+        in.read(sizeBytes, 4);
+        if (majorVersion >= 4)
+        {
+            in.skipNextBytes(readSyncSafe(sizeBytes) - 4);
+        }
+        else
+        {
+            in.skipNextBytes(readBigEndian(sizeBytes, 4));
+        }
+    }
+
+    // ID3v2.2 uses 3 character frame IDs and 3 byte sizes
+    bool isV22 = majorVersion == 2;
+    int idLength = isV22 ? 3 : 4;
+    int frameHeaderSize = isV22 ? 6 : 10;
+
+    while (in.getPosition() + frameHeaderSize <= tagEnd)
+    {
+        juce::uint8 frameHeader[10];
+        in.read(frameHeader, frameHeaderSize);
+        if (frameHeader[0] == 0) // reached the padding
+        {
+            break;
+        }
+
+        juce::String frameId{ reinterpret_cast<const char*>(frameHeader), size_t(idLength) };
+        juce::int64 frameSize;
+        if (isV22)
+        {
+            frameSize = readBigEndian(frameHeader + 3, 3);
+        }
+        else if (majorVersion >= 4)
+        {
+            frameSize = readSyncSafe(frameHeader + 4);
+        }
+        else
+        {
+            frameSize = readBigEndian(frameHeader + 4, 4);
+        }
+        juce::int64 nextFrame = in.getPosition() + frameSize;
+
+        bool isTitle = frameId == "TIT2" || frameId == "TT2";
+        bool isArtist = frameId == "TPE1" || frameId == "TP1";
+        bool isBpm = frameId == "TBPM" || frameId == "TBP";
+        if ((isTitle || isArtist || isBpm) && frameSize > 0 && frameSize < 4096)
+        {
+            juce::HeapBlock<juce::uint8> data(size_t(frameSize));
+            in.read(data, int(frameSize));
+            auto text = decodeId3Text(data, int(frameSize));
+            if (isTitle)        { metadata.title = text; }
+            else if (isArtist)  { metadata.artist = text; }
+            else                { metadata.bpm = text.getDoubleValue(); }
+        }
+
+        // artwork and other large frames are skipped without being read
+        if (frameSize <= 0 || nextFrame > tagEnd || !in.setPosition(nextFrame))
+        {
+            break;
+        }
+    }
+    in.setPosition(tagEnd);
+}
+
+void MetadataProbe::readId3v1(juce::InputStream& in, TrackMetadata& metadata) const
+{
+    if (in.getTotalLength() < 128 || (metadata.title.isNotEmpty() && metadata.artist.isNotEmpty()))
+    {
+        return;
+    }
+    juce::uint8 tag[128];
+    in.setPosition(in.getTotalLength() - 128);
+    if (in.read(tag, 128) != 128 || tag[0] != 'T' || tag[1] != 'A' || tag[2] != 'G')
+    {
+        return;
+    }
+    if (metadata.title.isEmpty())
+    {
+        metadata.title = latin1ToString(tag + 3, 30).trim();
+    }
+    if (metadata.artist.isEmpty())
+    {
+        metadata.artist = latin1ToString(tag + 33, 30).trim();
+    }
+}
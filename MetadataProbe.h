@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    MetadataProbe.h
+    Created: 9 Apr 2023 2:37:05pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**Everything the library needs to know about a file before it is played*/
+struct TrackMetadata
+{
+    double lengthInSeconds{ 0.0 };
+    double sampleRate{ 0.0 };
+    int numChannels{ 0 };
+    juce::String title;
+    juce::String artist;
+    double bpm{ 0.0 };
+    bool isVariableBitRate{ false };
+};
+
+//==============================================================================
+/*
+    Reads track metadata straight from the container headers without creating
+    a decoder. WAV, AIFF, FLAC and MP3 (Xing/Info, VBRI, ID3v1 and ID3v2) are
+    parsed directly, anything else falls back to an AudioFormatReader.
+    Holds no state, so one probe can be shared between threads.
+*/
+class MetadataProbe
+{
+    public:
+        MetadataProbe(juce::AudioFormatManager& _formatManager);
+
+        /**Fills in the metadata for a file, returns false if it couldn't be read*/
+        bool probe(const juce::File& file, TrackMetadata& metadata) const;
+
+    private:
+        bool probeWav(juce::InputStream& in, TrackMetadata& metadata) const;
+        bool probeAiff(juce::InputStream& in, TrackMetadata& metadata) const;
+        bool probeFlac(juce::InputStream& in, TrackMetadata& metadata) const;
+        bool probeMp3(juce::InputStream& in, juce::int64 audioStart, TrackMetadata& metadata) const;
+        bool probeWithReader(const juce::File& file, TrackMetadata& metadata) const;
+
+        /**Reads the title, artist and BPM frames of an ID3v2 tag at the current position*/
+        void readId3v2(juce::InputStream& in, TrackMetadata& metadata) const;
+        /**Reads the title and artist of an ID3v1 tag at the end of the stream*/
+        void readId3v1(juce::InputStream& in, TrackMetadata& metadata) const;
+
+        juce::AudioFormatManager& formatManager;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MetadataProbe)
+};
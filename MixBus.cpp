@@ -0,0 +1,147 @@
+/*
+  ==============================================================================
+
+    MixBus.cpp
+    Created: 6 Aug 2023 4:18:23pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "MixBus.h"
+
+MixBus::MixBus()
+{
+    parameters.change([](Parameters& p)
+    {
+        p.channelGains.fill(1.0f);
+        for (size_t channel = 0; channel < p.sides.size(); ++channel)
+        {
+            p.sides[channel] = channel % 2 == 0 ? Side::a : Side::b;
+        }
+    });
+    audioParameters = parameters.get();
+}
+
+void MixBus::prepareToPlay(double sampleRate)
+{
+    rampSamples = juce::jmax(1, juce::roundToInt(sampleRate * rampSeconds));
+    parameters.pull(audioParameters);
+    updateTargets(true);
+}
+
+void MixBus::setChannelGain(int channel, float gain)
+{
+    jassert(channel >= 0 && channel < maxChannels);
+    parameters.change([channel, gain](Parameters& p) { p.channelGains[size_t(channel)] = gain; });
+}
+
+void MixBus::setChannelSide(int channel, Side side)
+{
+    jassert(channel >= 0 && channel < maxChannels);
+    parameters.change([channel, side](Parameters& p) { p.sides[size_t(channel)] = side; });
+}
+
+void MixBus::setCrossfader(float position)
+{
+    parameters.change([position](Parameters& p) { p.crossfader = juce::jlimit(0.0f, 1.0f, position); });
+}
+
+void MixBus::setCrossfaderCurve(CrossfaderCurve curve)
+{
+    parameters.change([curve](Parameters& p) { p.curve = curve; });
+}
+
+void MixBus::setMasterGain(float gain)
+{
+    parameters.change([gain](Parameters& p) { p.masterGain = gain; });
+}
+
+float MixBus::getCrossfaderGain(CrossfaderCurve curve, Side side, float position)
+{
+    if (side == Side::thru)
+    {
+        return 1.0f;
+    }
+    // how far the crossfader is towards this side, 1 when it's all the way over
+    float towards = side == Side::a ? 1.0f - position : position;
+    switch (curve)
+    {
+        case CrossfaderCurve::linear:
+            return towards;
+        case CrossfaderCurve::constantPower:
+            return std::sin(towards * juce::MathConstants<float>::halfPi);
+        case CrossfaderCurve::cut:
+            return juce::jlimit(0.0f, 1.0f, towards / cutWidth);
+    }
+    return 1.0f;
+}
+
+void MixBus::updateTargets(bool jumpToValues)
+{
+    for (size_t channel = 0; channel < ramps.size(); ++channel)
+    {
+        auto& ramp = ramps[channel];
+        float target = audioParameters.channelGains[channel]
+                       * getCrossfaderGain(audioParameters.curve, audioParameters.sides[channel], audioParameters.crossfader)
+                       * audioParameters.masterGain;
+        if (jumpToValues)
+        {
+            ramp.current = ramp.target = target;
+            ramp.remaining = 0;
+        }
+        else if (target != ramp.target)
+        {
+            // from wherever the last ramp had got to
+            ramp.target = target;
+            ramp.remaining = rampSamples;
+            ramp.step = (target - ramp.current) / float(rampSamples);
+        }
+    }
+}
+
+void MixBus::process(const juce::AudioSourceChannelInfo& bufferToFill,
+                     juce::AudioBuffer<float>* const* inputs,
+                     int numInputs)
+{
+    jassert(numInputs <= maxChannels);
+    if (parameters.pull(audioParameters))
+    {
+        updateTargets(false);
+    }
+
+    int numSamples = bufferToFill.numSamples;
+    std::array<int, maxChannels> used;
+    std::array<float, maxChannels> gainStart, gainStep, gainEnd;
+    int numUsed = 0;
+    for (int input = 0; input < numInputs; ++input)
+    {
+        auto& ramp = ramps[size_t(input)];
+        float start = ramp.current + ramp.step * float(ramp.remaining > 0 ? 1 : 0);
+        float end = ramp.remaining > numSamples ? ramp.current + ramp.step * float(numSamples) : ramp.target;
+        if (start != 0.0f || end != 0.0f)
+        {
+            used[size_t(numUsed)] = input;
+            gainStart[size_t(numUsed)] = start;
+            gainStep[size_t(numUsed)] = ramp.remaining > 0 ? ramp.step : 0.0f;
+            gainEnd[size_t(numUsed)] = end;
+            ++numUsed;
+        }
+
+        ramp.current = end;
+        ramp.remaining = juce::jmax(0, ramp.remaining - numSamples);
+    }
+
+    auto& output = *bufferToFill.buffer;
+    std::array<const float*, maxChannels> sources;
+    for (int channel = 0; channel < output.getNumChannels(); ++channel)
+    {
+        for (int source = 0; source < numUsed; ++source)
+        {
+            auto* input = inputs[used[size_t(source)]];
+            sources[size_t(source)] = input->getReadPointer(juce::jmin(channel, input->getNumChannels() - 1));
+        }
+        SimdOps::mixWithRamps(output.getWritePointer(channel, bufferToFill.startSample), sources.data(),
+                              gainStart.data(), gainStep.data(), gainEnd.data(), numUsed, numSamples);
+    }
+}
@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    MixBus.h
+    Created: 6 Aug 2023 4:18:23pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include "ParameterStore.h"
+#include "SimdOps.h"
+
+//==============================================================================
+/*
+    The last stage before the output: each channel's fader, the crossfader
+    and the master gain, multiplied into one gain per channel and applied
+    while the channels are summed, in a single vector pass over each output
+    channel straight from the decks' own buffers.
+
+    When any of them moves, a channel's gain ramps to its new value over a
+    few milliseconds from the exact sample the block starts on, short enough
+    for cuts on the crossfader and long enough not to click. Channels that
+    are silent at both ends of the block are left out of the sum.
+
+    Every channel is on side A or B of the crossfader, or thru if it should
+    ignore it. Even channels start on A and odd ones on B, so decks 1 and 2
+    are either side.
+*/
+class MixBus
+{
+    public:
+        enum class CrossfaderCurve
+        {
+            linear,
+            /**Sine and cosine, so the power stays the same across the fade*/
+            constantPower,
+            /**Both sides at full until the last few percent of the travel*/
+            cut
+        };
+
+        enum class Side
+        {
+            a,
+            b,
+            thru
+        };
+
+        static constexpr int maxChannels = SimdOps::maxMixSources;
+
+        MixBus();
+
+        /**Jumps straight to the current gains rather than ramping*/
+        void prepareToPlay(double sampleRate);
+
+        /**Message thread: sets a channel's fader, from 0 to 1*/
+        void setChannelGain(int channel, float gain);
+        /**Message thread: puts a channel on one side of the crossfader*/
+        void setChannelSide(int channel, Side side);
+        /**Message thread: 0 is all the way to side A, 1 all the way to side B*/
+        void setCrossfader(float position);
+        void setCrossfaderCurve(CrossfaderCurve curve);
+        /**Message thread: sets the gain of the whole mix*/
+        void setMasterGain(float gain);
+
+        /**The gain a channel on a side gets with the crossfader at a position*/
+        static float getCrossfaderGain(CrossfaderCurve curve, Side side, float position);
+
+        /**Audio thread: overwrites the block with the sum of the inputs, input n
+           on channel n. Each input has at least as many samples as the block*/
+        void process(const juce::AudioSourceChannelInfo& bufferToFill,
+                     juce::AudioBuffer<float>* const* inputs,
+                     int numInputs);
+
+    private:
+        struct Parameters
+        {
+            std::array<float, maxChannels> channelGains;
+            std::array<Side, maxChannels> sides;
+            float crossfader{ 0.5f };
+            CrossfaderCurve curve{ CrossfaderCurve::cut };
+            float masterGain{ 1.0f };
+        };
+
+        /**A channel's gain, as of the last sample of the previous block*/
+        struct Ramp
+        {
+            float current{ 1.0f };
+            float target{ 1.0f };
+            float step{ 0.0f };
+            int remaining{ 0 };
+        };
+
+        /**Audio thread: starts ramps to the gains the parameters give*/
+        void updateTargets(bool jumpToValues);
+
+        ParameterStore<Parameters> parameters;
+        /**The audio thread's copy of the parameters*/
+        Parameters audioParameters;
+        std::array<Ramp, maxChannels> ramps;
+        int rampSamples{ 441 };
+        static constexpr double rampSeconds = 0.01;
+        /**How much of the crossfader's travel the cut curve fades over*/
+        static constexpr float cutWidth = 1.0f / 32.0f;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MixBus)
+};
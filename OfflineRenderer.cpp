@@ -0,0 +1,237 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.cpp
+    Created: 18 Jun 2023 4:21:09pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+#include <algorithm>
+
+namespace
+{
+    const std::pair<const char*, OfflineRenderer::Action> actionNames[] = {
+        { "load", OfflineRenderer::Action::load },
+        { "play", OfflineRenderer::Action::play },
+        { "stop", OfflineRenderer::Action::stop },
+        { "seek", OfflineRenderer::Action::seek },
+        { "gain", OfflineRenderer::Action::gain },
+        { "speed", OfflineRenderer::Action::speed },
+        { "roomSize", OfflineRenderer::Action::roomSize },
+        { "damping", OfflineRenderer::Action::damping },
+        { "wetLevel", OfflineRenderer::Action::wetLevel },
+        { "dryLevel", OfflineRenderer::Action::dryLevel },
+        { "grid", OfflineRenderer::Action::grid },
+        { "keyLock", OfflineRenderer::Action::keyLock },
+        { "sync", OfflineRenderer::Action::sync },
+        { "syncMaster", OfflineRenderer::Action::syncMaster },
+        { "send", OfflineRenderer::Action::send },
+        { "crossfader", OfflineRenderer::Action::crossfader },
+        { "master", OfflineRenderer::Action::master }
+    };
+}
+
+//==============================================================================
+OfflineRenderer::OfflineRenderer(juce::AudioFormatManager& _formatManager,
+                                 int _numDecks,
+                                 double _sampleRate,
+                                 int _blockSize
+                                ) : formatManager(_formatManager),
+                                    numDecks(juce::jlimit(1, maxDecks, _numDecks)),
+                                    sampleRate(_sampleRate),
+                                    blockSize(juce::jmax(1, _blockSize))
+{
+}
+
+juce::Result OfflineRenderer::parseScript(const juce::String& script, std::vector<Event>& events)
+{
+    juce::StringArray lines;
+    lines.addLines(script);
+    for (int i = 0; i < lines.size(); ++i)
+    {
+        juce::String line = lines[i].trim();
+        if (line.isEmpty() || line.startsWith("#"))
+        {
+            continue;
+        }
+
+        auto tokens = juce::StringArray::fromTokens(line, " \t", "\"");
+        tokens.removeEmptyStrings();
+        auto lineError = [i, &line] { return juce::Result::fail("line " + juce::String(i + 1) + ": " + line); };
+        if (tokens.size() < 3)
+        {
+            return lineError();
+        }
+
+        Event event;
+        event.timeInSeconds = tokens[0].getDoubleValue();
+        event.deck = tokens[1].getIntValue() - 1;
+        auto name = std::find_if(std::begin(actionNames), std::end(actionNames),
+                                 [&tokens](const auto& action) { return tokens[2] == action.first; });
+        if (name == std::end(actionNames) || event.timeInSeconds < 0)
+        {
+            return lineError();
+        }
+        event.action = name->second;
+        // the crossfader and master take any deck, as they act on the whole mix
+        if (event.deck < 0 && event.action != Action::crossfader && event.action != Action::master)
+        {
+            return lineError();
+        }
+
+        // a path is the rest of the line, so it can contain spaces
+        juce::String value = line.fromFirstOccurrenceOf(tokens[2], false, false).trim().unquoted();
+        if (event.action == Action::load)
+        {
+            event.file = juce::File{ value };
+        }
+        else
+        {
+            event.value = value.getDoubleValue();
+            event.firstDownbeat = tokens[4].getDoubleValue();
+        }
+        events.push_back(event);
+    }
+    return juce::Result::ok();
+}
+
+OfflineRenderer::Result OfflineRenderer::render(std::vector<Event> events,
+                                                double lengthInSeconds,
+                                                const juce::File& outputFile)
+{
+    Result result;
+    outputFile.deleteFile();
+    std::unique_ptr<juce::OutputStream> stream{ outputFile.createOutputStream() };
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer{ stream != nullptr
+        ? wav.createWriterFor(stream.get(), sampleRate, 2, 24, {}, 0)
+        : nullptr };
+    if (writer == nullptr)
+    {
+        DBG("OfflineRenderer::render can't write to " << outputFile.getFullPathName());
+        return result;
+    }
+    stream.release(); // the writer owns it now
+
+    // wired up as MainComponent does, with no workers so every deck renders
+    // on this thread and none is ever left out of a block
+    std::vector<std::unique_ptr<DJAudioPlayer>> decks;
+    DeckEngine engine{ 0 };
+    SendReverb sendReverb;
+    BeatSync beatSync;
+    for (int i = 0; i < numDecks; ++i)
+    {
+        decks.push_back(std::make_unique<DJAudioPlayer>(formatManager));
+        decks.back()->setMixBus(&engine.getMixBus(), i);
+        decks.back()->setBeatSync(&beatSync, i);
+        decks.back()->setSendBus(&sendReverb, i);
+        engine.addInput(decks.back().get());
+    }
+    engine.setSendReverb(&sendReverb);
+    engine.prepareToPlay(blockSize, sampleRate);
+    sendReverb.prepareToPlay(blockSize, sampleRate);
+    std::vector<Event> grids(size_t(numDecks));
+
+    std::stable_sort(events.begin(), events.end(),
+                     [](const Event& a, const Event& b) { return a.timeInSeconds < b.timeInSeconds; });
+    auto eventSample = [this](const Event& event) { return juce::int64(event.timeInSeconds * sampleRate); };
+
+    juce::AudioBuffer<float> buffer{ 2, blockSize };
+    auto totalSamples = juce::int64(lengthInSeconds * sampleRate);
+    juce::int64 position = 0;
+    size_t nextEvent = 0;
+    auto startTicks = juce::Time::getHighResolutionTicks();
+
+    while (position < totalSamples)
+    {
+        while (nextEvent < events.size() && eventSample(events[nextEvent]) <= position)
+        {
+            applyEvent(events[nextEvent++], decks, engine.getMixBus(), grids);
+        }
+
+        // blocks are cut short at the next event so it lands on its exact sample
+        auto numSamples = juce::jmin(juce::int64(blockSize), totalSamples - position);
+        if (nextEvent < events.size())
+        {
+            numSamples = juce::jmin(numSamples, eventSample(events[nextEvent]) - position);
+        }
+        engine.getNextAudioBlock(juce::AudioSourceChannelInfo(&buffer, 0, int(numSamples)));
+        writer->writeFromAudioSampleBuffer(buffer, 0, int(numSamples));
+        position += numSamples;
+    }
+
+    result.renderSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    result.audioSeconds = double(totalSamples) / sampleRate;
+    result.realtimeFactor = result.audioSeconds / juce::jmax(result.renderSeconds, 1.0e-9);
+    for (auto& deck : decks)
+    {
+        result.underruns += deck->getNumUnderruns();
+    }
+    result.succeeded = true;
+
+    engine.releaseResources();
+    sendReverb.releaseResources();
+    return result;
+}
+
+void OfflineRenderer::applyEvent(const Event& event,
+                                 std::vector<std::unique_ptr<DJAudioPlayer>>& decks,
+                                 MixBus& mixBus,
+                                 std::vector<Event>& grids)
+{
+    switch (event.action)
+    {
+        case Action::crossfader:    mixBus.setCrossfader(float(event.value)); return;
+        case Action::master:        mixBus.setMasterGain(float(event.value)); return;
+        default:                    break;
+    }
+    if (event.deck >= int(decks.size()))
+    {
+        DBG("OfflineRenderer::applyEvent there is no deck " << event.deck + 1);
+        return;
+    }
+    DJAudioPlayer& deck = *decks[size_t(event.deck)];
+    switch (event.action)
+    {
+        case Action::load:
+        {
+            // played from the mapped file or decoded up front, and a file too big
+            // for the cache is read in the callback itself, so nothing ever races
+            // the read-ahead thread and every render comes out the same
+            const auto& grid = grids[size_t(event.deck)];
+            if (DJAudioPlayer::createMappedReader(formatManager, event.file) != nullptr)
+            {
+                deck.loadURL(juce::URL{ event.file }, grid.value, grid.firstDownbeat);
+            }
+            else if (auto decoded = decodedAudio->getOrDecode(event.file, formatManager))
+            {
+                deck.loadDecodedAudio(std::move(decoded), grid.value, grid.firstDownbeat);
+            }
+            else
+            {
+                deck.loadWithoutReadAhead(event.file, grid.value, grid.firstDownbeat);
+            }
+            grids[size_t(event.deck)] = {};
+            break;
+        }
+        case Action::grid:          grids[size_t(event.deck)] = event; break;
+        case Action::play:          deck.play(); break;
+        case Action::stop:          deck.stop(); break;
+        case Action::seek:          deck.setPositionRelative(event.value); break;
+        case Action::gain:          deck.setGain(event.value); break;
+        case Action::speed:         deck.setSpeed(event.value); break;
+        case Action::roomSize:      deck.setRoomSize(float(event.value)); break;
+        case Action::damping:       deck.setDamping(float(event.value)); break;
+        case Action::wetLevel:      deck.setWetLevel(float(event.value)); break;
+        case Action::dryLevel:      deck.setDryLevel(float(event.value)); break;
+        case Action::keyLock:       deck.setKeyLock(event.value != 0.0); break;
+        case Action::sync:          deck.setSync(event.value != 0.0); break;
+        case Action::syncMaster:    deck.setSyncMaster(event.value != 0.0); break;
+        case Action::send:          deck.setReverbSend(event.value != 0.0); break;
+        case Action::crossfader:
+        case Action::master:        break;
+    }
+}
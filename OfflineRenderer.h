@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.h
+    Created: 18 Jun 2023 4:21:09pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+#include "DJAudioPlayer.h"
+#include "DeckEngine.h"
+#include "BeatSync.h"
+
+//==============================================================================
+/*
+    Runs the decks and the mixer without an audio device, as fast as the
+    CPU allows, and writes the mix to a WAV file. The mix goes through the
+    same deck engine, mix bus and shared reverb as the app's, with every
+    deck rendered on the one thread so nothing is ever late.
+
+    What the decks do is given as a list of timed events, applied at the
+    exact sample they fall on, so the same events always render the same
+    mix. A script of events has one per line:
+
+        <seconds> <deck> <action> [value]
+
+    where deck counts from 1 and action is one of load (value is a file
+    path), grid (the bpm and first downbeat of the deck's next load, for
+    sync), play, stop, seek (0 to 1), gain, speed, roomSize, damping,
+    wetLevel, dryLevel, keyLock, sync, syncMaster or send (1 for on, 0 for
+    off), crossfader (0 to 1) or master. The crossfader and master act on
+    the whole mix and ignore the deck. Blank lines and lines starting with
+    # are skipped.
+*/
+class OfflineRenderer
+{
+    public:
+        enum class Action
+        {
+            load,
+            play,
+            stop,
+            seek,
+            gain,
+            speed,
+            roomSize,
+            damping,
+            wetLevel,
+            dryLevel,
+            grid,
+            keyLock,
+            sync,
+            syncMaster,
+            send,
+            crossfader,
+            master
+        };
+
+        struct Event
+        {
+            double timeInSeconds{ 0.0 };
+            /**counts from 0*/
+            int deck{ 0 };
+            Action action{ Action::play };
+            double value{ 0.0 };
+            /**Only for grid, whose bpm is the value*/
+            double firstDownbeat{ 0.0 };
+            juce::File file;
+        };
+
+        struct Result
+        {
+            bool succeeded{ false };
+            double audioSeconds{ 0.0 };
+            double renderSeconds{ 0.0 };
+            /**Seconds of audio rendered per second of wall clock time*/
+            double realtimeFactor{ 0.0 };
+            /**Blocks a streamed deck played without enough audio decoded*/
+            int underruns{ 0 };
+        };
+
+        static constexpr int maxDecks = juce::jmin(SendReverb::maxSenders, BeatSync::maxDecks);
+
+        OfflineRenderer(juce::AudioFormatManager& _formatManager,
+                        int _numDecks = 2,
+                        double _sampleRate = 44100.0,
+                        int _blockSize = 512);
+
+        /**Reads a script of events, see above*/
+        static juce::Result parseScript(const juce::String& script, std::vector<Event>& events);
+        /**Renders lengthInSeconds of the mix to a 24 bit stereo WAV file*/
+        Result render(std::vector<Event> events, double lengthInSeconds, const juce::File& outputFile);
+
+    private:
+        /**grids holds each deck's grid event for its next load*/
+        void applyEvent(const Event& event,
+                        std::vector<std::unique_ptr<DJAudioPlayer>>& decks,
+                        MixBus& mixBus,
+                        std::vector<Event>& grids);
+
+        juce::AudioFormatManager& formatManager;
+        juce::SharedResourcePointer<DecodedAudioCache> decodedAudio;
+        int numDecks;
+        double sampleRate;
+        int blockSize;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OfflineRenderer)
+};
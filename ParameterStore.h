@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    ParameterStore.h
+    Created: 28 May 2023 11:34:02am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+//==============================================================================
+/*
+    Hands a set of parameters from the message thread to the audio thread
+    without either side taking a lock.
+
+    The message thread edits its own copy and publishes the whole set into
+    a triple buffer. The audio thread picks the newest set up once per
+    block, so it never waits and never sees half an update. Edits made
+    inside a batch are published together when the batch ends.
+
+    Parameters must be trivially copyable.
+*/
+template <typename Parameters>
+class ParameterStore
+{
+    public:
+        ParameterStore()
+        {
+            buffers.fill(current);
+        }
+
+        /**Message thread: the values as last edited, published or not*/
+        const Parameters& get() const
+        {
+            return current;
+        }
+
+        /**Message thread: edits the values, publishing them unless a batch is open*/
+        template <typename Change>
+        void change(Change&& applyChange)
+        {
+            applyChange(current);
+            if (batchDepth == 0)
+            {
+                publish();
+            }
+        }
+
+        /**Message thread: holds back publishing until the matching endBatch*/
+        void beginBatch()
+        {
+            ++batchDepth;
+        }
+
+        void endBatch()
+        {
+            jassert(batchDepth > 0);
+            if (--batchDepth == 0)
+            {
+                publish();
+            }
+        }
+
+        /**Audio thread: copies the newest published values. Returns false if
+           nothing was published since the last call*/
+        bool pull(Parameters& destination)
+        {
+            if ((middle.load(std::memory_order_relaxed) & newDataFlag) == 0)
+            {
+                return false;
+            }
+            readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+            destination = buffers[size_t(readIndex)];
+            return true;
+        }
+
+    private:
+        void publish()
+        {
+            buffers[size_t(writeIndex)] = current;
+            writeIndex = middle.exchange(writeIndex | newDataFlag, std::memory_order_acq_rel) & indexMask;
+        }
+
+        static_assert(std::is_trivially_copyable<Parameters>::value, "parameters are copied between threads");
+
+        static constexpr int indexMask = 3;
+        static constexpr int newDataFlag = 4;
+
+        Parameters current{};
+        std::array<Parameters, 3> buffers;
+        /**Only touched by the message thread*/
+        int writeIndex{ 0 };
+        int batchDepth{ 0 };
+        /**The buffer between the two threads, plus whether it holds unread values*/
+        std::atomic<int> middle{ 1 };
+        /**Only touched by the audio thread*/
+        int readIndex{ 2 };
+
+        JUCE_DECLARE_NON_COPYABLE (ParameterStore)
+};
@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    PeakCache.cpp
+    Created: 14 May 2023 10:02:51am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "PeakCache.h"
+
+namespace
+{
+    const char peakFileMagic[4] = { 'D', 'J', 'P', 'K' };
+    const juce::uint32 peakFileVersion = 1;
+    const size_t peakFileHeaderSize = 8;
+}
+
+//==============================================================================
+PeakCache::PeakCache(int maxThumbsInMemory,
+                     juce::File _directory
+                    ) : juce::AudioThumbnailCache(maxThumbsInMemory),
+                        directory(_directory)
+{
+}
+
+juce::File PeakCache::getPeakFile(juce::int64 hashCode) const
+{
+    return directory.getChildFile(juce::String::toHexString(hashCode) + ".peaks");
+}
+
+void PeakCache::saveNewlyFinishedThumbnail(const juce::AudioThumbnailBase& thumb, juce::int64 hashCode)
+{
+    // this is called on the thumbnail thread, so writing here doesn't hold up the UI
+    juce::File peakFile = getPeakFile(hashCode);
+    if (peakFile.existsAsFile() || !directory.createDirectory())
+    {
+        return;
+    }
+
+    juce::MemoryOutputStream peaks;
+    peaks.write(peakFileMagic, sizeof(peakFileMagic));
+    peaks.writeInt(int(peakFileVersion));
+    thumb.saveTo(peaks);
+
+    // written to a temporary file first so a half written file is never read
+    juce::TemporaryFile temp{ peakFile };
+    if (temp.getFile().replaceWithData(peaks.getData(), peaks.getDataSize())
+        && temp.overwriteTargetFileWithTemporary())
+    {
+        DBG("PeakCache saved " << peakFile.getFileName() << " (" << int(peaks.getDataSize()) << " bytes)");
+    }
+}
+
+bool PeakCache::loadNewThumb(juce::AudioThumbnailBase& thumb, juce::int64 hashCode)
+{
+    juce::File peakFile = getPeakFile(hashCode);
+    {
+        juce::MemoryMappedFile mapped{ peakFile, juce::MemoryMappedFile::readOnly };
+        auto* data = static_cast<const char*>(mapped.getData());
+        if (data == nullptr)
+        {
+            return false;
+        }
+
+        juce::MemoryInputStream in{ data, mapped.getSize(), false };
+        char magic[4] = {};
+        in.read(magic, sizeof(magic));
+        if (mapped.getSize() > peakFileHeaderSize
+            && std::memcmp(magic, peakFileMagic, sizeof(magic)) == 0
+            && juce::uint32(in.readInt()) == peakFileVersion
+            && thumb.loadFrom(in))
+        {
+            return true;
+        }
+    }
+
+    // unmapped before it is deleted, so it is written again next time
+    DBG("PeakCache::loadNewThumb discarding " << peakFile.getFileName());
+    peakFile.deleteFile();
+    return false;
+}
+
+//==============================================================================
+PeakCache::Source::Source(juce::File _file,
+                          juce::uint64 _contentHash
+                         ) : file(_file),
+                             contentHash(_contentHash)
+{
+}
+
+juce::InputStream* PeakCache::Source::createInputStream()
+{
+    return file.createInputStream().release();
+}
+
+juce::InputStream* PeakCache::Source::createInputStreamFor(const juce::String& relatedItemPath)
+{
+    return file.getSiblingFile(relatedItemPath).createInputStream().release();
+}
+
+juce::int64 PeakCache::Source::hashCode() const
+{
+    return juce::int64(contentHash);
+}
@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    PeakCache.h
+    Created: 14 May 2023 10:02:51am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    A thumbnail cache that also keeps every finished waveform on disk, so a
+    track that has been seen before shows its waveform straight away, even
+    after a restart, instead of being decoded again.
+
+    Peak files are named after the content hash of the audio file, so a
+    track that is moved or renamed still finds its peaks while an edited
+    one gets new ones. They are written on the thumbnail thread once a
+    waveform is finished and memory-mapped when read back.
+*/
+class PeakCache : public juce::AudioThumbnailCache
+{
+    public:
+        PeakCache(int maxThumbsInMemory, juce::File _directory);
+
+        /**A local audio file identified by the hash of its content rather
+           than its path*/
+        class Source : public juce::InputSource
+        {
+            public:
+                Source(juce::File _file, juce::uint64 _contentHash);
+
+                juce::InputStream* createInputStream() override;
+                juce::InputStream* createInputStreamFor(const juce::String& relatedItemPath) override;
+                juce::int64 hashCode() const override;
+
+            private:
+                juce::File file;
+                juce::uint64 contentHash;
+        };
+
+        /**Gets the peak file for a content hash, which may not exist yet*/
+        juce::File getPeakFile(juce::int64 hashCode) const;
+
+    protected:
+        void saveNewlyFinishedThumbnail(const juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+        bool loadNewThumb(juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+
+    private:
+        juce::File directory;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PeakCache)
+};
@@ -0,0 +1,245 @@
+/*
+  ==============================================================================
+
+    PeakPyramid.cpp
+    Created: 21 May 2023 3:40:17pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "PeakPyramid.h"
+#include "SimdOps.h"
+
+namespace
+{
+    const char pyramidMagic[4] = { 'D', 'J', 'P', 'Y' };
+    const juce::uint32 pyramidVersion = 1;
+
+    juce::int8 quantiseSample(float sample)
+    {
+        return juce::int8(juce::jlimit(-127, 127, juce::roundToInt(sample * 127.0f)));
+    }
+}
+
+//==============================================================================
+PeakPyramid::PeakPyramid()
+{
+}
+
+bool PeakPyramid::build(juce::AudioFormatReader& reader, const std::function<bool()>& shouldExit)
+{
+    clear();
+    const int blockSize = finestSamplesPerBin * 1024;
+    juce::AudioBuffer<float> buffer{ juce::jmax(1, int(reader.numChannels)), blockSize };
+    std::array<Pending, numLevels> pending;
+
+    for (juce::int64 position = 0; position < reader.lengthInSamples; position += blockSize)
+    {
+        if (shouldExit())
+        {
+            clear();
+            return false;
+        }
+        int numSamples = int(juce::jmin(juce::int64(blockSize), reader.lengthInSamples - position));
+        reader.read(&buffer, 0, numSamples, position, true, true);
+        addSamples(pending, buffer, 0, numSamples);
+    }
+    finish(pending, reader.sampleRate, reader.lengthInSamples);
+    return true;
+}
+
+bool PeakPyramid::build(const juce::AudioBuffer<float>& samples, double newSampleRate,
+                        const std::function<bool()>& shouldExit)
+{
+    clear();
+    const int blockSize = finestSamplesPerBin * 1024;
+    std::array<Pending, numLevels> pending;
+
+    for (int position = 0; position < samples.getNumSamples(); position += blockSize)
+    {
+        if (shouldExit())
+        {
+            clear();
+            return false;
+        }
+        addSamples(pending, samples, position, juce::jmin(blockSize, samples.getNumSamples() - position));
+    }
+    finish(pending, newSampleRate, samples.getNumSamples());
+    return true;
+}
+
+void PeakPyramid::saveTo(juce::OutputStream& out) const
+{
+    out.write(pyramidMagic, sizeof(pyramidMagic));
+    out.writeInt(int(pyramidVersion));
+    out.writeDouble(sampleRate);
+    out.writeInt64(lengthInSamples);
+    for (const auto& bins : levels)
+    {
+        out.writeInt(int(bins.size()));
+        out.write(bins.data(), bins.size() * sizeof(Bin));
+    }
+}
+
+bool PeakPyramid::loadFrom(juce::InputStream& in)
+{
+    clear();
+    char magic[4] = {};
+    in.read(magic, sizeof(magic));
+    if (std::memcmp(magic, pyramidMagic, sizeof(magic)) != 0
+        || juce::uint32(in.readInt()) != pyramidVersion)
+    {
+        return false;
+    }
+
+    double newSampleRate = in.readDouble();
+    juce::int64 newLength = in.readInt64();
+    for (auto& bins : levels)
+    {
+        auto numBins = juce::int64(juce::uint32(in.readInt()));
+        if (numBins * juce::int64(sizeof(Bin)) > in.getNumBytesRemaining())
+        {
+            clear();
+            return false;
+        }
+        bins.resize(size_t(numBins));
+        in.read(bins.data(), int(bins.size() * sizeof(Bin)));
+    }
+    sampleRate = newSampleRate;
+    lengthInSamples = newLength;
+    return true;
+}
+
+bool PeakPyramid::isEmpty() const
+{
+    return levels[0].empty();
+}
+
+double PeakPyramid::getSampleRate() const
+{
+    return sampleRate;
+}
+
+juce::int64 PeakPyramid::getLengthInSamples() const
+{
+    return lengthInSamples;
+}
+
+int PeakPyramid::getSamplesPerBin(int level)
+{
+    int samplesPerBin = finestSamplesPerBin;
+    for (int i = 0; i < level; ++i)
+    {
+        samplesPerBin *= levelRatio;
+    }
+    return samplesPerBin;
+}
+
+int PeakPyramid::chooseLevel(double samplesPerPixel) const
+{
+    int level = 0;
+    while (level + 1 < numLevels && getSamplesPerBin(level + 1) <= samplesPerPixel)
+    {
+        ++level;
+    }
+    return level;
+}
+
+PeakPyramid::Peak PeakPyramid::getPeak(int level, juce::int64 startSample, juce::int64 endSample) const
+{
+    Peak peak;
+    const auto& bins = levels[size_t(level)];
+    juce::int64 samplesPerBin = getSamplesPerBin(level);
+    auto firstBin = juce::jmax(juce::int64(0), startSample / samplesPerBin);
+    auto lastBin = juce::jmin(juce::int64(bins.size()), (endSample + samplesPerBin - 1) / samplesPerBin);
+    if (firstBin >= lastBin)
+    {
+        return peak;
+    }
+
+    int minimum = 127, maximum = -127;
+    float sumOfMeanSquares = 0.0f;
+    for (auto i = firstBin; i < lastBin; ++i)
+    {
+        const Bin& bin = bins[size_t(i)];
+        minimum = juce::jmin(minimum, int(bin.minimum));
+        maximum = juce::jmax(maximum, int(bin.maximum));
+        float rms = bin.rms / 255.0f;
+        sumOfMeanSquares += rms * rms;
+    }
+    peak.minimum = minimum / 127.0f;
+    peak.maximum = maximum / 127.0f;
+    peak.rms = std::sqrt(sumOfMeanSquares / float(lastBin - firstBin));
+    return peak;
+}
+
+void PeakPyramid::addSamples(std::array<Pending, numLevels>& pending, const juce::AudioBuffer<float>& samples,
+                             int startSample, int numSamples)
+{
+    int numChannels = samples.getNumChannels();
+    for (int start = startSample; start < startSample + numSamples; start += finestSamplesPerBin)
+    {
+        int binLength = juce::jmin(finestSamplesPerBin, startSample + numSamples - start);
+        float minimum = 0.0f, maximum = 0.0f, sumOfSquares = 0.0f;
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            float channelMin, channelMax, channelSum;
+            SimdOps::findMinMaxAndSumOfSquares(samples.getReadPointer(channel, start), binLength,
+                                               channelMin, channelMax, channelSum);
+            minimum = channel == 0 ? channelMin : juce::jmin(minimum, channelMin);
+            maximum = channel == 0 ? channelMax : juce::jmax(maximum, channelMax);
+            sumOfSquares += channelSum;
+        }
+        addBin(pending, 0, minimum, maximum, sumOfSquares / float(binLength * juce::jmax(1, numChannels)));
+    }
+}
+
+void PeakPyramid::finish(std::array<Pending, numLevels>& pending, double newSampleRate, juce::int64 newLength)
+{
+    // the end of the track leaves part filled bins on the coarser levels
+    for (int level = 1; level < numLevels; ++level)
+    {
+        Pending& bins = pending[size_t(level)];
+        if (bins.numBins > 0)
+        {
+            addBin(pending, level, bins.minimum, bins.maximum, bins.sumOfMeanSquares / float(bins.numBins));
+        }
+    }
+    sampleRate = newSampleRate;
+    lengthInSamples = newLength;
+}
+
+void PeakPyramid::addBin(std::array<Pending, numLevels>& pending, int level,
+                         float minimum, float maximum, float meanSquare)
+{
+    levels[size_t(level)].push_back({ quantiseSample(minimum),
+                                      quantiseSample(maximum),
+                                      juce::uint8(juce::jlimit(0, 255, juce::roundToInt(std::sqrt(meanSquare) * 255.0f))) });
+    if (level + 1 == numLevels)
+    {
+        return;
+    }
+
+    // every few bins make one bin on the next level up
+    Pending& above = pending[size_t(level + 1)];
+    above.minimum = above.numBins == 0 ? minimum : juce::jmin(above.minimum, minimum);
+    above.maximum = above.numBins == 0 ? maximum : juce::jmax(above.maximum, maximum);
+    above.sumOfMeanSquares += meanSquare;
+    if (++above.numBins == levelRatio)
+    {
+        Pending full = above;
+        above = Pending();
+        addBin(pending, level + 1, full.minimum, full.maximum, full.sumOfMeanSquares / float(levelRatio));
+    }
+}
+
+void PeakPyramid::clear()
+{
+    sampleRate = 0.0;
+    lengthInSamples = 0;
+    for (auto& bins : levels)
+    {
+        bins.clear();
+    }
+}
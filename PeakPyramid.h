@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    PeakPyramid.h
+    Created: 21 May 2023 3:40:17pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <functional>
+#include <vector>
+
+//==============================================================================
+/*
+    The peaks of a whole track at several resolutions, so a waveform can be
+    drawn at any zoom without decoding the track again.
+
+    The finest level has a bin for every 64 samples and each level above it
+    is four times coarser, down to 4096 samples per bin. Every bin holds the
+    minimum, maximum and RMS of all channels, quantised to a byte each.
+*/
+class PeakPyramid
+{
+    public:
+        static constexpr int numLevels = 4;
+        static constexpr int finestSamplesPerBin = 64;
+        static constexpr int levelRatio = 4;
+
+        /**The peaks of a range of samples, from -1 to 1*/
+        struct Peak
+        {
+            float minimum{ 0.0f };
+            float maximum{ 0.0f };
+            float rms{ 0.0f };
+        };
+
+        PeakPyramid();
+
+        /**Reads the whole track and reduces it into every level. Returns false,
+           leaving the pyramid empty, if shouldExit returns true part way through*/
+        bool build(juce::AudioFormatReader& reader, const std::function<bool()>& shouldExit);
+        /**Reduces audio that is already decoded into every level*/
+        bool build(const juce::AudioBuffer<float>& samples, double newSampleRate,
+                   const std::function<bool()>& shouldExit);
+        void saveTo(juce::OutputStream& out) const;
+        bool loadFrom(juce::InputStream& in);
+
+        bool isEmpty() const;
+        double getSampleRate() const;
+        juce::int64 getLengthInSamples() const;
+        static int getSamplesPerBin(int level);
+        /**Picks the coarsest level that still has at least one bin per pixel*/
+        int chooseLevel(double samplesPerPixel) const;
+        /**Combines the bins of a level covering a range of samples*/
+        Peak getPeak(int level, juce::int64 startSample, juce::int64 endSample) const;
+
+    private:
+        struct Bin
+        {
+            juce::int8 minimum;
+            juce::int8 maximum;
+            juce::uint8 rms;
+        };
+        /**Bins of the level below waiting to be combined into one bin*/
+        struct Pending
+        {
+            float minimum{ 0.0f };
+            float maximum{ 0.0f };
+            float sumOfMeanSquares{ 0.0f };
+            int numBins{ 0 };
+        };
+
+        /**Adds the finest bins for a block of samples, which must be a whole
+           number of bins long unless it is the end of the track*/
+        void addSamples(std::array<Pending, numLevels>& pending, const juce::AudioBuffer<float>& samples,
+                        int startSample, int numSamples);
+        /**Adds the part filled bins left on the coarser levels at the end of the track*/
+        void finish(std::array<Pending, numLevels>& pending, double newSampleRate, juce::int64 newLength);
+        void addBin(std::array<Pending, numLevels>& pending, int level,
+                    float minimum, float maximum, float meanSquare);
+        void clear();
+
+        double sampleRate{ 0.0 };
+        juce::int64 lengthInSamples{ 0 };
+        std::array<std::vector<Bin>, numLevels> levels;
+
+        JUCE_LEAK_DETECTOR (PeakPyramid)
+};
@@ -12,45 +12,93 @@
 #include "PlaylistComponent.h"
 
 //==============================================================================
-PlaylistComponent::PlaylistComponent(DeckGUI* _deckGUI1,
-                                     DeckGUI* _deckGUI2,
-                                     DJAudioPlayer* _playerForParsingMetaData
-                                    ) : deckGUI1(_deckGUI1),
-                                        deckGUI2(_deckGUI2),
-                                        playerForParsingMetaData(_playerForParsingMetaData)
+PlaylistComponent::PlaylistComponent(const juce::Array<DeckGUI*>& _deckGUIs,
+                                     juce::AudioFormatManager& formatManager
+                                    ) : deckGUIs(_deckGUIs),
+                                        importer(formatManager),
+                                        analyser(formatManager)
 {
     // In your constructor, you should add any child components, and
     // initialise any special settings that your component needs.
     
     // add components
     addAndMakeVisible(importButton);
+    addChildComponent(cancelImportButton);
+    addChildComponent(importProgressBar);
     addAndMakeVisible(searchField);
     addAndMakeVisible(library);
-    addAndMakeVisible(addToPlayer1Button);
-    addAndMakeVisible(addToPlayer2Button);
+    for (int deck = 0; deck < deckGUIs.size(); ++deck)
+    {
+        // the buttons share one row, so with more decks they only get the number
+        juce::String name = deckGUIs.size() > 2 ? "DECK " : "ADD TO DECK ";
+        addAndMakeVisible(addToDeckButtons.add(new juce::TextButton(name + juce::String(deck + 1))));
+    }
 
     // attach listeners
     importButton.addListener(this);
+    cancelImportButton.addListener(this);
+    importer.addListener(this);
+    analyser.addListener(this);
+    // analysis makes way while any deck is playing
+    analyser.setThrottleCheck([this]
+    {
+        for (auto* deckGUI : deckGUIs)
+        {
+            if (deckGUI->player->isPlaying())
+            {
+                return true;
+            }
+        }
+        return false;
+    });
     searchField.addListener(this);
-    addToPlayer1Button.addListener(this);
-    addToPlayer2Button.addListener(this);
+    for (auto* addToDeckButton : addToDeckButtons)
+    {
+        addToDeckButton->addListener(this);
+    }
 
     // searchField configuration
-    searchField.setTextToShowWhenEmpty("Search Tracks (enter to submit)",
+    searchField.setTextToShowWhenEmpty("Search Tracks",
                                        juce::Colours::white);
-    searchField.onReturnKey = [this] { searchLibrary (searchField.getText()); };
+    searchField.onTextChange = [this] { searchLibrary (searchField.getText()); };
+    searchField.onReturnKey = [this] { library.selectRow(0); };
     
     // setup table and load library from file
     library.getHeader().addColumn("Tracks", 1, 1);
     library.getHeader().addColumn("Length", 2, 1);
-    library.getHeader().addColumn("", 3, 1);
+    library.getHeader().addColumn("BPM", 4, 1);
+    library.getHeader().addColumn("Key", 5, 1);
+    library.getHeader().addColumn("", 3, 1, 30, -1,
+                                  juce::TableHeaderComponent::defaultFlags & ~juce::TableHeaderComponent::sortable);
     library.setModel(this);
     loadLibrary();
+
+    // several files or folders dropped on a deck are imported into the library
+    for (auto* deckGUI : deckGUIs)
+    {
+        deckGUI->onImportFiles = [this](const juce::StringArray& files) { importFiles(files); };
+        // a library track loaded by LOAD or dropped on its own still gets its beat grid
+        deckGUI->findBeatGrid = [this](const juce::File& file, double& bpm, double& firstDownbeat)
+        {
+            auto found = duplicates.find(FileIdentity::read(file, false));
+            int row = found.match == DuplicateIndex::Match::sameFile ? tracks.getRow(found.trackId) : -1;
+            if (row < 0 || !tracks.getBeatGridFound(row))
+            {
+                return false;
+            }
+            bpm = tracks.getBpm(row);
+            firstDownbeat = tracks.getFirstDownbeat(row);
+            return true;
+        };
+    }
 }
 
 PlaylistComponent::~PlaylistComponent()
 {
-    saveLibrary();
+    importer.removeListener(this);
+    importer.cancel();
+    analyser.removeListener(this);
+    analyser.cancel();
 }
 
 void PlaylistComponent::paint (juce::Graphics& g)
@@ -80,27 +128,42 @@ void PlaylistComponent::resized()
 
     //                   x start, y start, width, height
     importButton.setBounds(0, 0, getWidth(), getHeight() / 16);
+    importProgressBar.setBounds(0, 0, 3 * getWidth() / 4, getHeight() / 16);
+    cancelImportButton.setBounds(3 * getWidth() / 4, 0, getWidth() / 4, getHeight() / 16);
     library.setBounds(0, 1 * getHeight() / 16, getWidth(), 13 * getHeight() / 16);
     searchField.setBounds(0, 14 * getHeight() / 16, getWidth(), getHeight() / 16);
-    addToPlayer1Button.setBounds(0, 15 * getHeight() / 16, getWidth() / 2, getHeight() / 16);
-    addToPlayer2Button.setBounds(getWidth() / 2, 15 * getHeight() / 16, getWidth() / 2, getHeight() / 16);
+    for (int deck = 0; deck < addToDeckButtons.size(); ++deck)
+    {
+        int left = deck * getWidth() / addToDeckButtons.size();
+        int right = (deck + 1) * getWidth() / addToDeckButtons.size();
+        addToDeckButtons[deck]->setBounds(left, 15 * getHeight() / 16, right - left, getHeight() / 16);
+    }
 
     //set columns
-    library.getHeader().setColumnWidth(1, 12.8 * getWidth() / 20);
-    library.getHeader().setColumnWidth(2, 5 * getWidth() / 20);
+    library.getHeader().setColumnWidth(1, 8.6 * getWidth() / 20);
+    library.getHeader().setColumnWidth(2, 3 * getWidth() / 20);
+    library.getHeader().setColumnWidth(4, 3 * getWidth() / 20);
+    library.getHeader().setColumnWidth(5, 3.2 * getWidth() / 20);
     library.getHeader().setColumnWidth(3, 2 * getWidth() / 20);
     
     auto colour1 = juce::Colours::red;
     auto colour2 = juce::Colours::purple;
     importButton.setColour(juce::TextButton::ColourIds::buttonColourId, colour1.interpolatedWith(colour2, 0.5f));
-    addToPlayer1Button.setColour(juce::TextButton::ColourIds::buttonColourId, colour1.interpolatedWith(colour2, 0.5f));
-    addToPlayer2Button.setColour(juce::TextButton::ColourIds::buttonColourId, colour1.interpolatedWith(colour2, 0.5f));
+    cancelImportButton.setColour(juce::TextButton::ColourIds::buttonColourId, colour1.interpolatedWith(colour2, 0.5f));
+    for (auto* addToDeckButton : addToDeckButtons)
+    {
+        addToDeckButton->setColour(juce::TextButton::ColourIds::buttonColourId, colour1.interpolatedWith(colour2, 0.5f));
+    }
     library.setColour(juce::ListBox::backgroundColourId, colour1.interpolatedWith (colour2, 0.5f));
 }
 
 int PlaylistComponent::getNumRows()
 {
-    return tracks.size();
+    if (sortColumnId != 0)
+    {
+        return int(sortedIds.size());
+    }
+    return isFiltering ? int(searchResults.size()) : tracks.size();
 }
 
 void PlaylistComponent::paintRowBackground(juce::Graphics& g,
@@ -130,33 +193,62 @@ void PlaylistComponent::paintCell(juce::Graphics& g,
                                   bool rowIsSelected
                                  )
 {
-    if (rowNumber < getNumRows())
+    if (rowNumber < getNumRows() && (columnId == 1 || columnId == 2 || columnId == 4 || columnId == 5))
     {
-        if (columnId == 1)
-        {
-            g.drawText(tracks[rowNumber].title,
-                2,
-                0,
-                width - 4,
-                height,
-                juce::Justification::centredLeft,
-                true
-            );
-        }
-        if (columnId == 2)
+        int row = trackRowForTableRow(rowNumber);
+        juce::Rectangle<int> area{ 2, 0, width - 4, height };
+        // only rows that haven't been drawn recently are laid out again
+        juce::uint64 key = (juce::uint64(tracks.getId(row)) << 8) | juce::uint64(columnId);
+        if (!cellText.draw(g, key, area))
         {
-            g.drawText(tracks[rowNumber].length,
-                2,
-                0,
-                width - 4,
-                height,
-                juce::Justification::centred,
-                true
-            );
+            if (columnId == 1)
+            {
+                cellText.drawAndCache(g, key, tracks.getTitle(row), g.getCurrentFont(),
+                                      area, juce::Justification::centredLeft);
+            }
+            else if (columnId == 2)
+            {
+                cellText.drawAndCache(g, key, secondsToMinutes(tracks.getLengthInSeconds(row)),
+                                      g.getCurrentFont(), area, juce::Justification::centred);
+            }
+            else if (columnId == 4)
+            {
+                // blank until the tags or the analysis give a tempo
+                double bpm = tracks.getBpm(row);
+                cellText.drawAndCache(g, key, bpm > 0.0 ? juce::String(bpm, 1) : juce::String(),
+                                      g.getCurrentFont(), area, juce::Justification::centred);
+            }
+            else
+            {
+                cellText.drawAndCache(g, key, KeyAnalyser::getCamelot(tracks.getKey(row)),
+                                      g.getCurrentFont(), area, juce::Justification::centred);
+            }
         }
     }
 }
 
+juce::String PlaylistComponent::getCellTooltip(int rowNumber, int columnId)
+{
+    if (columnId != 5 || rowNumber >= getNumRows())
+    {
+        return {};
+    }
+    int key = tracks.getKey(trackRowForTableRow(rowNumber));
+    if (key == KeyAnalyser::noKey)
+    {
+        return {};
+    }
+    return KeyAnalyser::getKeyName(key) + (key >= 12 ? " (minor)" : " (major)");
+}
+
+void PlaylistComponent::sortOrderChanged(int newSortColumnId, bool isForwards)
+{
+    sortColumnId = newSortColumnId;
+    sortForwards = isForwards;
+    refreshRows();
+    library.repaint();
+}
+
 juce::Component* PlaylistComponent::refreshComponentForCell(int rowNumber,
                                                       int columnId,
                                                       bool isRowSelected,
@@ -164,15 +256,15 @@ juce::Component* PlaylistComponent::refreshComponentForCell(int rowNumber,
 {
     if (columnId == 3)
     {
-        if (existingComponentToUpdate == nullptr)
+        auto* btn = dynamic_cast<DeleteButton*>(existingComponentToUpdate);
+        if (btn == nullptr)
         {
-            juce::TextButton* btn = new juce::TextButton{ "X" };
-            juce::String id{ std::to_string(rowNumber) };
-            btn->setComponentID(id);
-            
+            btn = new DeleteButton();
             btn->addListener(this);
             existingComponentToUpdate = btn;
         }
+        // buttons are reused as the table scrolls and the search changes
+        btn->row = rowNumber;
     }
     return existingComponentToUpdate;
 }
@@ -183,24 +275,24 @@ void PlaylistComponent::buttonClicked(juce::Button* button)
     {
         DBG("Load button clicked");
         importToLibrary();
-        library.updateContent();
     }
-    else if (button == &addToPlayer1Button)
+    else if (button == &cancelImportButton)
     {
-        DBG("Add to Player 1 clicked");
-        loadInPlayer(deckGUI1);
+        DBG("Cancel import clicked");
+        importer.cancel();
     }
-    else if (button == &addToPlayer2Button)
+    else if (int deck = addToDeckButtons.indexOf(dynamic_cast<juce::TextButton*>(button)); deck >= 0)
     {
-        DBG("Add to Player 2 clicked");
-        loadInPlayer(deckGUI2);
+        DBG("Add to Player " << deck + 1 << " clicked");
+        loadInPlayer(deckGUIs[deck]);
     }
-    else
+    else if (auto* deleteButton = dynamic_cast<DeleteButton*>(button))
     {
-        int id = std::stoi(button->getComponentID().toStdString());
-        DBG(tracks[id].title + " removed from Library");
-        deleteFromTracks(id);
+        int row = trackRowForTableRow(deleteButton->row);
+        DBG(tracks.getTitle(row) + " removed from Library");
+        deleteFromTracks(row);
         library.updateContent();
+        library.repaint();
     }
 }
 
@@ -209,8 +301,11 @@ void PlaylistComponent::loadInPlayer(DeckGUI* deckGUI)
     int selectedRow{ library.getSelectedRow() };
     if (selectedRow != -1)
     {
-        DBG("Adding: " << tracks[selectedRow].title << " to Player");
-        deckGUI->loadFile(tracks[selectedRow].URL);
+        int row = trackRowForTableRow(selectedRow);
+        DBG("Adding: " << tracks.getTitle(row) << " to Player");
+        // only a beat grid the analysis found has a downbeat to line up with
+        double bpm = tracks.getBeatGridFound(row) ? tracks.getBpm(row) : 0.0;
+        deckGUI->loadFile(juce::URL{ tracks.getFile(row) }, bpm, tracks.getFirstDownbeat(row));
     }
     else
     {
@@ -222,49 +317,209 @@ void PlaylistComponent::importToLibrary()
 {
     DBG("PlaylistComponent::importToLibrary called");
 
-    //initialize file chooser
-    juce::FileChooser chooser{ "Select files" };
-    juce::FileChooser choosers{ "Select for file(s) to add to the library...", juce::File() , "*.mp3;*.wav;*.aiff" };
+    // files and whole folders can be chosen, folders are scanned recursively
     auto fileChooserFlags =
-    juce::FileBrowserComponent::canSelectFiles;
-    //fChooser.launchAsync(fileChooserFlags, [this](const juce::FileChooser& chooser)
+    juce::FileBrowserComponent::canSelectFiles
+    | juce::FileBrowserComponent::canSelectDirectories
+    | juce::FileBrowserComponent::canSelectMultipleItems;
     fChooser.launchAsync(fileChooserFlags, [this](const juce::FileChooser& chooser)
     {
+        juce::StringArray paths;
         for (const juce::File& file : chooser.getResults())
         {
-            juce::String fileNameWithoutExtension{ file.getFileNameWithoutExtension() };
-            if (!isInTracks(fileNameWithoutExtension)) // if not already loaded
-            {
-                Track newTrack{ file };
-                juce::URL audioURL{ file };
-                newTrack.length = getLength(audioURL) ;
-                tracks.push_back(newTrack);
-                DBG("loaded file: " << newTrack.title);
-            }
-            else // display info message
-            {
-                DBG("Load information:");
-            }
+            paths.add(file.getFullPathName());
         }
+        importFiles(paths);
     });
 }
 
-bool PlaylistComponent::isInTracks(juce::String fileNameWithoutExtension)
+void PlaylistComponent::importFiles(const juce::StringArray& paths)
+{
+    if (paths.isEmpty())
+    {
+        return;
+    }
+    importer.importFiles(paths);
+
+    // swap the import button for the progress bar until the import finishes
+    importButton.setVisible(false);
+    importProgressBar.setVisible(true);
+    cancelImportButton.setVisible(true);
+    updateImportProgress();
+}
+
+void PlaylistComponent::updateImportProgress()
+{
+    importProgress = importer.getProgress();
+    importProgressBar.setTextToDisplay("Importing " + juce::String(importer.getNumProbed())
+                                       + " / " + juce::String(importer.getNumQueued()));
+}
+
+void PlaylistComponent::tracksImported(const std::vector<LibraryImporter::Result>& batch)
+{
+    for (const LibraryImporter::Result& result : batch)
+    {
+        auto duplicate = duplicates.find(result.identity);
+        if (duplicate.match == DuplicateIndex::Match::sameContent && !result.isDistinct)
+        {
+            // the hash only covers the ends of the file, so make sure before turning it away
+            importer.checkCopy(result, tracks.getFile(tracks.getRow(duplicate.trackId)));
+        }
+        else if (duplicate.match == DuplicateIndex::Match::none
+                 || duplicate.match == DuplicateIndex::Match::sameContent) // if not already loaded
+        {
+            Track newTrack{ result.file };
+            newTrack.identity = result.identity;
+            applyMetadata(newTrack, result.metadata);
+            addToTracks(newTrack);
+            libraryFile.trackAdded(newTrack);
+            analyser.analyse(newTrack.id, newTrack.file);
+        }
+        else if (duplicate.match == DuplicateIndex::Match::changedFile)
+        {
+            // the file was edited since it was imported, so refresh its entry
+            Track track = tracks.getTrack(tracks.getRow(duplicate.trackId));
+            duplicates.remove(track.id, track.identity);
+            track.identity = result.identity;
+            applyMetadata(track, result.metadata);
+            tracks.update(track);
+            duplicates.add(track.id, track.identity);
+            searchIndex.add(track.id, track.title, track.artist, getKeySearchText(track.key));
+            libraryFile.trackAdded(track);
+            analyser.analyse(track.id, track.file);
+            cellText.clear();
+        }
+        else // display info message
+        {
+            DBG("Load information: " << result.file.getFileName() << " already in library");
+        }
+    }
+    libraryFile.compactIfNeeded();
+    refreshRows();
+    updateImportProgress();
+}
+
+void PlaylistComponent::importFinished(bool wasCancelled)
+{
+    DBG("PlaylistComponent::importFinished" << (wasCancelled ? " (cancelled)" : ""));
+    importProgress = 0.0;
+    importProgressBar.setVisible(false);
+    cancelImportButton.setVisible(false);
+    importButton.setVisible(true);
+}
+
+void PlaylistComponent::tracksAnalysed(const std::vector<TrackAnalyser::Result>& batch)
+{
+    std::vector<juce::uint32> analysedIds;
+    for (const TrackAnalyser::Result& result : batch)
+    {
+        // the track may have been removed, or its file changed, while it was analysed
+        int row = tracks.getRow(result.trackId);
+        if (row < 0 || tracks.getFile(row) != result.file)
+        {
+            continue;
+        }
+        if (!result.decoded)
+        {
+            DBG("PlaylistComponent::tracksAnalysed couldn't decode " << result.file.getFileName());
+            continue;
+        }
+
+        Track track = tracks.getTrack(row);
+        // without a steady beat the tagged tempo, if any, is kept, but there's no grid to sync to
+        track.beatGridFound = result.beats.bpm > 0.0;
+        if (track.beatGridFound)
+        {
+            track.bpm = result.beats.bpm;
+            track.firstDownbeat = result.beats.firstDownbeat;
+        }
+        track.beatsAnalysed = true;
+        track.key = result.key.key;
+        track.keyAnalysed = true;
+        tracks.update(track);
+        searchIndex.add(track.id, track.title, track.artist, getKeySearchText(track.key));
+        libraryFile.trackAdded(track);
+        analysedIds.push_back(track.id);
+    }
+    libraryFile.compactIfNeeded();
+    // a search may now match the new keys, and a sort by tempo or key only
+    // needs the analysed tracks moving
+    if (isFiltering)
+    {
+        refreshRows();
+    }
+    else if (sortColumnId == 4 || sortColumnId == 5)
+    {
+        resortTracks(analysedIds);
+    }
+    cellText.clear();
+    library.repaint();
+}
+
+bool PlaylistComponent::isInterestedInFileDrag(const juce::StringArray& files)
+{
+    return true;
+}
+
+void PlaylistComponent::filesDropped(const juce::StringArray& files, int x, int y)
 {
-    return (std::find(tracks.begin(), tracks.end(), fileNameWithoutExtension) != tracks.end());
+    DBG("PlaylistComponent::filesDropped " << files.size() << " file(s)");
+    importFiles(files);
 }
 
-void PlaylistComponent::deleteFromTracks(int id)
+void PlaylistComponent::applyMetadata(Track& track, const TrackMetadata& metadata)
 {
-    tracks.erase(tracks.begin() + id);
+    track.lengthInSeconds = metadata.lengthInSeconds;
+    track.artist = metadata.artist;
+    track.bpm = metadata.bpm;
+    // a changed file is analysed again
+    track.firstDownbeat = 0.0;
+    track.beatsAnalysed = false;
+    track.beatGridFound = false;
+    track.key = KeyAnalyser::noKey;
+    track.keyAnalysed = false;
 }
 
-juce::String PlaylistComponent::getLength(juce::URL audioURL)
+void PlaylistComponent::addToTracks(Track& track)
 {
-    playerForParsingMetaData->loadURL(audioURL);
-    double seconds{ playerForParsingMetaData->getLengthInSeconds() };
-    juce::String minutes{ secondsToMinutes(seconds) };
-    return minutes;
+    track.id = tracks.add(track);
+    searchIndex.add(track.id, track.title, track.artist, getKeySearchText(track.key));
+    duplicates.add(track.id, track.identity);
+}
+
+void PlaylistComponent::deleteFromTracks(int row)
+{
+    Track track = tracks.getTrack(row);
+    libraryFile.trackRemoved(track);
+    searchIndex.remove(track.id);
+    duplicates.remove(track.id, track.identity);
+    tracks.remove(track.id);
+    libraryFile.compactIfNeeded();
+    refreshRows();
+}
+
+int PlaylistComponent::trackRowForTableRow(int rowNumber)
+{
+    if (sortColumnId != 0)
+    {
+        return tracks.getRow(sortedIds[size_t(rowNumber)]);
+    }
+    if (!isFiltering)
+    {
+        return rowNumber;
+    }
+    return tracks.getRow(searchResults[size_t(rowNumber)]);
+}
+
+int PlaylistComponent::tableRowForId(juce::uint32 id)
+{
+    if (sortColumnId == 0 && !isFiltering)
+    {
+        return tracks.getRow(id);
+    }
+    const auto& ids = sortColumnId != 0 ? sortedIds : searchResults;
+    auto found = std::find(ids.begin(), ids.end(), id);
+    return found != ids.end() ? int(found - ids.begin()) : -1;
 }
 
 juce::String PlaylistComponent::secondsToMinutes(double seconds)
@@ -284,72 +539,203 @@ juce::String PlaylistComponent::secondsToMinutes(double seconds)
 
 void PlaylistComponent::searchLibrary(juce::String searchText)
 {
-    DBG("Searching library for: " << searchText);
-    if (searchText != "")
+    // the table only shows the best matches, best first, while there is a
+    // search, which is all anyone scrolls through
+    isFiltering = searchText.trim().isNotEmpty();
+    if (isFiltering)
     {
-        int rowNumber = whereInTracks(searchText);
-        library.selectRow(rowNumber);
+        searchResults = searchIndex.search(searchText);
     }
     else
     {
-        library.deselectAllRows();
+        searchResults.clear();
     }
+    sortRows();
+    DBG("Searching library for: " << searchText << " (" << int(searchResults.size()) << " matches)");
+
+    library.deselectAllRows();
+    library.updateContent();
+    library.repaint();
 }
 
-int PlaylistComponent::whereInTracks(juce::String searchText)
+void PlaylistComponent::refreshRows()
 {
-    // finds index where track title contains searchText
-    auto it = find_if(tracks.begin(), tracks.end(),
-        [&searchText](const Track& obj) {return obj.title.contains(searchText); });
-    int i = -1;
+    juce::uint32 selectedId = 0;
+    int selectedRow = library.getSelectedRow();
+    if (selectedRow >= 0 && selectedRow < getNumRows())
+    {
+        // the selected track may be the one just removed
+        int row = trackRowForTableRow(selectedRow);
+        selectedId = row >= 0 ? tracks.getId(row) : 0;
+    }
 
-    if (it != tracks.end())
+    if (isFiltering)
     {
-        i = std::distance(tracks.begin(), it);
+        searchResults = searchIndex.search(searchField.getText());
     }
+    sortRows();
+    library.updateContent();
 
-    return i;
+    library.deselectAllRows();
+    int tableRow = selectedId != 0 ? tableRowForId(selectedId) : -1;
+    if (tableRow >= 0)
+    {
+        library.selectRow(tableRow);
+    }
 }
 
-void PlaylistComponent::saveLibrary()
+void PlaylistComponent::resortTracks(const std::vector<juce::uint32>& changedIds)
 {
-    // create .txt to save library
-    std::ofstream myPlaylist("myPlaylist.txt");
-    
-    // save library to file
-    for (Track& t : tracks)
+    int selectedRow = library.getSelectedRow();
+    juce::uint32 selectedId = selectedRow >= 0 && selectedRow < getNumRows() ? sortedIds[size_t(selectedRow)] : 0;
+
+    // the same order as sortRows, where tracks that tie stay in library order
+    auto isBefore = [this](int a, int b)
+    {
+        double valueA = sortColumnId == 4 ? tracks.getBpm(a) : KeyAnalyser::getCamelotOrder(tracks.getKey(a));
+        double valueB = sortColumnId == 4 ? tracks.getBpm(b) : KeyAnalyser::getCamelotOrder(tracks.getKey(b));
+        if (valueA != valueB)
+        {
+            return sortForwards ? valueA < valueB : valueB < valueA;
+        }
+        return a < b;
+    };
+
+    // the rest are still in order, so the changed tracks are taken out,
+    // sorted on their own and merged back in
+    std::vector<bool> isChanged(size_t(tracks.size()), false);
+    std::vector<int> changedRows;
+    for (auto id : changedIds)
     {
-        DBG(t.file.getFullPathName());
-        myPlaylist << t.file.getFullPathName() << "," << t.length << "\n";
+        int row = tracks.getRow(id);
+        if (row >= 0 && !isChanged[size_t(row)])
+        {
+            isChanged[size_t(row)] = true;
+            changedRows.push_back(row);
+        }
+    }
+    std::vector<int> keptRows;
+    keptRows.reserve(sortedIds.size());
+    for (auto id : sortedIds)
+    {
+        int row = tracks.getRow(id);
+        if (!isChanged[size_t(row)])
+        {
+            keptRows.push_back(row);
+        }
+    }
+    std::sort(changedRows.begin(), changedRows.end(), isBefore);
+    std::vector<int> rows;
+    rows.reserve(keptRows.size() + changedRows.size());
+    std::merge(keptRows.begin(), keptRows.end(), changedRows.begin(), changedRows.end(),
+               std::back_inserter(rows), isBefore);
+
+    sortedIds.clear();
+    for (int row : rows)
+    {
+        sortedIds.push_back(tracks.getId(row));
+    }
+    library.updateContent();
+
+    // the selection stays on the same track wherever it has moved to
+    int tableRow = selectedId != 0 ? tableRowForId(selectedId) : -1;
+    if (tableRow != selectedRow && tableRow >= 0)
+    {
+        library.selectRow(tableRow);
     }
-    
-    myPlaylist.close();
 }
 
-void PlaylistComponent::loadLibrary()
+void PlaylistComponent::sortRows()
 {
-    // create input stream from saved library
-    std::ifstream myPlaylist("myPlaylist.txt");
-    std::string filePath;
-    std::string length;
+    sortedIds.clear();
+    if (sortColumnId == 0)
+    {
+        return;
+    }
 
-    // Read data, line by line
-    if (myPlaylist.is_open())
+    // the search results are sorted when there is a search, otherwise the whole library
+    std::vector<int> rows;
+    if (isFiltering)
     {
-        DBG("playlist open");
-        while (getline(myPlaylist, filePath, ',')) {
-            juce::File file{ filePath };
-            Track newTrack{ file };
+        rows.reserve(searchResults.size());
+        for (auto id : searchResults)
+        {
+            rows.push_back(tracks.getRow(id));
+        }
+    }
+    else
+    {
+        rows.resize(size_t(tracks.size()));
+        std::iota(rows.begin(), rows.end(), 0);
+    }
 
-            getline(myPlaylist, length);
-            newTrack.length = length;
-            tracks.push_back(newTrack);
+    // stable, so rows that tie keep their library or search order either way round
+    auto sortBy = [&rows, this](auto isBefore)
+    {
+        std::stable_sort(rows.begin(), rows.end(), [&isBefore, this](int a, int b)
+        {
+            return sortForwards ? isBefore(a, b) : isBefore(b, a);
+        });
+    };
+    if (sortColumnId == 1)
+    {
+        // titles are made from the file name when there isn't a tag, so they are made once
+        std::vector<juce::String> titles(size_t(tracks.size()));
+        for (int row : rows)
+        {
+            titles[size_t(row)] = tracks.getTitle(row);
         }
+        sortBy([&titles](int a, int b) { return titles[size_t(a)].compareNatural(titles[size_t(b)]) < 0; });
     }
-    else if(!myPlaylist.is_open())
+    else if (sortColumnId == 2)
     {
-        DBG("file not open");
+        sortBy([this](int a, int b) { return tracks.getLengthInSeconds(a) < tracks.getLengthInSeconds(b); });
     }
-    myPlaylist.close();
+    else if (sortColumnId == 4)
+    {
+        sortBy([this](int a, int b) { return tracks.getBpm(a) < tracks.getBpm(b); });
+    }
+    else if (sortColumnId == 5)
+    {
+        // round the Camelot wheel, so keys that mix well sit together
+        sortBy([this](int a, int b)
+        {
+            return KeyAnalyser::getCamelotOrder(tracks.getKey(a)) < KeyAnalyser::getCamelotOrder(tracks.getKey(b));
+        });
+    }
+
+    sortedIds.reserve(rows.size());
+    for (int row : rows)
+    {
+        sortedIds.push_back(tracks.getId(row));
+    }
+}
+
+juce::String PlaylistComponent::getKeySearchText(int key)
+{
+    if (key == KeyAnalyser::noKey)
+    {
+        return {};
+    }
+    return KeyAnalyser::getCamelot(key) + " " + KeyAnalyser::getKeyName(key);
 }
 
+void PlaylistComponent::loadLibrary()
+{
+    // the old text playlist is migrated the first time the library is opened
+    auto workingDirectory = juce::File::getCurrentWorkingDirectory();
+    libraryFile.load(workingDirectory.getChildFile("myPlaylist.txt"), tracks);
+    for (int row = 0; row < tracks.size(); ++row)
+    {
+        searchIndex.add(tracks.getId(row), tracks.getTitle(row), tracks.getArtist(row),
+                        getKeySearchText(tracks.getKey(row)));
+        duplicates.add(tracks.getId(row), tracks.getIdentity(row));
+        // tracks imported before the analysis, or its key detection, existed,
+        // or while the app was closing
+        if (!tracks.getBeatsAnalysed(row) || !tracks.getKeyAnalysed(row))
+        {
+            analyser.analyse(tracks.getId(row), tracks.getFile(row));
+        }
+    }
+    DBG("Loaded " << int(tracks.size()) << " track(s) into the library");
+}
@@ -13,11 +13,18 @@
 #include <JuceHeader.h>
 #include <vector>
 #include <algorithm>
+#include <numeric>
+#include <iterator>
 #include <filesystem>
-#include <fstream>
 #include "Track.h"
+#include "TrackStore.h"
+#include "TextLayoutCache.h"
 #include "DeckGUI.h"
-#include "DJAudioPlayer.h"
+#include "LibraryImporter.h"
+#include "TrackAnalyser.h"
+#include "LibraryFile.h"
+#include "SearchIndex.h"
+#include "DuplicateIndex.h"
 
 //==============================================================================
 /*
@@ -25,12 +32,14 @@
 class PlaylistComponent  : public juce::Component,
                            public juce::TableListBoxModel,
                            public juce::Button::Listener,
-                           public juce::TextEditor::Listener
+                           public juce::TextEditor::Listener,
+                           public juce::FileDragAndDropTarget,
+                           public LibraryImporter::Listener,
+                           public TrackAnalyser::Listener
 {
 public:
-    PlaylistComponent(DeckGUI* _deckGUI1,
-                      DeckGUI* _deckGUI2,
-                      DJAudioPlayer* _playerForParsingMetaData
+    PlaylistComponent(const juce::Array<DeckGUI*>& _deckGUIs,
+                      juce::AudioFormatManager& formatManager
                      );
     ~PlaylistComponent() override;
 
@@ -52,35 +61,87 @@ public:
                    bool rowIsSelected
                   ) override;
     
+    /**Names the key in full when the key column is hovered*/
+    juce::String getCellTooltip(int rowNumber, int columnId) override;
+    /**Sorts the table by the clicked column, the search results as well*/
+    void sortOrderChanged(int newSortColumnId, bool isForwards) override;
+    
     Component* refreshComponentForCell(int rowNumber,
                                        int columnId,
                                        bool isRowSelected,
                                        Component* existingComponentToUpdate) override;
     void buttonClicked(juce::Button* button) override;
+    /**Accepts files and folders dragged onto the library*/
+    bool isInterestedInFileDrag(const juce::StringArray& files) override;
+    /**Imports the dropped files and folders*/
+    void filesDropped(const juce::StringArray& files, int x, int y) override;
+    /**Implement LibraryImporter::Listener*/
+    void tracksImported(const std::vector<LibraryImporter::Result>& batch) override;
+    void importFinished(bool wasCancelled) override;
+    /**Implement TrackAnalyser::Listener*/
+    void tracksAnalysed(const std::vector<TrackAnalyser::Result>& batch) override;
 private:
-    std::vector<Track> tracks;
+    /**The delete button of a row, which keeps the row it was last shown on*/
+    class DeleteButton : public juce::TextButton
+    {
+        public:
+            DeleteButton() : juce::TextButton{ "X" } {}
+            int row{ -1 };
+    };
+
+    TrackStore tracks;
+    /**Laid out titles and lengths of the rows drawn most recently*/
+    TextLayoutCache cellText;
+
+    DuplicateIndex duplicates;
+    SearchIndex searchIndex;
+    std::vector<juce::uint32> searchResults;
+    bool isFiltering{ false };
+    /**The ids in the order the table shows them while it is sorted*/
+    std::vector<juce::uint32> sortedIds;
+    /**0 while the table is in library or search order*/
+    int sortColumnId{ 0 };
+    bool sortForwards{ true };
     
     juce::TextButton importButton{ "IMPORT TRACKS" };
+    juce::TextButton cancelImportButton{ "CANCEL" };
+    double importProgress{ 0.0 };
+    juce::ProgressBar importProgressBar{ importProgress };
     juce::TextEditor searchField;
     juce::TableListBox library;
-    juce::TextButton addToPlayer1Button{ "ADD TO DECK 1" };
-    juce::TextButton addToPlayer2Button{ "ADD TO DECK 2" };
+    /**One for each deck, in the same order as deckGUIs*/
+    juce::OwnedArray<juce::TextButton> addToDeckButtons;
     juce::FileChooser fChooser{"Select a file..."};
 
-    DeckGUI* deckGUI1;
-    DeckGUI* deckGUI2;
-    DJAudioPlayer* playerForParsingMetaData;
-    
-    juce::String getLength(juce::URL audioURL);
+    juce::Array<DeckGUI*> deckGUIs;
+    LibraryImporter importer;
+    /**Finds the tempo, beat grid and key of every track that hasn't had them found yet*/
+    TrackAnalyser analyser;
+    LibraryFile libraryFile{ juce::File::getCurrentWorkingDirectory().getChildFile("myLibrary.djlib") };
+
     juce::String secondsToMinutes(double seconds);
 
     void importToLibrary();
+    void importFiles(const juce::StringArray& paths);
+    void updateImportProgress();
     void searchLibrary(juce::String searchText);
-    void saveLibrary();
+    /**Runs the search again and re-sorts after the library changes, keeping
+       the selected track selected*/
+    void refreshRows();
+    void sortRows();
+    /**Moves tracks whose tempo or key changed to their place in the whole
+       library sorted by tempo or key, without sorting the rest again*/
+    void resortTracks(const std::vector<juce::uint32>& changedIds);
+    /**The Camelot and the usual name of a key, which the search matches*/
+    static juce::String getKeySearchText(int key);
     void loadLibrary();
-    void deleteFromTracks(int id);
-    bool isInTracks(juce::String fileNameWithoutExtension);
-    int whereInTracks(juce::String searchText);
+    void addToTracks(Track& track);
+    void deleteFromTracks(int row);
+    void applyMetadata(Track& track, const TrackMetadata& metadata);
+    /**Gets the row in tracks of a table row, which differs while a search is shown*/
+    int trackRowForTableRow(int rowNumber);
+    /**Gets the table row showing a track, or -1 if it isn't shown*/
+    int tableRowForId(juce::uint32 id);
     void loadInPlayer(DeckGUI* deckGUI);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlaylistComponent)
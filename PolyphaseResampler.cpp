@@ -0,0 +1,252 @@
+/*
+  ==============================================================================
+
+    PolyphaseResampler.cpp
+    Created: 2 Jul 2023 11:48:20am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "PolyphaseResampler.h"
+#include "SimdOps.h"
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    struct QualitySettings
+    {
+        /**Filter length at normal speed, in input samples*/
+        int numTaps;
+        int numPhases;
+        /**How much of the band below Nyquist is kept*/
+        double passband;
+        /**Kaiser window shape, higher gives less ripple and a wider transition*/
+        double beta;
+        /**How much faster each band of filters is built for than the one before.
+           A speed between two bands gets the faster one's cutoff, which is
+           lower than it needs by at most this much*/
+        double bandStep;
+    };
+
+    QualitySettings getSettings(PolyphaseResampler::Quality quality)
+    {
+        switch (quality)
+        {
+            case PolyphaseResampler::Quality::draft:    return { 8, 64, 0.85, 6.0, 1.08 };
+            case PolyphaseResampler::Quality::high:     return { 32, 1024, 0.95, 10.0, 1.025 };
+            case PolyphaseResampler::Quality::normal:
+            default:                                    return { 16, 256, 0.9, 8.0, 1.04 };
+        }
+    }
+
+    /**Zeroth order modified Bessel function, for the Kaiser window*/
+    double besselI0(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 50 && term > sum * 1.0e-12; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+}
+
+//==============================================================================
+const PolyphaseResampler::Band& PolyphaseResampler::Kernels::getBand(double ratio) const
+{
+    for (const auto& band : bands)
+    {
+        if (ratio <= band.maxRatio)
+        {
+            return band;
+        }
+    }
+    return bands.back();
+}
+
+const PolyphaseResampler::Kernels& PolyphaseResampler::KernelBank::get(Quality quality)
+{
+    const juce::ScopedLock sl(lock);
+    auto& entry = kernels[size_t(quality)];
+    if (entry == nullptr)
+    {
+        entry = build(quality);
+    }
+    return *entry;
+}
+
+std::unique_ptr<PolyphaseResampler::Kernels> PolyphaseResampler::KernelBank::build(Quality quality)
+{
+    auto settings = getSettings(quality);
+    auto built = std::make_unique<Kernels>();
+    built->numPhases = settings.numPhases;
+
+    // one band for every speed up to normal, then a band every bandStep up to the fastest
+    std::vector<double> bandRatios{ 1.0 };
+    while (bandRatios.back() < maxRatio)
+    {
+        bandRatios.push_back(juce::jmin(maxRatio, bandRatios.back() * settings.bandStep));
+    }
+
+    for (double bandRatio : bandRatios)
+    {
+        Band band;
+        band.maxRatio = bandRatio;
+        // wider at higher speeds, so the lower cutoff is as sharp, rounded up for the SIMD kernels
+        band.numTaps = (int(std::ceil(settings.numTaps * bandRatio)) + 3) & ~3;
+        jassert(band.numTaps / 2 <= lookBehind);
+        band.coefficients.resize(size_t(settings.numPhases * band.numTaps));
+
+        double cutoff = settings.passband / juce::jmax(1.0, bandRatio);
+        double half = band.numTaps / 2;
+        double windowScale = 1.0 / besselI0(settings.beta);
+        for (int phase = 0; phase < settings.numPhases; ++phase)
+        {
+            double fraction = double(phase) / settings.numPhases;
+            float* coefficients = band.coefficients.data() + phase * band.numTaps;
+            double sum = 0.0;
+            for (int tap = 0; tap < band.numTaps; ++tap)
+            {
+                // distance from the output sample to this tap's input sample
+                double x = tap - half + 1.0 - fraction;
+                double u = x / half;
+                double window = std::abs(u) < 1.0 ? besselI0(settings.beta * std::sqrt(1.0 - u * u)) * windowScale : 0.0;
+                double phaseX = juce::MathConstants<double>::pi * cutoff * x;
+                double sinc = std::abs(phaseX) < 1.0e-9 ? 1.0 : std::sin(phaseX) / phaseX;
+                double value = cutoff * sinc * window;
+                coefficients[tap] = float(value);
+                sum += value;
+            }
+            // every phase passes DC at unity gain
+            for (int tap = 0; tap < band.numTaps; ++tap)
+            {
+                coefficients[tap] = float(coefficients[tap] / sum);
+            }
+        }
+        built->bands.push_back(std::move(band));
+    }
+    return built;
+}
+
+//==============================================================================
+PolyphaseResampler::PolyphaseResampler(juce::AudioSource* _input) : input(_input)
+{
+    setQuality(Quality::normal);
+    flushBuffers();
+}
+
+PolyphaseResampler::~PolyphaseResampler()
+{
+}
+
+void PolyphaseResampler::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    input->prepareToPlay(int(std::ceil(samplesPerBlockExpected * maxRatio)) + 2 * lookBehind, sampleRate);
+    ensureCapacity(samplesPerBlockExpected);
+    flushBuffers();
+}
+
+void PolyphaseResampler::releaseResources()
+{
+    input->releaseResources();
+    history.setSize(2, 0);
+}
+
+void PolyphaseResampler::setResamplingRatio(double newRatio)
+{
+    ratio = juce::jlimit(minRatio, maxRatio, newRatio);
+}
+
+void PolyphaseResampler::setQuality(Quality quality)
+{
+    kernels.store(&bank->get(quality), std::memory_order_release);
+}
+
+void PolyphaseResampler::flushBuffers()
+{
+    // silence behind the first sample, so the filter starts on it without any delay
+    history.clear();
+    numBuffered = lookBehind;
+    position = lookBehind;
+}
+
+double PolyphaseResampler::getBufferedInput() const
+{
+    return numBuffered - position;
+}
+
+void PolyphaseResampler::ensureCapacity(int numSamples)
+{
+    int needed = lookBehind + int(std::ceil(numSamples * maxRatio)) + 2 * lookBehind + 2;
+    if (history.getNumChannels() != 2 || history.getNumSamples() < needed)
+    {
+        history.setSize(2, needed, true, true, true);
+    }
+}
+
+void PolyphaseResampler::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    int numSamples = bufferToFill.numSamples;
+    if (numSamples <= 0)
+    {
+        return;
+    }
+    ensureCapacity(numSamples);
+
+    const auto* current = kernels.load(std::memory_order_acquire);
+    const Band& band = current->getBand(ratio);
+    int half = band.numTaps / 2;
+
+    // read up to the last tap of the last output sample
+    int lastNeeded = int(position + (numSamples - 1) * ratio) + half;
+    int numToRead = lastNeeded + 1 - numBuffered;
+    if (numToRead > 0)
+    {
+        juce::AudioSourceChannelInfo inputInfo(&history, numBuffered, numToRead);
+        input->getNextAudioBlock(inputInfo);
+        numBuffered += numToRead;
+    }
+
+    auto& output = *bufferToFill.buffer;
+    const float* left = history.getReadPointer(0);
+    const float* right = history.getReadPointer(1);
+    float* outLeft = output.getWritePointer(0, bufferToFill.startSample);
+    float* outRight = output.getNumChannels() > 1 ? output.getWritePointer(1, bufferToFill.startSample) : nullptr;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        int base = int(position);
+        int phase = juce::jmin(current->numPhases - 1, int((position - base) * current->numPhases));
+        int first = base - half + 1;
+        float leftSum, rightSum;
+        SimdOps::dotProductStereo(band.coefficients.data() + phase * band.numTaps,
+                                  left + first, right + first, band.numTaps, leftSum, rightSum);
+        outLeft[i] = leftSum;
+        if (outRight != nullptr)
+        {
+            outRight[i] = rightSum;
+        }
+        position += ratio;
+    }
+    for (int channel = 2; channel < output.getNumChannels(); ++channel)
+    {
+        output.clear(channel, bufferToFill.startSample, numSamples);
+    }
+
+    // drop the input no later output sample reaches back to
+    int consumed = int(position) - lookBehind;
+    if (consumed > 0)
+    {
+        int kept = numBuffered - consumed;
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            float* samples = history.getWritePointer(channel);
+            std::memmove(samples, samples + consumed, size_t(kept) * sizeof(float));
+        }
+        numBuffered = kept;
+        position -= consumed;
+    }
+}
@@ -0,0 +1,180 @@
+/*
+  ==============================================================================
+
+    ReadAheadSource.cpp
+    Created: 4 Jun 2023 2:17:45pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "ReadAheadSource.h"
+
+//==============================================================================
+ReadAheadSource::DecodeThread::DecodeThread() : juce::TimeSliceThread("Deck read-ahead")
+{
+    startThread();
+}
+
+ReadAheadSource::DecodeThread::~DecodeThread()
+{
+    stopThread(2000);
+}
+
+//==============================================================================
+ReadAheadSource::ReadAheadSource(juce::PositionableAudioSource* _source,
+                                 int _numChannels,
+                                 double _sampleRate,
+                                 double _readAheadSeconds,
+                                 double _maxPlaybackRatio
+                                ) : source(_source),
+                                    readAheadSeconds(_readAheadSeconds),
+                                    sampleRate(_sampleRate),
+                                    ring(juce::jmax(1, _numChannels),
+                                         juce::roundToInt(_readAheadSeconds * _sampleRate * _maxPlaybackRatio) + 1),
+                                    fifo(ring.getNumSamples()),
+                                    targetSamples(juce::roundToInt(_readAheadSeconds * _sampleRate))
+{
+    decodeThread->addTimeSliceClient(this);
+}
+
+ReadAheadSource::~ReadAheadSource()
+{
+    // waits for a slice that is running to finish
+    decodeThread->removeTimeSliceClient(this);
+}
+
+void ReadAheadSource::prepareToPlay(int samplesPerBlockExpected, double newSampleRate)
+{
+    source->prepareToPlay(samplesPerBlockExpected, newSampleRate);
+}
+
+void ReadAheadSource::releaseResources()
+{
+    source->releaseResources();
+}
+
+void ReadAheadSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    auto start = playPosition.load();
+
+    // the buffer still holds audio from before the last seek
+    if (activeSeek.load(std::memory_order_acquire) != requestedSeek.load(std::memory_order_acquire))
+    {
+        int stale = fifo.getNumReady();
+        fifo.finishedRead(stale);
+        totalRead += stale;
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+    auto staleUntil = seekStartsAfter.load(std::memory_order_acquire);
+    if (totalRead < staleUntil)
+    {
+        int stale = int(juce::jmin(juce::int64(fifo.getNumReady()), staleUntil - totalRead));
+        fifo.finishedRead(stale);
+        totalRead += stale;
+    }
+
+    int numToRead = totalRead < staleUntil ? 0 : juce::jmin(fifo.getNumReady(), bufferToFill.numSamples);
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(numToRead, start1, size1, start2, size2);
+    for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+    {
+        // a mono file is played on every channel
+        int ringChannel = juce::jmin(channel, ring.getNumChannels() - 1);
+        if (size1 > 0)
+        {
+            bufferToFill.buffer->copyFrom(channel, bufferToFill.startSample, ring, ringChannel, start1, size1);
+        }
+        if (size2 > 0)
+        {
+            bufferToFill.buffer->copyFrom(channel, bufferToFill.startSample + size1, ring, ringChannel, start2, size2);
+        }
+    }
+    fifo.finishedRead(size1 + size2);
+    totalRead += size1 + size2;
+    // a seek made while this block was read wins over moving on past it
+    playPosition.compare_exchange_strong(start, start + size1 + size2);
+
+    if (numToRead < bufferToFill.numSamples)
+    {
+        bufferToFill.buffer->clear(bufferToFill.startSample + numToRead, bufferToFill.numSamples - numToRead);
+        numUnderruns.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ReadAheadSource::setNextReadPosition(juce::int64 newPosition)
+{
+    playPosition.store(newPosition);
+    seekPosition.store(newPosition);
+    requestedSeek.fetch_add(1, std::memory_order_acq_rel);
+    decodeThread->moveToFrontOfQueue(this);
+}
+
+juce::int64 ReadAheadSource::getNextReadPosition() const
+{
+    return playPosition.load();
+}
+
+juce::int64 ReadAheadSource::getTotalLength() const
+{
+    return source->getTotalLength();
+}
+
+bool ReadAheadSource::isLooping() const
+{
+    return false;
+}
+
+void ReadAheadSource::setPlaybackRatio(double ratio)
+{
+    int target = juce::roundToInt(readAheadSeconds * sampleRate * juce::jmax(1.0, ratio));
+    targetSamples.store(juce::jmin(target, fifo.getTotalSize() - 1));
+}
+
+int ReadAheadSource::getNumUnderruns() const
+{
+    return numUnderruns.load(std::memory_order_relaxed);
+}
+
+float ReadAheadSource::getFillLevel() const
+{
+    return juce::jmin(1.0f, fifo.getNumReady() / float(juce::jmax(1, targetSamples.load())));
+}
+
+int ReadAheadSource::useTimeSlice()
+{
+    auto seek = requestedSeek.load(std::memory_order_acquire);
+    if (seek != decodingSeek)
+    {
+        // everything written from here on belongs to the new position
+        decodingSeek = seek;
+        sourcePosition = seekPosition.load();
+        source->setNextReadPosition(sourcePosition);
+        seekStartsAfter.store(totalWritten, std::memory_order_release);
+        activeSeek.store(seek, std::memory_order_release);
+    }
+
+    // reading carries on past the end of the file, which just decodes silence,
+    // so the transport sees the position go past the end and stops
+    int numToWrite = juce::jmin(targetSamples.load() - fifo.getNumReady(), fifo.getFreeSpace(), maxSamplesPerSlice);
+    if (numToWrite <= 0)
+    {
+        return 5;
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numToWrite, start1, size1, start2, size2);
+    if (size1 > 0)
+    {
+        source->getNextAudioBlock(juce::AudioSourceChannelInfo(&ring, start1, size1));
+    }
+    if (size2 > 0)
+    {
+        source->getNextAudioBlock(juce::AudioSourceChannelInfo(&ring, start2, size2));
+    }
+    fifo.finishedWrite(size1 + size2);
+    totalWritten += size1 + size2;
+    sourcePosition += size1 + size2;
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    ReadAheadSource.h
+    Created: 4 Jun 2023 2:17:45pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+//==============================================================================
+/*
+    Decodes a deck's audio ahead of the playhead on a background thread, so
+    disk reads and decoding never happen in the audio callback.
+
+    The decoded audio is passed through a lock-free ring buffer. How far
+    ahead it reads follows the playback ratio, as a deck playing at 4x uses
+    up audio four times as fast. If the audio thread ever finds the buffer
+    empty it plays silence for the missing part and counts an underrun.
+
+    Seeking never blocks either thread: the background thread starts again
+    from the new position and the audio thread throws away anything in the
+    buffer from before the seek.
+*/
+class ReadAheadSource : public juce::PositionableAudioSource,
+                        private juce::TimeSliceClient
+{
+    public:
+        /**The thread every deck's read-ahead is done on*/
+        class DecodeThread : public juce::TimeSliceThread
+        {
+            public:
+                DecodeThread();
+                ~DecodeThread() override;
+        };
+
+        ReadAheadSource(juce::PositionableAudioSource* _source,
+                        int _numChannels,
+                        double _sampleRate,
+                        double _readAheadSeconds,
+                        double _maxPlaybackRatio);
+        ~ReadAheadSource() override;
+
+        void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+        void releaseResources() override;
+        void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+        void setNextReadPosition(juce::int64 newPosition) override;
+        juce::int64 getNextReadPosition() const override;
+        juce::int64 getTotalLength() const override;
+        bool isLooping() const override;
+
+        /**Reads further ahead the faster the deck is playing*/
+        void setPlaybackRatio(double ratio);
+        /**Times the audio thread found too little audio decoded*/
+        int getNumUnderruns() const;
+        /**How full the buffer is compared to how far ahead it is trying to read, from 0 to 1*/
+        float getFillLevel() const;
+
+    private:
+        int useTimeSlice() override;
+
+        std::unique_ptr<juce::PositionableAudioSource> source;
+        juce::SharedResourcePointer<DecodeThread> decodeThread;
+        double readAheadSeconds;
+        double sampleRate;
+
+        juce::AudioBuffer<float> ring;
+        juce::AbstractFifo fifo;
+        std::atomic<int> targetSamples;
+
+        /**Where the audio thread is playing from*/
+        std::atomic<juce::int64> playPosition{ 0 };
+        /**Where the last seek asked the background thread to read from*/
+        std::atomic<juce::int64> seekPosition{ 0 };
+        std::atomic<juce::uint32> requestedSeek{ 0 };
+        /**The seek the buffered audio belongs to, and how many samples had been
+           written to the buffer before it started*/
+        std::atomic<juce::uint32> activeSeek{ 0 };
+        std::atomic<juce::int64> seekStartsAfter{ 0 };
+
+        /**Only touched by the background thread*/
+        juce::uint32 decodingSeek{ 0 };
+        juce::int64 sourcePosition{ 0 };
+        juce::int64 totalWritten{ 0 };
+        /**Only touched by the audio thread*/
+        juce::int64 totalRead{ 0 };
+
+        std::atomic<int> numUnderruns{ 0 };
+
+        /**Most samples decoded in one go, so a seek is never held up for long*/
+        static constexpr int maxSamplesPerSlice = 8192;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReadAheadSource)
+};
@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    RealFft.cpp
+    Created: 13 Aug 2023 10:26:41am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "RealFft.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #define DJ_USE_SSE2 1
+ #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+ #define DJ_USE_NEON 1
+ #include <arm_neon.h>
+#endif
+
+RealFft::RealFft(int order)
+    : size(1 << order),
+      half(1 << (order - 1)),
+      bitReversed(size_t(half)),
+      twiddleRe(size_t(juce::jmax(1, half - 1))),
+      twiddleIm(size_t(juce::jmax(1, half - 1))),
+      splitRe(size_t(half + 1)),
+      splitIm(size_t(half + 1)),
+      re(size_t(half)),
+      im(size_t(half))
+{
+    jassert(order >= 2);
+    int bits = order - 1;
+    for (int i = 0; i < half; ++i)
+    {
+        int reversed = 0;
+        for (int bit = 0; bit < bits; ++bit)
+        {
+            reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+        }
+        bitReversed[size_t(i)] = reversed;
+    }
+
+    for (int h = 1; h < half; h *= 2)
+    {
+        for (int j = 0; j < h; ++j)
+        {
+            double angle = -juce::MathConstants<double>::pi * j / h;
+            twiddleRe[size_t(h - 1 + j)] = float(std::cos(angle));
+            twiddleIm[size_t(h - 1 + j)] = float(std::sin(angle));
+        }
+    }
+
+    for (int k = 0; k <= half; ++k)
+    {
+        double angle = -2.0 * juce::MathConstants<double>::pi * k / size;
+        splitRe[size_t(k)] = float(std::cos(angle));
+        splitIm[size_t(k)] = float(std::sin(angle));
+    }
+}
+
+int RealFft::getSize() const
+{
+    return size;
+}
+
+void RealFft::performMagnitudes(const float* samples, float* magnitudes)
+{
+    // even samples are the real parts and odd samples the imaginary parts
+    for (int i = 0; i < half; ++i)
+    {
+        auto to = size_t(bitReversed[size_t(i)]);
+        re[to] = samples[2 * i];
+        im[to] = samples[2 * i + 1];
+    }
+    performComplex();
+
+    for (int k = 0; k <= half; ++k)
+    {
+        // bin k and the mirror of bin half - k give the even and odd samples' spectra
+        auto a = size_t(k % half);
+        auto b = size_t((half - k) % half);
+        float evenRe = 0.5f * (re[a] + re[b]);
+        float evenIm = 0.5f * (im[a] - im[b]);
+        float oddRe = 0.5f * (im[a] + im[b]);
+        float oddIm = -0.5f * (re[a] - re[b]);
+        float binRe = evenRe + splitRe[size_t(k)] * oddRe - splitIm[size_t(k)] * oddIm;
+        float binIm = evenIm + splitRe[size_t(k)] * oddIm + splitIm[size_t(k)] * oddRe;
+        magnitudes[k] = std::sqrt(binRe * binRe + binIm * binIm);
+    }
+}
+
+void RealFft::performComplex()
+{
+    for (int h = 1; h < half; h *= 2)
+    {
+        const float* wRe = twiddleRe.data() + h - 1;
+        const float* wIm = twiddleIm.data() + h - 1;
+        for (int start = 0; start < half; start += 2 * h)
+        {
+            float* aRe = re.data() + start;
+            float* aIm = im.data() + start;
+            float* bRe = aRe + h;
+            float* bIm = aIm + h;
+            int j = 0;
+           #if DJ_USE_SSE2
+            for (; j + 4 <= h; j += 4)
+            {
+                __m128 cosine = _mm_loadu_ps(wRe + j);
+                __m128 sine = _mm_loadu_ps(wIm + j);
+                __m128 br = _mm_loadu_ps(bRe + j);
+                __m128 bi = _mm_loadu_ps(bIm + j);
+                __m128 tr = _mm_sub_ps(_mm_mul_ps(br, cosine), _mm_mul_ps(bi, sine));
+                __m128 ti = _mm_add_ps(_mm_mul_ps(br, sine), _mm_mul_ps(bi, cosine));
+                __m128 ar = _mm_loadu_ps(aRe + j);
+                __m128 ai = _mm_loadu_ps(aIm + j);
+                _mm_storeu_ps(bRe + j, _mm_sub_ps(ar, tr));
+                _mm_storeu_ps(bIm + j, _mm_sub_ps(ai, ti));
+                _mm_storeu_ps(aRe + j, _mm_add_ps(ar, tr));
+                _mm_storeu_ps(aIm + j, _mm_add_ps(ai, ti));
+            }
+           #elif DJ_USE_NEON
+            for (; j + 4 <= h; j += 4)
+            {
+                float32x4_t cosine = vld1q_f32(wRe + j);
+                float32x4_t sine = vld1q_f32(wIm + j);
+                float32x4_t br = vld1q_f32(bRe + j);
+                float32x4_t bi = vld1q_f32(bIm + j);
+                float32x4_t tr = vmlsq_f32(vmulq_f32(br, cosine), bi, sine);
+                float32x4_t ti = vmlaq_f32(vmulq_f32(br, sine), bi, cosine);
+                float32x4_t ar = vld1q_f32(aRe + j);
+                float32x4_t ai = vld1q_f32(aIm + j);
+                vst1q_f32(bRe + j, vsubq_f32(ar, tr));
+                vst1q_f32(bIm + j, vsubq_f32(ai, ti));
+                vst1q_f32(aRe + j, vaddq_f32(ar, tr));
+                vst1q_f32(aIm + j, vaddq_f32(ai, ti));
+            }
+           #endif
+            for (; j < h; ++j)
+            {
+                float tr = bRe[j] * wRe[j] - bIm[j] * wIm[j];
+                float ti = bRe[j] * wIm[j] + bIm[j] * wRe[j];
+                bRe[j] = aRe[j] - tr;
+                bIm[j] = aIm[j] - ti;
+                aRe[j] += tr;
+                aIm[j] += ti;
+            }
+        }
+    }
+}
@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    RealFft.h
+    Created: 13 Aug 2023 10:26:41am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+//==============================================================================
+/*
+    The spectrum of a block of real samples, for analysing tracks off the
+    audio thread. The project doesn't use the juce_dsp module, so this is a
+    small power-of-two FFT of its own.
+
+    The samples are packed into a complex transform half the size, whose
+    bins are split back apart at the end. The transform is radix-2 over
+    separate real and imaginary arrays, with each stage's twiddles stored
+    in a row, so every butterfly of a stage runs in vector lanes.
+*/
+class RealFft
+{
+    public:
+        /**Transforms 2 to the power of order samples*/
+        RealFft(int order);
+
+        int getSize() const;
+        /**Fills magnitudes with the getSize() / 2 + 1 bins from 0Hz to Nyquist*/
+        void performMagnitudes(const float* samples, float* magnitudes);
+
+    private:
+        /**Runs the butterflies over re and im, which are in bit-reversed order*/
+        void performComplex();
+
+        int size;
+        /**The complex transform is half the size*/
+        int half;
+        std::vector<int> bitReversed;
+        /**Each stage's twiddles in a row, the stage with span 2h starting at h - 1*/
+        std::vector<float> twiddleRe, twiddleIm;
+        /**Turns the packed transform's bins into the real transform's*/
+        std::vector<float> splitRe, splitIm;
+        std::vector<float> re, im;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RealFft)
+};
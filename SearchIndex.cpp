@@ -0,0 +1,786 @@
+/*
+  ==============================================================================
+
+    SearchIndex.cpp
+    Created: 23 Apr 2023 3:48:12pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "SearchIndex.h"
+#include <algorithm>
+#include <string_view>
+
+namespace
+{
+    /**Base letters for U+00DF to U+00FF, after lower-casing*/
+    const char* const latin1Folds[] = {
+        "ss",                                                   // ß
+        "a", "a", "a", "a", "a", "a", "ae", "c",                // à - ç
+        "e", "e", "e", "e", "i", "i", "i", "i",                 // è - ï
+        "d", "n", "o", "o", "o", "o", "o", " ",                 // ð - ÷
+        "o", "u", "u", "u", "u", "y", "th", "y"                 // ø - ÿ
+    };
+
+    /**Base letters for ranges of Latin Extended-A (U+0100 to U+017F)*/
+    struct FoldRange
+    {
+        juce::juce_wchar last;
+        const char* base;
+    };
+    const FoldRange latinExtendedFolds[] = {
+        { 0x105, "a" }, { 0x10d, "c" }, { 0x111, "d" }, { 0x11b, "e" }, { 0x123, "g" },
+        { 0x127, "h" }, { 0x131, "i" }, { 0x133, "ij" }, { 0x135, "j" }, { 0x138, "k" },
+        { 0x142, "l" }, { 0x14b, "n" }, { 0x151, "o" }, { 0x153, "oe" }, { 0x159, "r" },
+        { 0x161, "s" }, { 0x167, "t" }, { 0x173, "u" }, { 0x175, "w" }, { 0x178, "y" },
+        { 0x17e, "z" }, { 0x17f, "s" }
+    };
+
+    const juce::uint32 oneLetterPrefix = 0x01000000;
+    const juce::uint32 twoLetterPrefix = 0x02000000;
+
+    /**Where a word starting with a prefix was found, best match first. A
+       query word of one or two letters ranks by this alone*/
+    enum PrefixPlace : juce::uint32
+    {
+        titleStart,
+        titleWord,
+        artistStart,
+        artistWord,
+        keyWord,
+        numPrefixPlaces
+    };
+    /**What a short query word adds to a track's score in each place, the same
+       as scoreMatch() and search() would give it*/
+    const int prefixPlaceScores[numPrefixPlaces] = { 6, 5, 3, 2, 0 };
+
+    juce::uint32 trigramKey(std::string_view text, size_t i)
+    {
+        return (juce::uint32(juce::uint8(text[i])) << 16)
+             | (juce::uint32(juce::uint8(text[i + 1])) << 8)
+             | juce::uint32(juce::uint8(text[i + 2]));
+    }
+
+    juce::uint32 prefixKey(const std::string& word, juce::uint32 place)
+    {
+        if (word.size() == 1)
+        {
+            return oneLetterPrefix | (place << 26) | juce::uint8(word[0]);
+        }
+        return twoLetterPrefix | (place << 26) | (juce::uint32(juce::uint8(word[0])) << 8) | juce::uint8(word[1]);
+    }
+
+    /**Moves through an ascending list to the first entry not below docIndex,
+       galloping so that skipping far ahead costs the log of the distance
+       rather than the distance. True if docIndex is in the list*/
+    bool advanceTo(const std::vector<juce::uint32>& list, size_t& next, juce::uint32 docIndex)
+    {
+        if (next < list.size() && list[next] < docIndex)
+        {
+            size_t low = next;
+            size_t step = 1;
+            while (low + step < list.size() && list[low + step] < docIndex)
+            {
+                low += step;
+                step *= 2;
+            }
+            auto end = list.begin() + std::ptrdiff_t(std::min(low + step + 1, list.size()));
+            next = size_t(std::lower_bound(list.begin() + std::ptrdiff_t(low + 1), end, docIndex) - list.begin());
+        }
+        return next < list.size() && list[next] == docIndex;
+    }
+
+    /**Appends the entries two ascending lists share. The lists interleave
+       at random, so both step forward by comparison rather than by branch*/
+    void intersect(const std::vector<juce::uint32>& a, const std::vector<juce::uint32>& b,
+                   std::vector<juce::uint32>& shared)
+    {
+        size_t i = 0;
+        size_t j = 0;
+        while (i < a.size() && j < b.size())
+        {
+            auto x = a[i];
+            auto y = b[j];
+            if (x == y)
+            {
+                shared.push_back(x);
+            }
+            i += x <= y ? 1 : 0;
+            j += y <= x ? 1 : 0;
+        }
+    }
+
+    /**The lists of where words start with a short prefix, walked alongside
+       candidates in ascending order*/
+    struct PrefixCursor
+    {
+        PrefixCursor(const std::unordered_map<juce::uint32, std::vector<juce::uint32>>& postings,
+                     const std::string& prefix)
+        {
+            for (juce::uint32 place = 0; place < numPrefixPlaces; ++place)
+            {
+                auto it = postings.find(prefixKey(prefix, place));
+                lists[place] = it != postings.end() ? &it->second : nullptr;
+            }
+        }
+
+        /**The best of the first numPlaces places the document has a word
+           starting with the prefix, numPrefixPlaces where it has none.
+           Documents must be asked about in ascending order*/
+        juce::uint32 findPlace(juce::uint32 docIndex, juce::uint32 numPlaces = numPrefixPlaces)
+        {
+            for (juce::uint32 place = 0; place < numPlaces; ++place)
+            {
+                if (lists[place] != nullptr && advanceTo(*lists[place], next[place], docIndex))
+                {
+                    return place;
+                }
+            }
+            return numPrefixPlaces;
+        }
+
+        const std::vector<juce::uint32>* lists[numPrefixPlaces];
+        size_t next[numPrefixPlaces]{};
+    };
+
+    /**How many candidates ahead the text is fetched while checking them*/
+    const std::ptrdiff_t prefetchDistance = 8;
+
+    /**Asks for memory to be brought into cache before it is read*/
+    inline void prefetch(const void* address)
+    {
+       #if JUCE_GCC || JUCE_CLANG
+        __builtin_prefetch(address);
+       #else
+        juce::ignoreUnused(address);
+       #endif
+    }
+
+    /**A candidate with the most it can score, and what its short words
+       score, which the prefix lists give exactly*/
+    struct Candidate
+    {
+        juce::uint32 docIndex;
+        juce::uint8 bound;
+        juce::uint8 shortScore;
+    };
+
+    std::vector<std::string> splitWords(std::string_view text)
+    {
+        std::vector<std::string> words;
+        size_t start = 0;
+        while (start < text.size())
+        {
+            size_t end = text.find(' ', start);
+            if (end == std::string_view::npos)
+            {
+                end = text.size();
+            }
+            if (end > start)
+            {
+                words.emplace_back(text.substr(start, end - start));
+            }
+            start = end + 1;
+        }
+        return words;
+    }
+
+    /**Scores how well one query word matches one field, 0 if it doesn't*/
+    int scoreMatch(std::string_view field, const std::string& word)
+    {
+        int best = 0;
+        for (size_t pos = field.find(word); pos != std::string_view::npos; pos = field.find(word, pos + 1))
+        {
+            if (pos == 0)
+            {
+                return 3; // start of the field
+            }
+            if (field[pos - 1] == ' ')
+            {
+                best = 2; // start of a word
+            }
+            else if (best == 0)
+            {
+                best = 1; // somewhere inside a word
+            }
+        }
+        return best;
+    }
+
+    /**Whether a query word is the whole of one of the field's words, so "8a"
+       doesn't find 8B nor "a" every key in A*/
+    bool isWholeWord(std::string_view field, const std::string& word)
+    {
+        for (size_t pos = field.find(word); pos != std::string_view::npos; pos = field.find(word, pos + 1))
+        {
+            size_t end = pos + word.size();
+            if ((pos == 0 || field[pos - 1] == ' ') && (end == field.size() || field[end] == ' '))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+//==============================================================================
+SearchIndex::SearchIndex()
+{
+}
+
+void SearchIndex::add(juce::uint32 id, const juce::String& title, const juce::String& artist,
+                      const juce::String& key)
+{
+    if (docIndexById.count(id) != 0)
+    {
+        remove(id);
+    }
+    auto docIndex = juce::uint32(documents.size());
+    Document doc;
+    doc.title = juce::uint32(text.size());
+    text += normalise(title);
+    doc.artist = juce::uint32(text.size());
+    text += normalise(artist);
+    doc.key = juce::uint32(text.size());
+    text += normalise(key);
+    doc.end = juce::uint32(text.size());
+    documents.push_back(doc);
+    docIds.push_back(id);
+    docRemoved.push_back(false);
+    docIndexById[id] = docIndex;
+    indexDocument(docIndex);
+}
+
+void SearchIndex::remove(juce::uint32 id)
+{
+    auto it = docIndexById.find(id);
+    if (it == docIndexById.end())
+    {
+        return;
+    }
+    // postings still point at the document until the next rebuild
+    docRemoved[it->second] = true;
+    docIndexById.erase(it);
+    ++numRemoved;
+
+    if (numRemoved > 1024 && numRemoved > documents.size() / 4)
+    {
+        rebuild();
+    }
+}
+
+void SearchIndex::clear()
+{
+    documents.clear();
+    text.clear();
+    docIds.clear();
+    docRemoved.clear();
+    docIndexById.clear();
+    postings.clear();
+    numRemoved = 0;
+}
+
+std::vector<juce::uint32> SearchIndex::search(const juce::String& query, size_t maxResults) const
+{
+    auto words = splitWords(normalise(query));
+    if (words.empty() || maxResults == 0)
+    {
+        return {};
+    }
+    if (words.size() == 1 && words[0].size() < 3)
+    {
+        return searchPrefix(words[0], maxResults);
+    }
+
+    // a short word is looked up in its prefix's lists rather than checked
+    // against the text, and the longer words' trigrams give the candidates.
+    // A word's own trigrams mostly list the same tracks, so every word's
+    // rarest is intersected before the rest
+    std::vector<const std::vector<juce::uint32>*> lists;
+    std::vector<const std::vector<juce::uint32>*> otherLists;
+    auto bySize = [](const auto* a, const auto* b) { return a->size() < b->size(); };
+    for (const auto& word : words)
+    {
+        if (word.size() < 3)
+        {
+            continue;
+        }
+        auto numOthers = otherLists.size();
+        for (size_t i = 0; i + 3 <= word.size(); ++i)
+        {
+            auto it = postings.find(trigramKey(word, i));
+            if (it == postings.end())
+            {
+                return {};
+            }
+            otherLists.push_back(&it->second);
+        }
+        auto rarest = std::min_element(otherLists.begin() + std::ptrdiff_t(numOthers), otherLists.end(), bySize);
+        lists.push_back(*rarest);
+        otherLists.erase(rarest);
+    }
+    std::sort(lists.begin(), lists.end(), bySize);
+    std::sort(otherLists.begin(), otherLists.end(), bySize);
+    lists.insert(lists.end(), otherLists.begin(), otherLists.end());
+
+    std::vector<juce::uint32> candidates;
+    if (lists.empty())
+    {
+        // every word is short, so the tracks listed under the prefix listing
+        // the fewest are the candidates
+        auto numListed = [this](const std::string& word)
+        {
+            size_t total = 0;
+            for (const auto* list : PrefixCursor{ postings, word }.lists)
+            {
+                total += list != nullptr ? list->size() : 0;
+            }
+            return total;
+        };
+        auto rarest = std::min_element(words.begin(), words.end(),
+                                       [&numListed](const auto& a, const auto& b) { return numListed(a) < numListed(b); });
+        findListed(*rarest, candidates);
+    }
+    else
+    {
+        // intersect starting from the shortest list, and stop once there are
+        // few enough candidates that checking them directly is cheaper. A
+        // list far longer than the candidates would remove few of them, so
+        // it is left to the text check
+        candidates = *lists.front();
+        std::vector<juce::uint32> intersection;
+        for (size_t i = 1; i < lists.size() && candidates.size() > 64; ++i)
+        {
+            const auto& list = *lists[i];
+            if (list.size() > 64 * candidates.size())
+            {
+                continue;
+            }
+            intersection.clear();
+            if (list.size() > 4 * candidates.size())
+            {
+                // a common trigram lists much of the library, so it's galloped
+                // through for each candidate rather than walked
+                size_t next = 0;
+                for (auto docIndex : candidates)
+                {
+                    if (advanceTo(list, next, docIndex))
+                    {
+                        intersection.push_back(docIndex);
+                    }
+                }
+            }
+            else
+            {
+                intersect(candidates, list, intersection);
+            }
+            candidates.swap(intersection);
+        }
+    }
+
+    // bound every candidate's score from the prefix lists alone: a short word
+    // scores by its place exactly, and a longer word can only open the title
+    // or start one of its words if its first two letters are listed there
+    const int maxScore = 6 * int(words.size());
+    std::vector<int> bounds(candidates.size(), 0);
+    std::vector<int> shortScores(candidates.size(), 0);
+    std::vector<juce::uint8> places;
+    for (const auto& word : words)
+    {
+        bool isShort = word.size() < 3;
+        findPlaces(word.substr(0, 2), isShort ? juce::uint32(numPrefixPlaces) : juce::uint32(titleWord + 1),
+                   candidates, places);
+        for (size_t c = 0; c < candidates.size(); ++c)
+        {
+            int score = places[c] != numPrefixPlaces ? prefixPlaceScores[places[c]] : (isShort ? -1 : 4);
+            bounds[c] = bounds[c] < 0 || score < 0 ? -1 : bounds[c] + score;
+            shortScores[c] += isShort ? score : 0;
+        }
+    }
+
+    std::vector<Candidate> bounded;
+    bounded.reserve(candidates.size());
+    std::vector<size_t> levelSizes(size_t(maxScore + 1), 0);
+    for (size_t c = 0; c < candidates.size(); ++c)
+    {
+        if (bounds[c] >= 0 && !docRemoved[candidates[c]])
+        {
+            bounded.push_back({ candidates[c], juce::uint8(bounds[c]), juce::uint8(shortScores[c]) });
+            ++levelSizes[size_t(bounds[c])];
+        }
+    }
+
+    // order the candidates by their bound, highest first and in library order
+    // within each, so checking can stop as soon as nothing left could rank
+    // among the best maxResults
+    std::vector<size_t> levelStarts(size_t(maxScore + 2), 0);
+    for (int level = maxScore; level > 0; --level)
+    {
+        levelStarts[size_t(level - 1)] = levelStarts[size_t(level)] + levelSizes[size_t(level)];
+    }
+    std::vector<Candidate> ordered(bounded.size());
+    {
+        auto next = levelStarts;
+        for (const auto& candidate : bounded)
+        {
+            ordered[next[candidate.bound]++] = candidate;
+        }
+    }
+
+    // trigrams don't have to be next to each other, so confirm every word
+    // really is there, then bucket the matches by score
+    std::vector<std::vector<juce::uint32>> buckets(size_t(maxScore + 1));
+    bool isComplete = false;
+    for (int level = maxScore; level >= 0 && !isComplete; --level)
+    {
+        size_t numAbove = 0;
+        for (int score = level + 1; score <= maxScore; ++score)
+        {
+            numAbove += buckets[size_t(score)].size();
+        }
+        isComplete = numAbove >= maxResults;
+
+        // a candidate scoring its bound here ranks above everything after it
+        size_t numAtLevel = 0;
+        auto begin = ordered.begin() + std::ptrdiff_t(levelStarts[size_t(level)]);
+        auto end = begin + std::ptrdiff_t(levelSizes[size_t(level)]);
+        for (auto candidate = begin; candidate != end && !isComplete; ++candidate)
+        {
+            // candidates are spread over the library, so each one's text is
+            // asked for a few candidates ahead of checking it
+            if (end - candidate > prefetchDistance)
+            {
+                const Document& ahead = documents[candidate[prefetchDistance].docIndex];
+                prefetch(text.data() + ahead.title);
+                prefetch(text.data() + ahead.artist);
+                prefetch(&docIds[candidate[prefetchDistance].docIndex]);
+            }
+            if (end - candidate > 2 * prefetchDistance)
+            {
+                prefetch(&documents[candidate[2 * prefetchDistance].docIndex]);
+            }
+            const Document& doc = documents[candidate->docIndex];
+            int score = candidate->shortScore;
+            for (size_t w = 0; w < words.size() && score >= 0; ++w)
+            {
+                if (words[w].size() < 3)
+                {
+                    continue;
+                }
+                int titleScore = scoreMatch(getField(doc.title, doc.artist), words[w]);
+                int artistScore = scoreMatch(getField(doc.artist, doc.key), words[w]);
+                if (titleScore == 0 && artistScore == 0 && !isWholeWord(getField(doc.key, doc.end), words[w]))
+                {
+                    score = -1;
+                }
+                else
+                {
+                    // title matches rank above artist matches, and both above the key
+                    score += titleScore > 0 ? titleScore + 3 : artistScore;
+                }
+            }
+            if (score >= 0)
+            {
+                buckets[size_t(score)].push_back(candidate->docIndex);
+                numAtLevel += score == level ? 1 : 0;
+                isComplete = numAbove + numAtLevel >= maxResults;
+            }
+        }
+    }
+
+    // a bucket is filled from more than one level, so it is put back into
+    // library order before the best are taken
+    std::vector<juce::uint32> results;
+    for (auto bucket = buckets.rbegin(); bucket != buckets.rend() && results.size() < maxResults; ++bucket)
+    {
+        std::sort(bucket->begin(), bucket->end());
+        for (size_t i = 0; i < bucket->size() && results.size() < maxResults; ++i)
+        {
+            results.push_back(docIds[(*bucket)[i]]);
+        }
+    }
+    return results;
+}
+
+void SearchIndex::findPlaces(const std::string& prefix, juce::uint32 numPlaces,
+                             const std::vector<juce::uint32>& candidates, std::vector<juce::uint8>& places) const
+{
+    PrefixCursor cursor{ postings, prefix };
+    size_t numListed = 0;
+    for (juce::uint32 place = 0; place < numPlaces; ++place)
+    {
+        numListed += cursor.lists[place] != nullptr ? cursor.lists[place]->size() : 0;
+    }
+
+    places.resize(candidates.size());
+    if (numListed > 16 * candidates.size())
+    {
+        // the lists are far longer than the candidates, so each candidate is
+        // searched for rather than the lists walked through
+        for (size_t c = 0; c < candidates.size(); ++c)
+        {
+            places[c] = juce::uint8(cursor.findPlace(candidates[c], numPlaces));
+        }
+        return;
+    }
+
+    // mark every listed document with its best place, which is written last
+    // over any worse one, read the candidates' and put the marks back
+    if (scratchPlaces.size() < documents.size())
+    {
+        scratchPlaces.resize(documents.size(), juce::uint8(numPrefixPlaces));
+    }
+    for (juce::uint32 place = numPlaces; place-- > 0;)
+    {
+        if (cursor.lists[place] != nullptr)
+        {
+            for (auto docIndex : *cursor.lists[place])
+            {
+                scratchPlaces[docIndex] = juce::uint8(place);
+            }
+        }
+    }
+    for (size_t c = 0; c < candidates.size(); ++c)
+    {
+        places[c] = scratchPlaces[candidates[c]];
+    }
+    for (juce::uint32 place = 0; place < numPlaces; ++place)
+    {
+        if (cursor.lists[place] != nullptr)
+        {
+            for (auto docIndex : *cursor.lists[place])
+            {
+                scratchPlaces[docIndex] = juce::uint8(numPrefixPlaces);
+            }
+        }
+    }
+}
+
+void SearchIndex::findListed(const std::string& prefix, std::vector<juce::uint32>& listed) const
+{
+    // the lists overlap, so their tracks are marked and then read off in order
+    // rather than merged
+    PrefixCursor cursor{ postings, prefix };
+    if (scratchPlaces.size() < documents.size())
+    {
+        scratchPlaces.resize(documents.size(), juce::uint8(numPrefixPlaces));
+    }
+    for (const auto* list : cursor.lists)
+    {
+        if (list != nullptr)
+        {
+            for (auto docIndex : *list)
+            {
+                scratchPlaces[docIndex] = 0;
+            }
+        }
+    }
+    for (juce::uint32 docIndex = 0; docIndex < documents.size(); ++docIndex)
+    {
+        if (scratchPlaces[docIndex] != numPrefixPlaces)
+        {
+            scratchPlaces[docIndex] = juce::uint8(numPrefixPlaces);
+            listed.push_back(docIndex);
+        }
+    }
+}
+
+std::vector<juce::uint32> SearchIndex::searchPrefix(const std::string& word, size_t maxResults) const
+{
+    // the lists hold exactly the tracks with a word starting with these letters
+    // in each place, so no text needs checking, and taking the lists best
+    // place first ranks the tracks
+    std::vector<const std::vector<juce::uint32>*> lists;
+    for (juce::uint32 place = 0; place < numPrefixPlaces; ++place)
+    {
+        auto it = postings.find(prefixKey(word, place));
+        if (it != postings.end())
+        {
+            lists.push_back(&it->second);
+        }
+    }
+
+    // a track already listed in a better place was already taken, which a
+    // search of the few lists before finds without marking the whole library
+    std::vector<juce::uint32> results;
+    for (size_t l = 0; l < lists.size() && results.size() < maxResults; ++l)
+    {
+        for (auto docIndex : *lists[l])
+        {
+            if (docRemoved[docIndex])
+            {
+                continue;
+            }
+            bool isTaken = false;
+            for (size_t better = 0; better < l && !isTaken; ++better)
+            {
+                isTaken = std::binary_search(lists[better]->begin(), lists[better]->end(), docIndex);
+            }
+            if (!isTaken)
+            {
+                results.push_back(docIds[docIndex]);
+                if (results.size() == maxResults)
+                {
+                    break;
+                }
+            }
+        }
+    }
+    return results;
+}
+
+std::string SearchIndex::normalise(const juce::String& text)
+{
+    std::string folded;
+    folded.reserve(text.getNumBytesAsUTF8());
+    auto appendSpace = [&folded]
+    {
+        if (!folded.empty() && folded.back() != ' ')
+        {
+            folded.push_back(' ');
+        }
+    };
+
+    for (auto p = text.getCharPointer(); !p.isEmpty(); ++p)
+    {
+        auto c = juce::CharacterFunctions::toLowerCase(*p);
+        if (c < 0x80)
+        {
+            if (juce::CharacterFunctions::isLetterOrDigit(c))
+            {
+                folded.push_back(char(c));
+            }
+            else
+            {
+                appendSpace();
+            }
+        }
+        else if (c >= 0xdf && c <= 0xff)
+        {
+            folded += latin1Folds[c - 0xdf];
+        }
+        else if (c >= 0x100 && c <= 0x17f)
+        {
+            for (const auto& range : latinExtendedFolds)
+            {
+                if (c <= range.last)
+                {
+                    folded += range.base;
+                    break;
+                }
+            }
+        }
+        else if (juce::CharacterFunctions::isLetterOrDigit(c))
+        {
+            // anything else is kept as it is
+            char utf8[8];
+            auto numBytes = juce::CharPointer_UTF8::getBytesRequiredFor(c);
+            juce::CharPointer_UTF8(utf8).write(c);
+            folded.append(utf8, numBytes);
+        }
+        else
+        {
+            appendSpace();
+        }
+    }
+
+    if (!folded.empty() && folded.back() == ' ')
+    {
+        folded.pop_back();
+    }
+    return folded;
+}
+
+void SearchIndex::indexDocument(juce::uint32 docIndex)
+{
+    const Document& doc = documents[docIndex];
+    auto title = getField(doc.title, doc.artist);
+    auto artist = getField(doc.artist, doc.key);
+    auto key = getField(doc.key, doc.end);
+    std::vector<juce::uint32> keys;
+    addTrigrams(title, keys);
+    addTrigrams(artist, keys);
+    addTrigrams(key, keys);
+    addPrefixes(title, titleStart, titleWord, keys);
+    addPrefixes(artist, artistStart, artistWord, keys);
+    // a key's names only match whole, so only the short ones are listed
+    for (const auto& word : splitWords(key))
+    {
+        if (word.size() < 3)
+        {
+            keys.push_back(prefixKey(word, keyWord));
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    // documents are indexed in order, so every list stays sorted
+    for (auto key : keys)
+    {
+        postings[key].push_back(docIndex);
+    }
+}
+
+std::string_view SearchIndex::getField(juce::uint32 start, juce::uint32 end) const
+{
+    return std::string_view(text).substr(start, end - start);
+}
+
+void SearchIndex::addTrigrams(std::string_view fieldText, std::vector<juce::uint32>& keys)
+{
+    for (size_t i = 0; i + 3 <= fieldText.size(); ++i)
+    {
+        keys.push_back(trigramKey(fieldText, i));
+    }
+}
+
+void SearchIndex::addPrefixes(std::string_view fieldText, juce::uint32 firstWordPlace,
+                              juce::uint32 otherWordPlace, std::vector<juce::uint32>& keys)
+{
+    auto words = splitWords(fieldText);
+    for (size_t i = 0; i < words.size(); ++i)
+    {
+        auto place = i == 0 ? firstWordPlace : otherWordPlace;
+        keys.push_back(prefixKey(words[i].substr(0, 1), place));
+        if (words[i].size() >= 2)
+        {
+            keys.push_back(prefixKey(words[i].substr(0, 2), place));
+        }
+    }
+}
+
+void SearchIndex::rebuild()
+{
+    DBG("SearchIndex::rebuild dropping " << int(numRemoved) << " removed track(s)");
+    std::vector<Document> keptDocuments;
+    std::vector<juce::uint32> keptIds;
+    std::string keptText;
+    keptDocuments.reserve(documents.size() - numRemoved);
+    keptIds.reserve(documents.size() - numRemoved);
+    for (size_t i = 0; i < documents.size(); ++i)
+    {
+        if (!docRemoved[i])
+        {
+            // every offset moves down by the text dropped before it
+            Document doc = documents[i];
+            auto shift = doc.title - juce::uint32(keptText.size());
+            keptText.append(text, doc.title, doc.end - doc.title);
+            keptDocuments.push_back({ doc.title - shift, doc.artist - shift, doc.key - shift, doc.end - shift });
+            keptIds.push_back(docIds[i]);
+        }
+    }
+
+    documents.swap(keptDocuments);
+    text.swap(keptText);
+    docIds.swap(keptIds);
+    docRemoved.assign(documents.size(), false);
+    docIndexById.clear();
+    postings.clear();
+    numRemoved = 0;
+    for (juce::uint32 i = 0; i < documents.size(); ++i)
+    {
+        docIndexById[docIds[i]] = i;
+        indexDocument(i);
+    }
+}
@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    SearchIndex.h
+    Created: 23 Apr 2023 3:48:12pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//==============================================================================
+/*
+    In-memory search over track titles and artists, and over the names of
+    their keys.
+
+    Text is lower-cased, accents are folded to their base letters and
+    punctuation becomes spaces, so "Beyoncé" matches "beyonce" and
+    "c_major" matches "c major". Every trigram of the text, plus the first one
+    and two letters of every word, point to the tracks containing them.
+    A query intersects the lists for its words, checks the candidates and
+    returns the best of them ranked, best match first. The short prefixes are listed
+    apart by whether the word opens the title or artist, comes later in it
+    or names the key, so a query of one or two letters, which matches much
+    of the library, is answered from the lists without checking any text.
+
+    Tracks are added and removed one at a time as the library changes.
+*/
+class SearchIndex
+{
+    public:
+        SearchIndex();
+
+        /**Indexes a track under its stable id. The key's names, like "8A Am",
+           only match whole words*/
+        void add(juce::uint32 id, const juce::String& title, const juce::String& artist,
+                 const juce::String& key = {});
+        /**Removes a track from the index*/
+        void remove(juce::uint32 id);
+        /**Removes every track*/
+        void clear();
+        /**Gets the ids of the tracks best matching all the words of the query,
+           best match first and no more than maxResults of them. An empty
+           query matches nothing*/
+        std::vector<juce::uint32> search(const juce::String& query, size_t maxResults = 1000) const;
+
+        /**Lower-cases text, folds accents and turns punctuation into single spaces*/
+        static std::string normalise(const juce::String& text);
+
+    private:
+        /**Where a document's normalised title, artist and key names are in text*/
+        struct Document
+        {
+            juce::uint32 title;
+            juce::uint32 artist;
+            juce::uint32 key;
+            juce::uint32 end;
+        };
+
+        /**Answers a query of one word of one or two letters from the prefix lists alone*/
+        std::vector<juce::uint32> searchPrefix(const std::string& word, size_t maxResults) const;
+        /**The best of the first numPlaces places each candidate has a word
+           starting with a short prefix, numPrefixPlaces where it has none*/
+        void findPlaces(const std::string& prefix, juce::uint32 numPlaces,
+                        const std::vector<juce::uint32>& candidates, std::vector<juce::uint8>& places) const;
+        /**Appends every document with a word starting with a short prefix, in order*/
+        void findListed(const std::string& prefix, std::vector<juce::uint32>& listed) const;
+        std::string_view getField(juce::uint32 start, juce::uint32 end) const;
+        void indexDocument(juce::uint32 docIndex);
+        void rebuild();
+        static void addTrigrams(std::string_view fieldText, std::vector<juce::uint32>& keys);
+        /**Lists the first one and two letters of every word, by where the word is*/
+        static void addPrefixes(std::string_view fieldText, juce::uint32 firstWordPlace,
+                                juce::uint32 otherWordPlace, std::vector<juce::uint32>& keys);
+
+        std::vector<Document> documents;
+        /**Every document's text back to back, in document order, so checking
+           the candidates reads through it in order*/
+        std::string text;
+        /**Kept apart from the text, so listing a great many matches stays in cache*/
+        std::vector<juce::uint32> docIds;
+        std::vector<bool> docRemoved;
+        std::unordered_map<juce::uint32, juce::uint32> docIndexById;
+        /**Key to the ascending indices of the documents containing it*/
+        std::unordered_map<juce::uint32, std::vector<juce::uint32>> postings;
+        /**Where each document has a word, marked by findPlaces() and cleared
+           again before it returns, so a search doesn't allocate a place for
+           every track in the library. Searches come from one thread*/
+        mutable std::vector<juce::uint8> scratchPlaces;
+        size_t numRemoved{ 0 };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SearchIndex)
+};
@@ -0,0 +1,147 @@
+/*
+  ==============================================================================
+
+    SendReverb.cpp
+    Created: 23 Jul 2023 2:51:06pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "SendReverb.h"
+
+SendReverb::SendReverb()
+{
+    // only the reverb comes back, at the same level a deck's own reverb has at full wet
+    parameters.change([](juce::Reverb::Parameters& p)
+    {
+        p.roomSize = 0.5f;
+        p.damping = 0.5f;
+        p.wetLevel = 1.0f / 3.0f;
+        p.dryLevel = 0.0f;
+    });
+}
+
+void SendReverb::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    reverb.setSampleRate(sampleRate);
+    parameters.pull(audioParameters);
+    reverb.setParameters(audioParameters);
+    send.setSize(2, samplesPerBlockExpected);
+    send.clear();
+    for (auto& senderSend : senderSends)
+    {
+        senderSend.setSize(2, samplesPerBlockExpected);
+        senderSend.clear();
+    }
+    blockNumber.store(1, std::memory_order_relaxed);
+    for (auto& sent : sentBlocks)
+    {
+        sent.store(0, std::memory_order_relaxed);
+    }
+    idle = true;
+    silentSamples = 0;
+}
+
+void SendReverb::releaseResources()
+{
+    reverb.reset();
+}
+
+void SendReverb::setRoomSize(float size)
+{
+    parameters.change([size](juce::Reverb::Parameters& p) { p.roomSize = size; });
+}
+
+void SendReverb::setDamping(float dampingAmt)
+{
+    parameters.change([dampingAmt](juce::Reverb::Parameters& p) { p.damping = dampingAmt; });
+}
+
+juce::uint32 SendReverb::getBlockNumber() const
+{
+    return blockNumber.load(std::memory_order_acquire);
+}
+
+void SendReverb::addToSend(int sender,
+                           juce::uint32 block,
+                           const juce::AudioBuffer<float>& buffer,
+                           int startSample,
+                           int numSamples,
+                           float startLevel,
+                           float endLevel)
+{
+    jassert(sender >= 0 && sender < maxSenders);
+    // a deck that ran past its block is dropped, rather than mixed into the next
+    if (block != blockNumber.load(std::memory_order_acquire))
+    {
+        return;
+    }
+    auto& senderSend = senderSends[size_t(sender)];
+    if (senderSend.getNumSamples() < numSamples)
+    {
+        senderSend.setSize(2, numSamples, true, true, true);
+    }
+    if (sentBlocks[size_t(sender)].load(std::memory_order_relaxed) != block)
+    {
+        senderSend.clear(0, numSamples);
+    }
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        // a mono deck goes to both sides
+        int source = juce::jmin(channel, buffer.getNumChannels() - 1);
+        senderSend.addFromWithRamp(channel, 0, buffer.getReadPointer(source, startSample), numSamples, startLevel, endLevel);
+    }
+    sentBlocks[size_t(sender)].store(block, std::memory_order_release);
+}
+
+juce::AudioBuffer<float>* SendReverb::processReturn(int numSamples)
+{
+    if (send.getNumSamples() < numSamples)
+    {
+        send.setSize(2, numSamples, true, true, true);
+    }
+    send.clear(0, numSamples);
+    if (parameters.pull(audioParameters))
+    {
+        reverb.setParameters(audioParameters);
+    }
+
+    // every deck that finished in time is done by now, whichever thread
+    // rendered it. One still running finds the block gone and sends nothing,
+    // and a send it got in before the block moved on is never tagged with it
+    auto block = blockNumber.load(std::memory_order_relaxed);
+    bool anySent = false;
+    for (size_t sender = 0; sender < senderSends.size(); ++sender)
+    {
+        if (sentBlocks[sender].load(std::memory_order_acquire) == block)
+        {
+            for (int channel = 0; channel < 2; ++channel)
+            {
+                send.addFrom(channel, 0, senderSends[sender], channel, 0, numSamples);
+            }
+            anySent = true;
+        }
+    }
+    blockNumber.store(block + 1 != 0 ? block + 1 : 1, std::memory_order_release);
+
+    // about -100dB, well under anything that can be heard over the decks
+    const float silence = 1.0e-5f;
+    bool silentInput = !anySent || send.getMagnitude(0, numSamples) < silence;
+    if (silentInput && idle)
+    {
+        return nullptr;
+    }
+
+    reverb.processStereo(send.getWritePointer(0), send.getWritePointer(1), numSamples);
+    bool silentBlock = silentInput && send.getMagnitude(0, numSamples) < silence;
+    silentSamples = silentBlock ? silentSamples + numSamples : 0;
+    // a quiet block can still have sound on its way through the delays
+    idle = silentSamples >= reverb.getLongestDelay();
+    if (idle)
+    {
+        reverb.reset();
+    }
+
+    return &send;
+}
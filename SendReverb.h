@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    SendReverb.h
+    Created: 23 Jul 2023 2:51:06pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include "ParameterStore.h"
+#include "StereoReverb.h"
+
+//==============================================================================
+/*
+    One reverb on the mix that every deck can send some of its output to,
+    so the cost of reverb stays the same however many decks are playing.
+
+    During a block each deck adds its share to a send of its own, so decks
+    rendering on different threads never write to the same buffer, then the
+    mix adds the sends together, runs the reverb over the lot and mixes what
+    comes back in with the decks, before the master gain. Each send is
+    tagged with the block it was rendered for, and a deck that finishes
+    after its block has been mixed is dropped rather than heard late.
+
+    Once only silence has been sent and has come back for longer than the
+    longest way through the reverb, it stops running until a deck sends
+    something again. The room size and damping are shared by the decks,
+    whichever changed them last.
+*/
+class SendReverb
+{
+    public:
+        static constexpr int maxSenders = 8;
+
+        SendReverb();
+
+        void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+        void releaseResources();
+
+        /**Message thread: sets the size of the shared room*/
+        void setRoomSize(float size);
+        /**Message thread: sets the damping of the shared room*/
+        void setDamping(float dampingAmt);
+
+        /**Any audio thread: the block the decks are rendering for, which a
+           deck reads before it renders and passes back to addToSend()*/
+        juce::uint32 getBlockNumber() const;
+        /**Audio thread: adds a deck's output to its send, its level ramping over the block.
+           Each sender index is only used by one deck. Nothing is added if the
+           block has already been mixed*/
+        void addToSend(int sender,
+                       juce::uint32 block,
+                       const juce::AudioBuffer<float>& buffer,
+                       int startSample,
+                       int numSamples,
+                       float startLevel,
+                       float endLevel);
+        /**Audio thread: reverbs what was sent this block and returns it, to be
+           mixed in with the decks, then moves on to the next block. Returns
+           nullptr while there is nothing to hear*/
+        juce::AudioBuffer<float>* processReturn(int numSamples);
+
+    private:
+        StereoReverb reverb;
+        ParameterStore<juce::Reverb::Parameters> parameters;
+        /**The audio thread's copy of the parameters*/
+        juce::Reverb::Parameters audioParameters;
+        juce::AudioBuffer<float> send;
+        std::array<juce::AudioBuffer<float>, maxSenders> senderSends;
+        /**Advanced by processReturn() once the block's sends are mixed*/
+        std::atomic<juce::uint32> blockNumber{ 1 };
+        /**The block each deck's send holds, set once it is written on
+           whichever thread rendered the deck*/
+        std::array<std::atomic<juce::uint32>, maxSenders> sentBlocks{};
+        /**Only silence has been sent and the tail has died away, so the reverb is skipped*/
+        bool idle{ true };
+        /**How long the send and the reverb have both been silent*/
+        int silentSamples{ 0 };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SendReverb)
+};
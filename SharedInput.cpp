@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    SharedInput.cpp
+    Created: 16 Jul 2023 4:12:31pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "SharedInput.h"
+
+//==============================================================================
+SharedInput::Reader::Reader(SharedInput& _owner) : owner(_owner)
+{
+}
+
+void SharedInput::Reader::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    owner.largestBlock = juce::jmax(owner.largestBlock, samplesPerBlockExpected);
+}
+
+void SharedInput::Reader::releaseResources()
+{
+}
+
+void SharedInput::Reader::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    owner.read(*this, bufferToFill);
+}
+
+void SharedInput::Reader::catchUp()
+{
+    position = owner.totalRead;
+}
+
+juce::int64 SharedInput::Reader::getSamplesBehind() const
+{
+    return owner.totalRead - position;
+}
+
+//==============================================================================
+SharedInput::SharedInput(juce::AudioSource* _source) : source(_source)
+{
+}
+
+void SharedInput::prepareToPlay(double sampleRate)
+{
+    source->prepareToPlay(largestBlock, sampleRate);
+    // room for a reader a few blocks behind the other
+    ring.setSize(2, juce::jmax(16384, 4 * largestBlock));
+    ring.clear();
+    totalRead = 0;
+}
+
+void SharedInput::releaseResources()
+{
+    source->releaseResources();
+    largestBlock = 0;
+}
+
+void SharedInput::read(Reader& reader, const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    auto& output = *bufferToFill.buffer;
+    int capacity = ring.getNumSamples();
+    if (capacity == 0)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+    int done = 0;
+    while (done < bufferToFill.numSamples)
+    {
+        int outputStart = bufferToFill.startSample + done;
+        int remaining = bufferToFill.numSamples - done;
+        int num;
+        if (reader.position < totalRead - capacity)
+        {
+            // the ring has moved on past this reader
+            num = int(juce::jmin(juce::int64(remaining), totalRead - capacity - reader.position));
+            output.clear(outputStart, num);
+        }
+        else if (reader.position < totalRead)
+        {
+            // already read for another reader
+            int ringStart = int(reader.position % capacity);
+            num = int(juce::jmin(juce::int64(juce::jmin(remaining, capacity - ringStart)), totalRead - reader.position));
+            for (int channel = 0; channel < output.getNumChannels(); ++channel)
+            {
+                output.copyFrom(channel, outputStart, ring, juce::jmin(channel, 1), ringStart, num);
+            }
+        }
+        else
+        {
+            // the furthest ahead reads the source straight into the ring, then takes its copy
+            int ringStart = int(totalRead % capacity);
+            num = juce::jmin(remaining, capacity - ringStart);
+            source->getNextAudioBlock(juce::AudioSourceChannelInfo(&ring, ringStart, num));
+            totalRead += num;
+            for (int channel = 0; channel < output.getNumChannels(); ++channel)
+            {
+                output.copyFrom(channel, outputStart, ring, juce::jmin(channel, 1), ringStart, num);
+            }
+        }
+        reader.position += num;
+        done += num;
+    }
+}
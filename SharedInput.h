@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+    SharedInput.h
+    Created: 16 Jul 2023 4:12:31pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Lets the deck's resampler and time stretcher read the same transport,
+    so while key lock fades from one to the other both can carry on.
+
+    Each reader has its own place in what has been read from the source so
+    far. Whichever is furthest ahead reads the source, and the other gets the
+    same audio from a ring buffer, or silence if it falls so far behind that
+    the ring has moved on.
+
+    The source is prepared once here, for the largest block any reader
+    asked for, rather than by each reader in turn.
+*/
+class SharedInput
+{
+    public:
+        class Reader : public juce::AudioSource
+        {
+            public:
+                Reader(SharedInput& _owner);
+
+                /**Only notes the block size, the owner prepares the source*/
+                void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+                void releaseResources() override;
+                void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+                /**Audio thread: carries on from the newest audio read, skipping
+                   anything read for the other readers since this one last read*/
+                void catchUp();
+                /**Audio thread: how much has been read from the source that
+                   this reader hasn't had yet*/
+                juce::int64 getSamplesBehind() const;
+
+            private:
+                friend class SharedInput;
+                SharedInput& owner;
+                juce::int64 position{ 0 };
+        };
+
+        SharedInput(juce::AudioSource* _source);
+
+        /**Prepares the source for the largest block the readers asked for,
+           after the readers have been prepared*/
+        void prepareToPlay(double sampleRate);
+        void releaseResources();
+
+    private:
+        void read(Reader& reader, const juce::AudioSourceChannelInfo& bufferToFill);
+
+        juce::AudioSource* source;
+        int largestBlock{ 0 };
+        juce::AudioBuffer<float> ring;
+        /**How much has been read from the source since it was prepared*/
+        juce::int64 totalRead{ 0 };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SharedInput)
+};
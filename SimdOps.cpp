@@ -0,0 +1,335 @@
+/*
+  ==============================================================================
+
+    SimdOps.cpp
+    Created: 21 May 2023 3:12:40pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "SimdOps.h"
+
+#if defined(__AVX__)
+ #define DJ_USE_AVX 1
+ #include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #define DJ_USE_SSE2 1
+ #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+ #define DJ_USE_NEON 1
+ #include <arm_neon.h>
+#endif
+
+void SimdOps::findMinMaxAndSumOfSquares(const float* samples,
+                                        int numSamples,
+                                        float& minimum,
+                                        float& maximum,
+                                        float& sumOfSquares)
+{
+    if (numSamples <= 0)
+    {
+        minimum = maximum = sumOfSquares = 0.0f;
+        return;
+    }
+
+    float lowest = samples[0];
+    float highest = samples[0];
+    float sum = 0.0f;
+    int i = 0;
+
+   #if DJ_USE_SSE2
+    if (numSamples >= 4)
+    {
+        __m128 lowestV = _mm_set1_ps(samples[0]);
+        __m128 highestV = lowestV;
+        __m128 sumV = _mm_setzero_ps();
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            __m128 v = _mm_loadu_ps(samples + i);
+            lowestV = _mm_min_ps(lowestV, v);
+            highestV = _mm_max_ps(highestV, v);
+            sumV = _mm_add_ps(sumV, _mm_mul_ps(v, v));
+        }
+        float lanes[3][4];
+        _mm_storeu_ps(lanes[0], lowestV);
+        _mm_storeu_ps(lanes[1], highestV);
+        _mm_storeu_ps(lanes[2], sumV);
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            lowest = juce::jmin(lowest, lanes[0][lane]);
+            highest = juce::jmax(highest, lanes[1][lane]);
+            sum += lanes[2][lane];
+        }
+    }
+   #elif DJ_USE_NEON
+    if (numSamples >= 4)
+    {
+        float32x4_t lowestV = vdupq_n_f32(samples[0]);
+        float32x4_t highestV = lowestV;
+        float32x4_t sumV = vdupq_n_f32(0.0f);
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            float32x4_t v = vld1q_f32(samples + i);
+            lowestV = vminq_f32(lowestV, v);
+            highestV = vmaxq_f32(highestV, v);
+            sumV = vmlaq_f32(sumV, v, v);
+        }
+        float lanes[3][4];
+        vst1q_f32(lanes[0], lowestV);
+        vst1q_f32(lanes[1], highestV);
+        vst1q_f32(lanes[2], sumV);
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            lowest = juce::jmin(lowest, lanes[0][lane]);
+            highest = juce::jmax(highest, lanes[1][lane]);
+            sum += lanes[2][lane];
+        }
+    }
+   #endif
+
+    // whatever is left over after the last full vector
+    for (; i < numSamples; ++i)
+    {
+        lowest = juce::jmin(lowest, samples[i]);
+        highest = juce::jmax(highest, samples[i]);
+        sum += samples[i] * samples[i];
+    }
+
+    minimum = lowest;
+    maximum = highest;
+    sumOfSquares = sum;
+}
+
+void SimdOps::dotProductStereo(const float* coefficients,
+                               const float* left,
+                               const float* right,
+                               int numSamples,
+                               float& leftSum,
+                               float& rightSum)
+{
+    float leftTotal = 0.0f;
+    float rightTotal = 0.0f;
+    int i = 0;
+
+   #if DJ_USE_SSE2
+    __m128 leftV = _mm_setzero_ps();
+    __m128 rightV = _mm_setzero_ps();
+   #if DJ_USE_AVX
+    if (numSamples >= 8)
+    {
+        __m256 leftWide = _mm256_setzero_ps();
+        __m256 rightWide = _mm256_setzero_ps();
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            __m256 c = _mm256_loadu_ps(coefficients + i);
+            leftWide = _mm256_add_ps(leftWide, _mm256_mul_ps(c, _mm256_loadu_ps(left + i)));
+            rightWide = _mm256_add_ps(rightWide, _mm256_mul_ps(c, _mm256_loadu_ps(right + i)));
+        }
+        leftV = _mm_add_ps(_mm256_castps256_ps128(leftWide), _mm256_extractf128_ps(leftWide, 1));
+        rightV = _mm_add_ps(_mm256_castps256_ps128(rightWide), _mm256_extractf128_ps(rightWide, 1));
+    }
+   #endif
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        __m128 c = _mm_loadu_ps(coefficients + i);
+        leftV = _mm_add_ps(leftV, _mm_mul_ps(c, _mm_loadu_ps(left + i)));
+        rightV = _mm_add_ps(rightV, _mm_mul_ps(c, _mm_loadu_ps(right + i)));
+    }
+    // adds the lanes of both sums together, left in lane 0 and right in lane 1
+    __m128 pairs = _mm_add_ps(_mm_unpacklo_ps(leftV, rightV), _mm_unpackhi_ps(leftV, rightV));
+    __m128 sums = _mm_add_ps(pairs, _mm_movehl_ps(pairs, pairs));
+    leftTotal = _mm_cvtss_f32(sums);
+    rightTotal = _mm_cvtss_f32(_mm_shuffle_ps(sums, sums, _MM_SHUFFLE(1, 1, 1, 1)));
+   #elif DJ_USE_NEON
+    if (numSamples >= 4)
+    {
+        float32x4_t leftV = vdupq_n_f32(0.0f);
+        float32x4_t rightV = vdupq_n_f32(0.0f);
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            float32x4_t c = vld1q_f32(coefficients + i);
+            leftV = vmlaq_f32(leftV, c, vld1q_f32(left + i));
+            rightV = vmlaq_f32(rightV, c, vld1q_f32(right + i));
+        }
+        float32x2_t leftHalf = vadd_f32(vget_low_f32(leftV), vget_high_f32(leftV));
+        float32x2_t rightHalf = vadd_f32(vget_low_f32(rightV), vget_high_f32(rightV));
+        float32x2_t both = vpadd_f32(leftHalf, rightHalf);
+        leftTotal = vget_lane_f32(both, 0);
+        rightTotal = vget_lane_f32(both, 1);
+    }
+   #endif
+
+    for (; i < numSamples; ++i)
+    {
+        leftTotal += coefficients[i] * left[i];
+        rightTotal += coefficients[i] * right[i];
+    }
+
+    leftSum = leftTotal;
+    rightSum = rightTotal;
+}
+
+float SimdOps::dotProduct(const float* a, const float* b, int numSamples)
+{
+    float total = 0.0f;
+    int i = 0;
+
+   #if DJ_USE_SSE2
+    __m128 sumV = _mm_setzero_ps();
+   #if DJ_USE_AVX
+    if (numSamples >= 8)
+    {
+        __m256 sumWide = _mm256_setzero_ps();
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            sumWide = _mm256_add_ps(sumWide, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        }
+        sumV = _mm_add_ps(_mm256_castps256_ps128(sumWide), _mm256_extractf128_ps(sumWide, 1));
+    }
+   #endif
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        sumV = _mm_add_ps(sumV, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    sumV = _mm_add_ps(sumV, _mm_movehl_ps(sumV, sumV));
+    total = _mm_cvtss_f32(_mm_add_ss(sumV, _mm_shuffle_ps(sumV, sumV, _MM_SHUFFLE(1, 1, 1, 1))));
+   #elif DJ_USE_NEON
+    if (numSamples >= 4)
+    {
+        float32x4_t sumV = vdupq_n_f32(0.0f);
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            sumV = vmlaq_f32(sumV, vld1q_f32(a + i), vld1q_f32(b + i));
+        }
+        float32x2_t halves = vadd_f32(vget_low_f32(sumV), vget_high_f32(sumV));
+        total = vget_lane_f32(vpadd_f32(halves, halves), 0);
+    }
+   #endif
+
+    for (; i < numSamples; ++i)
+    {
+        total += a[i] * b[i];
+    }
+    return total;
+}
+
+float SimdOps::sumOfIncreases(const float* current, const float* previous, int numSamples)
+{
+    float total = 0.0f;
+    int i = 0;
+
+   #if DJ_USE_SSE2
+    __m128 sumV = _mm_setzero_ps();
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        __m128 rise = _mm_sub_ps(_mm_loadu_ps(current + i), _mm_loadu_ps(previous + i));
+        sumV = _mm_add_ps(sumV, _mm_max_ps(rise, zero));
+    }
+    sumV = _mm_add_ps(sumV, _mm_movehl_ps(sumV, sumV));
+    total = _mm_cvtss_f32(_mm_add_ss(sumV, _mm_shuffle_ps(sumV, sumV, _MM_SHUFFLE(1, 1, 1, 1))));
+   #elif DJ_USE_NEON
+    if (numSamples >= 4)
+    {
+        float32x4_t sumV = vdupq_n_f32(0.0f);
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            float32x4_t rise = vsubq_f32(vld1q_f32(current + i), vld1q_f32(previous + i));
+            sumV = vaddq_f32(sumV, vmaxq_f32(rise, zero));
+        }
+        float32x2_t halves = vadd_f32(vget_low_f32(sumV), vget_high_f32(sumV));
+        total = vget_lane_f32(vpadd_f32(halves, halves), 0);
+    }
+   #endif
+
+    for (; i < numSamples; ++i)
+    {
+        total += juce::jmax(0.0f, current[i] - previous[i]);
+    }
+    return total;
+}
+
+void SimdOps::mixWithRamps(float* dest,
+                           const float* const* sources,
+                           const float* gainStart,
+                           const float* gainStep,
+                           const float* gainEnd,
+                           int numSources,
+                           int numSamples)
+{
+    jassert(numSources <= maxMixSources);
+    // a ramp is held at its end by clamping to the range it covers
+    float lowest[maxMixSources];
+    float highest[maxMixSources];
+    for (int source = 0; source < numSources; ++source)
+    {
+        lowest[source] = juce::jmin(gainStart[source], gainEnd[source]);
+        highest[source] = juce::jmax(gainStart[source], gainEnd[source]);
+    }
+    int i = 0;
+
+   #if DJ_USE_SSE2
+   #if DJ_USE_AVX
+    if (numSamples >= 8)
+    {
+        const __m256 offsets = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            __m256 index = _mm256_add_ps(_mm256_set1_ps(float(i)), offsets);
+            __m256 sum = _mm256_setzero_ps();
+            for (int source = 0; source < numSources; ++source)
+            {
+                __m256 gain = _mm256_add_ps(_mm256_set1_ps(gainStart[source]),
+                                            _mm256_mul_ps(_mm256_set1_ps(gainStep[source]), index));
+                gain = _mm256_min_ps(_mm256_max_ps(gain, _mm256_set1_ps(lowest[source])), _mm256_set1_ps(highest[source]));
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(sources[source] + i), gain));
+            }
+            _mm256_storeu_ps(dest + i, sum);
+        }
+    }
+   #endif
+    const __m128 offsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        __m128 index = _mm_add_ps(_mm_set1_ps(float(i)), offsets);
+        __m128 sum = _mm_setzero_ps();
+        for (int source = 0; source < numSources; ++source)
+        {
+            __m128 gain = _mm_add_ps(_mm_set1_ps(gainStart[source]), _mm_mul_ps(_mm_set1_ps(gainStep[source]), index));
+            gain = _mm_min_ps(_mm_max_ps(gain, _mm_set1_ps(lowest[source])), _mm_set1_ps(highest[source]));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(sources[source] + i), gain));
+        }
+        _mm_storeu_ps(dest + i, sum);
+    }
+   #elif DJ_USE_NEON
+    const float offsetValues[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    const float32x4_t offsets = vld1q_f32(offsetValues);
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        float32x4_t index = vaddq_f32(vdupq_n_f32(float(i)), offsets);
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        for (int source = 0; source < numSources; ++source)
+        {
+            float32x4_t gain = vmlaq_f32(vdupq_n_f32(gainStart[source]), vdupq_n_f32(gainStep[source]), index);
+            gain = vminq_f32(vmaxq_f32(gain, vdupq_n_f32(lowest[source])), vdupq_n_f32(highest[source]));
+            sum = vmlaq_f32(sum, vld1q_f32(sources[source] + i), gain);
+        }
+        vst1q_f32(dest + i, sum);
+    }
+   #endif
+
+    for (; i < numSamples; ++i)
+    {
+        float sum = 0.0f;
+        for (int source = 0; source < numSources; ++source)
+        {
+            float gain = juce::jlimit(lowest[source], highest[source], gainStart[source] + gainStep[source] * float(i));
+            sum += sources[source][i] * gain;
+        }
+        dest[i] = sum;
+    }
+}
@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    SimdOps.h
+    Created: 21 May 2023 3:12:40pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Vectorised kernels for the hot loops that juce::FloatVectorOperations
+    doesn't cover. Each one uses SSE2 or NEON where the compiler targets
+    them, AVX as well where it helps, and falls back to plain loops
+    everywhere else.
+*/
+namespace SimdOps
+{
+    /**Finds the smallest and largest sample and the sum of the squared samples.
+       All three are 0 if there are no samples*/
+    void findMinMaxAndSumOfSquares(const float* samples,
+                                   int numSamples,
+                                   float& minimum,
+                                   float& maximum,
+                                   float& sumOfSquares);
+
+    /**Multiplies the same coefficients with a left and a right run of samples
+       and sums each, so a stereo filter tap loads its coefficients once*/
+    void dotProductStereo(const float* coefficients,
+                          const float* left,
+                          const float* right,
+                          int numSamples,
+                          float& leftSum,
+                          float& rightSum);
+
+    /**Sums the products of two runs of samples*/
+    float dotProduct(const float* a, const float* b, int numSamples);
+
+    /**Sums how much each sample of a run rose above the same sample of another,
+       ignoring the ones that fell*/
+    float sumOfIncreases(const float* current, const float* previous, int numSamples);
+
+    static constexpr int maxMixSources = 16;
+
+    /**Overwrites dest with the sum of several sources, each scaled by a gain of
+       its own. A source's gain starts at gainStart, moves by gainStep every
+       sample and holds once it reaches gainEnd, so a ramp can finish partway
+       through the run*/
+    void mixWithRamps(float* dest,
+                      const float* const* sources,
+                      const float* gainStart,
+                      const float* gainStep,
+                      const float* gainEnd,
+                      int numSources,
+                      int numSamples);
+}
@@ -0,0 +1,402 @@
+/*
+  ==============================================================================
+
+    StereoReverb.cpp
+    Created: 16 Jul 2023 10:37:14am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "StereoReverb.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #define DJ_USE_SSE2 1
+ #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+ #define DJ_USE_NEON 1
+ #include <arm_neon.h>
+#endif
+
+namespace
+{
+    /**Samples worked on at a time, short enough for the scratch to sit on the stack*/
+    const int maxChunkSize = 64;
+    const int numLanes = 2 * StereoReverb::numCombs;
+
+    // the tunings juce::Reverb uses, in samples at 44.1kHz
+    const int combTunings[] = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 };
+    const int allPassTunings[] = { 556, 441, 341, 225 };
+    const int stereoSpread = 23;
+
+    /**Four combs' worth of samples*/
+   #if DJ_USE_SSE2
+    using Lanes = __m128;
+    inline Lanes load(const float* p)               { return _mm_load_ps(p); }
+    inline void store(float* p, Lanes v)            { _mm_store_ps(p, v); }
+    inline Lanes broadcast(float x)                 { return _mm_set1_ps(x); }
+    inline Lanes add(Lanes a, Lanes b)              { return _mm_add_ps(a, b); }
+    inline Lanes subtract(Lanes a, Lanes b)         { return _mm_sub_ps(a, b); }
+    inline Lanes multiply(Lanes a, Lanes b)         { return _mm_mul_ps(a, b); }
+    /**Sums the lanes of each, the left total first*/
+    inline void sumLanes(Lanes left, Lanes right, float& leftSum, float& rightSum)
+    {
+        __m128 pairs = _mm_add_ps(_mm_unpacklo_ps(left, right), _mm_unpackhi_ps(left, right));
+        __m128 sums = _mm_add_ps(pairs, _mm_movehl_ps(pairs, pairs));
+        leftSum = _mm_cvtss_f32(sums);
+        rightSum = _mm_cvtss_f32(_mm_shuffle_ps(sums, sums, _MM_SHUFFLE(1, 1, 1, 1)));
+    }
+   #elif DJ_USE_NEON
+    using Lanes = float32x4_t;
+    inline Lanes load(const float* p)               { return vld1q_f32(p); }
+    inline void store(float* p, Lanes v)            { vst1q_f32(p, v); }
+    inline Lanes broadcast(float x)                 { return vdupq_n_f32(x); }
+    inline Lanes add(Lanes a, Lanes b)              { return vaddq_f32(a, b); }
+    inline Lanes subtract(Lanes a, Lanes b)         { return vsubq_f32(a, b); }
+    inline Lanes multiply(Lanes a, Lanes b)         { return vmulq_f32(a, b); }
+    inline void sumLanes(Lanes left, Lanes right, float& leftSum, float& rightSum)
+    {
+        float32x2_t leftHalf = vadd_f32(vget_low_f32(left), vget_high_f32(left));
+        float32x2_t rightHalf = vadd_f32(vget_low_f32(right), vget_high_f32(right));
+        float32x2_t both = vpadd_f32(leftHalf, rightHalf);
+        leftSum = vget_lane_f32(both, 0);
+        rightSum = vget_lane_f32(both, 1);
+    }
+   #else
+    struct Lanes
+    {
+        float v[4];
+    };
+    inline Lanes load(const float* p)               { return { { p[0], p[1], p[2], p[3] } }; }
+    inline void store(float* p, Lanes a)            { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+    inline Lanes broadcast(float x)                 { return { { x, x, x, x } }; }
+    inline Lanes add(Lanes a, Lanes b)              { for (int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+    inline Lanes subtract(Lanes a, Lanes b)         { for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+    inline Lanes multiply(Lanes a, Lanes b)         { for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+    inline void sumLanes(Lanes left, Lanes right, float& leftSum, float& rightSum)
+    {
+        leftSum = (left.v[0] + left.v[1]) + (left.v[2] + left.v[3]);
+        rightSum = (right.v[0] + right.v[1]) + (right.v[2] + right.v[3]);
+    }
+   #endif
+
+    /**Flushes values too small to hear before they turn denormal, like JUCE_UNDENORMALISE*/
+    inline Lanes undenormalise(Lanes v)
+    {
+        const Lanes offset = broadcast(0.1f);
+        return subtract(add(v, offset), offset);
+    }
+}
+
+//==============================================================================
+void StereoReverb::Delay::setSize(int size)
+{
+    buffer.assign(size_t(juce::jmax(1, size)), 0.0f);
+    index = 0;
+}
+
+void StereoReverb::Delay::clear()
+{
+    std::fill(buffer.begin(), buffer.end(), 0.0f);
+}
+
+//==============================================================================
+StereoReverb::StereoReverb()
+{
+    setParameters(juce::Reverb::Parameters());
+    setSampleRate(44100.0);
+}
+
+const juce::Reverb::Parameters& StereoReverb::getParameters() const
+{
+    return parameters;
+}
+
+void StereoReverb::setParameters(const juce::Reverb::Parameters& newParameters)
+{
+    // the same scaling as juce::Reverb, so settings sound the same
+    const float wetScaleFactor = 3.0f;
+    const float dryScaleFactor = 2.0f;
+    const float wet = newParameters.wetLevel * wetScaleFactor;
+    dryGain.setTargetValue(newParameters.dryLevel * dryScaleFactor);
+    wetGain1.setTargetValue(0.5f * wet * (1.0f + newParameters.width));
+    wetGain2.setTargetValue(0.5f * wet * (1.0f - newParameters.width));
+    gain = newParameters.freezeMode >= 0.5f ? 0.0f : 0.015f;
+    parameters = newParameters;
+    updateDamping();
+}
+
+void StereoReverb::updateDamping()
+{
+    const float roomScaleFactor = 0.28f;
+    const float roomOffset = 0.7f;
+    const float dampScaleFactor = 0.4f;
+    if (parameters.freezeMode >= 0.5f)
+    {
+        damping.setTargetValue(0.0f);
+        feedback.setTargetValue(1.0f);
+    }
+    else
+    {
+        damping.setTargetValue(parameters.damping * dampScaleFactor);
+        feedback.setTargetValue(parameters.roomSize * roomScaleFactor + roomOffset);
+    }
+}
+
+void StereoReverb::setSampleRate(double sampleRate)
+{
+    jassert(sampleRate > 0);
+    const int intSampleRate = int(sampleRate);
+    chunkSize = maxChunkSize;
+    for (int i = 0; i < numCombs; ++i)
+    {
+        combs[size_t(i)].setSize((intSampleRate * combTunings[i]) / 44100);
+        combs[size_t(numCombs + i)].setSize((intSampleRate * (combTunings[i] + stereoSpread)) / 44100);
+        chunkSize = juce::jmin(chunkSize, int(combs[size_t(i)].buffer.size()));
+    }
+    for (int i = 0; i < numAllPasses; ++i)
+    {
+        allPasses[0][size_t(i)].setSize((intSampleRate * allPassTunings[i]) / 44100);
+        allPasses[1][size_t(i)].setSize((intSampleRate * (allPassTunings[i] + stereoSpread)) / 44100);
+        chunkSize = juce::jmin(chunkSize, int(allPasses[0][size_t(i)].buffer.size()));
+    }
+    combLast.fill(0.0f);
+
+    const double smoothTime = 0.01;
+    damping.reset(sampleRate, smoothTime);
+    feedback.reset(sampleRate, smoothTime);
+    dryGain.reset(sampleRate, smoothTime);
+    wetGain1.reset(sampleRate, smoothTime);
+    wetGain2.reset(sampleRate, smoothTime);
+}
+
+void StereoReverb::reset()
+{
+    for (auto& comb : combs)
+    {
+        comb.clear();
+    }
+    for (auto& channel : allPasses)
+    {
+        for (auto& allPass : channel)
+        {
+            allPass.clear();
+        }
+    }
+    combLast.fill(0.0f);
+}
+
+bool StereoReverb::isBypassed() const
+{
+    return bypassed;
+}
+
+int StereoReverb::getLongestDelay() const
+{
+    int longestComb = 0;
+    for (const auto& comb : combs)
+    {
+        longestComb = juce::jmax(longestComb, int(comb.buffer.size()));
+    }
+    int longestAllPasses = 0;
+    for (const auto& channel : allPasses)
+    {
+        int allPassDelay = 0;
+        for (const auto& allPass : channel)
+        {
+            allPassDelay += int(allPass.buffer.size());
+        }
+        longestAllPasses = juce::jmax(longestAllPasses, allPassDelay);
+    }
+    return longestComb + longestAllPasses;
+}
+
+bool StereoReverb::shouldBypass() const
+{
+    // only once the wet gain has finished fading the tail out
+    return wetGain1.getTargetValue() == 0.0f && wetGain2.getTargetValue() == 0.0f
+           && !wetGain1.isSmoothing() && !wetGain2.isSmoothing();
+}
+
+void StereoReverb::processChunk(const float* input, float* leftOut, float* rightOut, int numSamples)
+{
+    alignas(16) float delayed[maxChunkSize][numLanes];
+    alignas(16) float written[maxChunkSize][numLanes];
+
+    // every delay is longer than the chunk, so all its reads come before its writes
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        auto& comb = combs[size_t(lane)];
+        const float* buffer = comb.buffer.data();
+        int size = int(comb.buffer.size());
+        int index = comb.index;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            delayed[i][lane] = buffer[index];
+            index = index + 1 == size ? 0 : index + 1;
+        }
+    }
+
+    Lanes last[4] = { load(combLast.data()), load(combLast.data() + 4),
+                      load(combLast.data() + 8), load(combLast.data() + 12) };
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float damp = damping.getNextValue();
+        Lanes keep = broadcast(damp);
+        Lanes pass = broadcast(1.0f - damp);
+        Lanes feedbackLevel = broadcast(feedback.getNextValue());
+        Lanes in = broadcast(input[i]);
+        Lanes out[4];
+        for (int v = 0; v < 4; ++v)
+        {
+            out[v] = load(delayed[i] + 4 * v);
+            last[v] = undenormalise(add(multiply(out[v], pass), multiply(last[v], keep)));
+            store(written[i] + 4 * v, undenormalise(add(in, multiply(last[v], feedbackLevel))));
+        }
+        sumLanes(add(out[0], out[1]), add(out[2], out[3]), leftOut[i], rightOut[i]);
+    }
+    for (int v = 0; v < 4; ++v)
+    {
+        store(combLast.data() + 4 * v, last[v]);
+    }
+
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        auto& comb = combs[size_t(lane)];
+        float* buffer = comb.buffer.data();
+        int size = int(comb.buffer.size());
+        int index = comb.index;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            buffer[index] = written[i][lane];
+            index = index + 1 == size ? 0 : index + 1;
+        }
+        comb.index = index;
+    }
+}
+
+void StereoReverb::processAllPasses(std::array<Delay, numAllPasses>& channelAllPasses, float* samples, int numSamples)
+{
+    for (auto& allPass : channelAllPasses)
+    {
+        int size = int(allPass.buffer.size());
+        int done = 0;
+        // no sample depends on another in the chunk, so these loops vectorise
+        while (done < numSamples)
+        {
+            int count = juce::jmin(numSamples - done, size - allPass.index);
+            float* buffer = allPass.buffer.data() + allPass.index;
+            float* x = samples + done;
+            for (int i = 0; i < count; ++i)
+            {
+                float buffered = buffer[i];
+                float temp = x[i] + buffered * 0.5f;
+                temp += 0.1f;
+                temp -= 0.1f;
+                buffer[i] = temp;
+                x[i] = buffered - x[i];
+            }
+            done += count;
+            allPass.index = (allPass.index + count) % size;
+        }
+    }
+}
+
+void StereoReverb::processStereo(float* left, float* right, int numSamples)
+{
+    if (shouldBypass())
+    {
+        if (!bypassed)
+        {
+            // the tail has faded out, so the tank starts again from silence
+            reset();
+            bypassed = true;
+        }
+        damping.skip(numSamples);
+        feedback.skip(numSamples);
+        if (dryGain.isSmoothing())
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                float dry = dryGain.getNextValue();
+                left[i] *= dry;
+                right[i] *= dry;
+            }
+        }
+        else if (dryGain.getTargetValue() != 1.0f)
+        {
+            juce::FloatVectorOperations::multiply(left, dryGain.getTargetValue(), numSamples);
+            juce::FloatVectorOperations::multiply(right, dryGain.getTargetValue(), numSamples);
+        }
+        return;
+    }
+    bypassed = false;
+
+    alignas(16) float input[maxChunkSize];
+    alignas(16) float leftWet[maxChunkSize];
+    alignas(16) float rightWet[maxChunkSize];
+    for (int start = 0; start < numSamples; start += chunkSize)
+    {
+        int count = juce::jmin(chunkSize, numSamples - start);
+        float* leftChunk = left + start;
+        float* rightChunk = right + start;
+        for (int i = 0; i < count; ++i)
+        {
+            input[i] = (leftChunk[i] + rightChunk[i]) * gain;
+        }
+        processChunk(input, leftWet, rightWet, count);
+        processAllPasses(allPasses[0], leftWet, count);
+        processAllPasses(allPasses[1], rightWet, count);
+
+        for (int i = 0; i < count; ++i)
+        {
+            float dry = dryGain.getNextValue();
+            float wet1 = wetGain1.getNextValue();
+            float wet2 = wetGain2.getNextValue();
+            leftChunk[i] = leftWet[i] * wet1 + rightWet[i] * wet2 + leftChunk[i] * dry;
+            rightChunk[i] = rightWet[i] * wet1 + leftWet[i] * wet2 + rightChunk[i] * dry;
+        }
+    }
+}
+
+void StereoReverb::processMono(float* samples, int numSamples)
+{
+    if (shouldBypass())
+    {
+        if (!bypassed)
+        {
+            reset();
+            bypassed = true;
+        }
+        damping.skip(numSamples);
+        feedback.skip(numSamples);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            samples[i] *= dryGain.getNextValue();
+        }
+        return;
+    }
+    bypassed = false;
+
+    // the right combs run as well but only the left tank is heard, as in juce::Reverb
+    alignas(16) float input[maxChunkSize];
+    alignas(16) float wet[maxChunkSize];
+    alignas(16) float unused[maxChunkSize];
+    for (int start = 0; start < numSamples; start += chunkSize)
+    {
+        int count = juce::jmin(chunkSize, numSamples - start);
+        float* chunk = samples + start;
+        for (int i = 0; i < count; ++i)
+        {
+            input[i] = chunk[i] * gain;
+        }
+        processChunk(input, wet, unused, count);
+        processAllPasses(allPasses[0], wet, count);
+        for (int i = 0; i < count; ++i)
+        {
+            float dry = dryGain.getNextValue();
+            chunk[i] = wet[i] * wetGain1.getNextValue() + chunk[i] * dry;
+        }
+        wetGain2.skip(count);
+    }
+}
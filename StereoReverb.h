@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    StereoReverb.h
+    Created: 16 Jul 2023 10:37:14am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+
+//==============================================================================
+/*
+    The same Freeverb tank as juce::Reverb, with the same parameters and
+    sound, laid out so the combs of both channels run side by side in
+    vector lanes.
+
+    The 16 combs are independent, so each sample of their damping filters
+    is worked out four combs at a time. Every comb and all-pass delay is
+    longer than the chunks the audio is cut into, so a chunk's delayed
+    samples are all read before any are written, and the all-passes run
+    along the chunk as plain vector loops.
+
+    With the wet level at zero the tank is skipped and only the dry gain is
+    applied. The wet gain's own ramp fades the tail out first, and the tank
+    is cleared so it builds up from silence when the wet level comes back.
+*/
+class StereoReverb
+{
+    public:
+        StereoReverb();
+
+        void setParameters(const juce::Reverb::Parameters& newParameters);
+        const juce::Reverb::Parameters& getParameters() const;
+        void setSampleRate(double sampleRate);
+        /**Clears the tank*/
+        void reset();
+        void processStereo(float* left, float* right, int numSamples);
+        void processMono(float* samples, int numSamples);
+        /**Whether the last block skipped the tank*/
+        bool isBypassed() const;
+        /**The longest way through the tank, a comb then every all-pass, in samples.
+           Sound can still be in the tank this long after the output goes quiet*/
+        int getLongestDelay() const;
+
+        static constexpr int numCombs = 8;
+        static constexpr int numAllPasses = 4;
+
+    private:
+        /**A delay line that is read and written a chunk at a time*/
+        struct Delay
+        {
+            std::vector<float> buffer;
+            int index{ 0 };
+
+            void setSize(int size);
+            void clear();
+        };
+
+        /**Runs the tank over a chunk no longer than the shortest delay*/
+        void processChunk(const float* input, float* leftOut, float* rightOut, int numSamples);
+        void processAllPasses(std::array<Delay, numAllPasses>& allPasses, float* samples, int numSamples);
+        bool shouldBypass() const;
+        void updateDamping();
+
+        juce::Reverb::Parameters parameters;
+        float gain{ 0.015f };
+
+        /**Left combs in lanes 0 to 7, right combs in 8 to 15*/
+        std::array<Delay, 2 * numCombs> combs;
+        alignas(16) std::array<float, 2 * numCombs> combLast{};
+        std::array<std::array<Delay, numAllPasses>, 2> allPasses;
+        /**Fits in every delay at this sample rate*/
+        int chunkSize{ 1 };
+        bool bypassed{ false };
+
+        juce::SmoothedValue<float> damping, feedback, dryGain, wetGain1, wetGain2;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StereoReverb)
+};
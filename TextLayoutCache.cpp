@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    TextLayoutCache.cpp
+    Created: 7 May 2023 4:26:08pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "TextLayoutCache.h"
+
+TextLayoutCache::TextLayoutCache(size_t _maxEntries) : maxEntries(_maxEntries)
+{
+}
+
+bool TextLayoutCache::draw(juce::Graphics& g, juce::uint64 key, juce::Rectangle<int> area)
+{
+    auto it = lookup.find(key);
+    if (it == lookup.end() || it->second->area != area)
+    {
+        return false;
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    it->second->glyphs.draw(g);
+    return true;
+}
+
+void TextLayoutCache::drawAndCache(juce::Graphics& g,
+                                   juce::uint64 key,
+                                   const juce::String& text,
+                                   const juce::Font& font,
+                                   juce::Rectangle<int> area,
+                                   juce::Justification justification)
+{
+    auto existing = lookup.find(key);
+    if (existing != lookup.end())
+    {
+        entries.erase(existing->second);
+        lookup.erase(existing);
+    }
+
+    // the same steps Graphics::drawText takes, with ellipses if it's too long
+    juce::GlyphArrangement glyphs;
+    glyphs.addCurtailedLineOfText(font, text, 0.0f, 0.0f, float(area.getWidth()), true);
+    glyphs.justifyGlyphs(0, glyphs.getNumGlyphs(),
+                         float(area.getX()), float(area.getY()),
+                         float(area.getWidth()), float(area.getHeight()),
+                         justification);
+    glyphs.draw(g);
+
+    entries.push_front({ key, area, std::move(glyphs) });
+    lookup[key] = entries.begin();
+    if (entries.size() > maxEntries)
+    {
+        lookup.erase(entries.back().key);
+        entries.pop_back();
+    }
+}
+
+void TextLayoutCache::clear()
+{
+    entries.clear();
+    lookup.clear();
+}
@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    TextLayoutCache.h
+    Created: 7 May 2023 4:26:08pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <list>
+#include <unordered_map>
+
+//==============================================================================
+/*
+    Keeps the glyph layouts of recently drawn pieces of text, so redrawing
+    a table cell while scrolling doesn't lay its text out again. Holds at
+    most a fixed number of layouts and forgets the least recently drawn.
+*/
+class TextLayoutCache
+{
+    public:
+        TextLayoutCache(size_t _maxEntries = 1024);
+
+        /**Draws the layout cached under key, returns false if there isn't one
+           for an area of this size*/
+        bool draw(juce::Graphics& g, juce::uint64 key, juce::Rectangle<int> area);
+        /**Lays the text out like Graphics::drawText, draws it and caches it under key*/
+        void drawAndCache(juce::Graphics& g,
+                          juce::uint64 key,
+                          const juce::String& text,
+                          const juce::Font& font,
+                          juce::Rectangle<int> area,
+                          juce::Justification justification);
+        void clear();
+
+    private:
+        struct Entry
+        {
+            juce::uint64 key;
+            juce::Rectangle<int> area;
+            juce::GlyphArrangement glyphs;
+        };
+
+        size_t maxEntries;
+        /**Most recently drawn first*/
+        std::list<Entry> entries;
+        std::unordered_map<juce::uint64, std::list<Entry>::iterator> lookup;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TextLayoutCache)
+};
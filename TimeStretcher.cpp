@@ -0,0 +1,271 @@
+/*
+  ==============================================================================
+
+    TimeStretcher.cpp
+    Created: 9 Jul 2023 3:05:52pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "TimeStretcher.h"
+#include "SimdOps.h"
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    const int maxFrameSize = 2048;
+    const int maxSearchRadius = 512;
+    /**Covers a frame's search and overlap at four times speed*/
+    const int historySize = 4 * maxFrameSize + 4 * maxSearchRadius;
+}
+
+TimeStretcher::TimeStretcher(juce::AudioSource* _input) : input(_input), settings(getSettings(quality))
+{
+    // periodic Hann windows, which add up to exactly one overlapped by half
+    for (int q = 0; q < int(windows.size()); ++q)
+    {
+        int frameSize = getSettings(Quality(q)).frameSize;
+        auto& window = windows[size_t(q)];
+        window.resize(size_t(frameSize));
+        for (int i = 0; i < frameSize; ++i)
+        {
+            window[size_t(i)] = float(0.5 - 0.5 * std::cos(2.0 * juce::MathConstants<double>::pi * i / frameSize));
+        }
+    }
+    history.setSize(2, historySize);
+    mono.resize(size_t(historySize));
+    energySums.resize(size_t(2 * maxSearchRadius + maxFrameSize / 2 + 1));
+    overlap.setSize(2, maxFrameSize);
+    flushBuffers();
+}
+
+TimeStretcher::~TimeStretcher()
+{
+}
+
+TimeStretcher::Settings TimeStretcher::getSettings(Quality quality)
+{
+    switch (quality)
+    {
+        case Quality::lowLatency:   return { 512, 128, 2 };
+        case Quality::high:         return { 2048, 512, 8 };
+        case Quality::normal:
+        default:                    return { 1024, 256, 4 };
+    }
+}
+
+void TimeStretcher::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    input->prepareToPlay(maxFrameSize * 2, sampleRate);
+    ensureCapacity(samplesPerBlockExpected);
+    flushBuffers();
+}
+
+int TimeStretcher::getFrameSize() const
+{
+    return settings.frameSize;
+}
+
+double TimeStretcher::getBufferedInput() const
+{
+    // the ready output ends half a frame into the last frame overlapped, which
+    // started half a frame of input before the next one will
+    int hop = settings.frameSize / 2;
+    double played = analysisPosition + hop * (1.0 - ratio) - numReady * ratio;
+    return numBuffered - played;
+}
+
+void TimeStretcher::releaseResources()
+{
+    input->releaseResources();
+}
+
+void TimeStretcher::setTempoRatio(double newRatio)
+{
+    ratio = juce::jlimit(minRatio, maxRatio, newRatio);
+}
+
+void TimeStretcher::setQuality(Quality newQuality)
+{
+    requestedQuality = int(newQuality);
+}
+
+void TimeStretcher::flushBuffers()
+{
+    history.clear();
+    overlap.clear();
+    ready.clear();
+    numBuffered = 0;
+    analysisPosition = 0.0;
+    continuation = -1;
+    numReady = 0;
+}
+
+void TimeStretcher::ensureCapacity(int numSamples)
+{
+    int needed = numSamples + maxFrameSize / 2;
+    if (ready.getNumChannels() != 2 || ready.getNumSamples() < needed)
+    {
+        ready.setSize(2, needed, true, true, true);
+    }
+}
+
+void TimeStretcher::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    int numSamples = bufferToFill.numSamples;
+    if (numSamples <= 0)
+    {
+        return;
+    }
+    auto newQuality = Quality(requestedQuality.load());
+    if (newQuality != quality)
+    {
+        quality = newQuality;
+        settings = getSettings(quality);
+        flushBuffers();
+    }
+    ensureCapacity(numSamples);
+
+    while (numReady < numSamples)
+    {
+        synthesizeFrame();
+    }
+
+    auto& output = *bufferToFill.buffer;
+    for (int channel = 0; channel < output.getNumChannels(); ++channel)
+    {
+        if (channel < 2)
+        {
+            output.copyFrom(channel, bufferToFill.startSample, ready, channel, 0, numSamples);
+        }
+        else
+        {
+            output.clear(channel, bufferToFill.startSample, numSamples);
+        }
+    }
+    numReady -= numSamples;
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        float* samples = ready.getWritePointer(channel);
+        std::memmove(samples, samples + numSamples, size_t(numReady) * sizeof(float));
+    }
+}
+
+void TimeStretcher::readInput(int numSamples)
+{
+    jassert(numSamples <= historySize);
+    numSamples = juce::jmin(numSamples, historySize);
+    if (numSamples <= numBuffered)
+    {
+        return;
+    }
+    juce::AudioSourceChannelInfo inputInfo(&history, numBuffered, numSamples - numBuffered);
+    input->getNextAudioBlock(inputInfo);
+    const float* left = history.getReadPointer(0);
+    const float* right = history.getReadPointer(1);
+    for (int i = numBuffered; i < numSamples; ++i)
+    {
+        mono[size_t(i)] = 0.5f * (left[i] + right[i]);
+    }
+    numBuffered = numSamples;
+}
+
+int TimeStretcher::findBestFrame(int target)
+{
+    int overlapSize = settings.frameSize / 2;
+    int first = juce::jmax(0, target - settings.searchRadius);
+    int last = target + settings.searchRadius;
+
+    // running energy, so each candidate's normalisation is a subtraction
+    energySums[0] = 0.0;
+    for (int i = 0; i < last - first + overlapSize; ++i)
+    {
+        double sample = mono[size_t(first + i)];
+        energySums[size_t(i + 1)] = energySums[size_t(i)] + sample * sample;
+    }
+
+    const float* reference = mono.data() + continuation;
+    auto similarity = [&](int candidate)
+    {
+        float correlation = SimdOps::dotProduct(reference, mono.data() + candidate, overlapSize);
+        double energy = energySums[size_t(candidate - first + overlapSize)] - energySums[size_t(candidate - first)];
+        return correlation / std::sqrt(energy + 1.0e-9);
+    };
+
+    int best = target;
+    double bestSimilarity = -1.0e30;
+    for (int candidate = first; candidate <= last; candidate += settings.searchStep)
+    {
+        double candidateSimilarity = similarity(candidate);
+        if (candidateSimilarity > bestSimilarity)
+        {
+            bestSimilarity = candidateSimilarity;
+            best = candidate;
+        }
+    }
+    // then every offset either side of the coarse match
+    int coarseBest = best;
+    for (int candidate = juce::jmax(first, coarseBest - settings.searchStep + 1);
+         candidate <= juce::jmin(last, coarseBest + settings.searchStep - 1); ++candidate)
+    {
+        double candidateSimilarity = similarity(candidate);
+        if (candidateSimilarity > bestSimilarity)
+        {
+            bestSimilarity = candidateSimilarity;
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+void TimeStretcher::synthesizeFrame()
+{
+    int frameSize = settings.frameSize;
+    int hop = frameSize / 2;
+    int target = int(analysisPosition);
+
+    int frameStart = target;
+    if (continuation < 0)
+    {
+        readInput(target + frameSize);
+    }
+    else
+    {
+        readInput(juce::jmax(target + settings.searchRadius + frameSize, continuation + hop));
+        frameStart = findBestFrame(target);
+    }
+
+    const float* window = windows[size_t(quality)].data();
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        float* overlapped = overlap.getWritePointer(channel);
+        juce::FloatVectorOperations::addWithMultiply(overlapped, window, history.getReadPointer(channel, frameStart), frameSize);
+
+        // the first half has had both its frames added, so it's finished
+        juce::FloatVectorOperations::copy(ready.getWritePointer(channel, numReady), overlapped, hop);
+        std::memmove(overlapped, overlapped + hop, size_t(frameSize - hop) * sizeof(float));
+        juce::FloatVectorOperations::clear(overlapped + frameSize - hop, hop);
+    }
+    numReady += hop;
+    // the input that would follow this frame had nothing moved
+    continuation = frameStart + hop;
+    analysisPosition += hop * ratio;
+
+    // drop the input neither the next search nor the next continuation reaches
+    int keepFrom = juce::jmin(continuation, int(analysisPosition) - settings.searchRadius);
+    if (keepFrom > 0)
+    {
+        int kept = numBuffered - keepFrom;
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            float* samples = history.getWritePointer(channel);
+            std::memmove(samples, samples + keepFrom, size_t(kept) * sizeof(float));
+        }
+        std::memmove(mono.data(), mono.data() + keepFrom, size_t(kept) * sizeof(float));
+        numBuffered = kept;
+        continuation -= keepFrom;
+        analysisPosition -= keepFrom;
+    }
+}
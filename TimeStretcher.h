@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    TimeStretcher.h
+    Created: 9 Jul 2023 3:05:52pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <vector>
+
+//==============================================================================
+/*
+    Changes the tempo of another source without changing its pitch, for the
+    deck's key lock, using WSOLA (waveform similarity overlap-add).
+
+    Output is built from Hann-windowed frames of the input overlapped by
+    half. Each frame is taken from near where the tempo says it should be,
+    shifted to wherever the input best lines up with the end of the frame
+    before, so the overlap adds up without phasing. The search is coarse
+    then fine over a mono mix, with both channels cut at the same place.
+
+    A frame's work is fixed by the quality, so the cost of a block only
+    depends on how many frames it needs, at most one more than the block
+    size over half a frame. Longer frames sound smoother on sustained notes
+    but smear drums and react to tempo changes later.
+*/
+class TimeStretcher : public juce::AudioSource
+{
+    public:
+        enum class Quality
+        {
+            lowLatency,
+            normal,
+            high
+        };
+
+        TimeStretcher(juce::AudioSource* _input);
+        ~TimeStretcher() override;
+
+        void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+        void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+        void releaseResources() override;
+
+        /**Audio thread: sets how many input samples go into each output sample*/
+        void setTempoRatio(double ratio);
+        /**Any thread: changes frame size, starting again from the next block*/
+        void setQuality(Quality quality);
+        /**Audio thread: forgets the input and output held so far*/
+        void flushBuffers();
+        /**Audio thread: the length of the frames being overlapped*/
+        int getFrameSize() const;
+        /**Audio thread: roughly how much input has been read but not played
+           yet, in input samples*/
+        double getBufferedInput() const;
+
+        static constexpr double minRatio = 0.25;
+        static constexpr double maxRatio = 4.0;
+
+    private:
+        struct Settings
+        {
+            int frameSize;
+            /**How far either side of the expected place a frame can be taken from*/
+            int searchRadius;
+            /**Spacing of the first, coarse search*/
+            int searchStep;
+        };
+
+        static Settings getSettings(Quality quality);
+        /**Overlap-adds one more frame, adding half a frame to the ready output*/
+        void synthesizeFrame();
+        /**Reads the input until history holds numSamples*/
+        void readInput(int numSamples);
+        /**Finds where a frame near target best carries on from the previous frame*/
+        int findBestFrame(int target);
+        void ensureCapacity(int numSamples);
+
+        juce::AudioSource* input;
+        std::atomic<int> requestedQuality{ int(Quality::normal) };
+        Quality quality{ Quality::normal };
+        Settings settings;
+        std::array<std::vector<float>, 3> windows;
+        double ratio{ 1.0 };
+
+        /**Input already read, with its mono mix for the search*/
+        juce::AudioBuffer<float> history;
+        std::vector<float> mono;
+        std::vector<double> energySums;
+        int numBuffered{ 0 };
+        /**Where the next frame should come from in history, if nothing moved it*/
+        double analysisPosition{ 0.0 };
+        /**Where the input that followed on from the last frame is, or -1 before the first*/
+        int continuation{ -1 };
+
+        /**The frame being overlapped, and output that is finished*/
+        juce::AudioBuffer<float> overlap;
+        juce::AudioBuffer<float> ready;
+        int numReady{ 0 };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TimeStretcher)
+};
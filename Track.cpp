@@ -12,13 +12,12 @@
 #include <filesystem>
 
 Track::Track(juce::File _file) : file(_file),
-                                 title(_file.getFileNameWithoutExtension()),
-                                 URL(juce::URL{ _file })
+                                 title(_file.getFileNameWithoutExtension())
 {
-    DBG("Created new track with title: " << title);
+    identity.path = _file.getFullPathName();
 }
 
-bool Track::operator==(const juce::String& other) const
+bool Track::operator==(const Track& other) const
 {
-    return title == other;
+    return identity.path == other.identity.path;
 }
@@ -10,15 +10,31 @@
 
 #pragma once
 #include <JuceHeader.h>
+#include "FileIdentity.h"
 
 class Track
 {
     public:
         Track(juce::File _file);
+        /**stays the same for the life of the library, unlike the track's row*/
+        juce::uint32 id{ 0 };
         juce::File file;
-        juce::URL URL;
         juce::String title;
-        juce::String length;
-        /**objects are compared by title*/
-        bool operator==(const juce::String& other) const;
+        double lengthInSeconds{ 0.0 };
+        juce::String artist;
+        double bpm{ 0.0 };
+        /**Seconds into the file of a downbeat, which with the bpm places the beat grid*/
+        double firstDownbeat{ 0.0 };
+        /**The audio has been analysed for its beats, whether or not it found any*/
+        bool beatsAnalysed{ false };
+        /**The analysis found a steady beat, so firstDownbeat places a real grid.
+           Without one the tagged bpm is kept, but there is no phase to sync to*/
+        bool beatGridFound{ false };
+        /**The musical key, 0 to 11 for C to B major and 12 to 23 for C to B minor,
+           or -1 if it isn't known*/
+        int key{ -1 };
+        bool keyAnalysed{ false };
+        FileIdentity identity;
+        /**objects are compared by file, tracks can share a title*/
+        bool operator==(const Track& other) const;
 };
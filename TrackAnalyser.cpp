@@ -0,0 +1,277 @@
+/*
+  ==============================================================================
+
+    TrackAnalyser.cpp
+    Created: 13 Aug 2023 10:26:41am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "TrackAnalyser.h"
+#include "SimdOps.h"
+
+//==============================================================================
+/*
+    Decodes and analyses a single track.
+*/
+class TrackAnalyser::AnalysisJob : public juce::ThreadPoolJob
+{
+    public:
+        AnalysisJob(TrackAnalyser& _owner, juce::uint32 _trackId, juce::File _file, int _generation)
+            : juce::ThreadPoolJob("Track analysis"),
+              owner(_owner),
+              trackId(_trackId),
+              file(_file),
+              generation(_generation)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            auto isStale = [this] { return shouldExit() || generation != owner.generation; };
+            if (isStale())
+            {
+                return jobHasFinished;
+            }
+
+            Result result;
+            result.trackId = trackId;
+            result.file = file;
+            std::vector<float> samples;
+            double sampleRate = 0.0;
+            auto restIfThrottled = [this, &isStale]
+            {
+                if (owner.throttled.load(std::memory_order_relaxed))
+                {
+                    juce::Thread::sleep(throttledPauseMillis);
+                }
+                return isStale();
+            };
+            // a track already on a deck or waveform is mixed down from memory,
+            // but one that isn't is decoded here without going into the cache
+            result.decoded = decodeForAnalysis(owner.formatManager, file, samples, sampleRate, restIfThrottled,
+                                               owner.decodedAudio->find(file));
+            if (isStale())
+            {
+                return jobHasFinished;
+            }
+            if (result.decoded)
+            {
+                BeatAnalyser beatAnalyser;
+                result.beats = beatAnalyser.analyse(samples.data(), int(samples.size()), sampleRate);
+                KeyAnalyser keyAnalyser;
+                result.key = keyAnalyser.analyse(samples.data(), int(samples.size()), sampleRate);
+            }
+            owner.addResult(std::move(result), generation);
+            return jobHasFinished;
+        }
+
+    private:
+        TrackAnalyser& owner;
+        juce::uint32 trackId;
+        juce::File file;
+        int generation;
+};
+
+//==============================================================================
+TrackAnalyser::TrackAnalyser(juce::AudioFormatManager& _formatManager
+                            ) : formatManager(_formatManager)
+{
+}
+
+TrackAnalyser::~TrackAnalyser()
+{
+    stopTimer();
+    ++generation;
+    pool.removeAllJobs(true, 5000);
+}
+
+TrackAnalyser::Listener::Listener() {}
+TrackAnalyser::Listener::~Listener() {}
+
+void TrackAnalyser::addListener(Listener* l)
+{
+    listeners.add(l);
+}
+
+void TrackAnalyser::removeListener(Listener* l)
+{
+    listeners.remove(l);
+}
+
+void TrackAnalyser::analyse(juce::uint32 trackId, const juce::File& file)
+{
+    if (!isTimerRunning())
+    {
+        throttled = throttleCheck != nullptr && throttleCheck();
+    }
+    ++numWaiting;
+    pool.addJob(new AnalysisJob(*this, trackId, file, generation), true);
+    if (!isTimerRunning())
+    {
+        startTimer(250);
+    }
+}
+
+void TrackAnalyser::cancel()
+{
+    DBG("TrackAnalyser::cancel dropping " << numWaiting << " track(s)");
+    ++generation;
+    pool.removeAllJobs(true, 2000);
+    const juce::ScopedLock sl(lock);
+    pending.clear();
+    numWaiting = 0;
+}
+
+int TrackAnalyser::getNumWaiting() const
+{
+    return numWaiting;
+}
+
+void TrackAnalyser::setThrottleCheck(std::function<bool()> shouldThrottle)
+{
+    throttleCheck = std::move(shouldThrottle);
+}
+
+bool TrackAnalyser::decodeForAnalysis(juce::AudioFormatManager& formatManager,
+                                      const juce::File& file,
+                                      std::vector<float>& samples,
+                                      double& sampleRate,
+                                      const std::function<bool()>& shouldStop,
+                                      DecodedAudioCache::AudioPtr cached)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader;
+    double sourceRate;
+    juce::int64 length;
+    int numChannels;
+    if (cached != nullptr)
+    {
+        sourceRate = cached->sampleRate;
+        length = cached->samples.getNumSamples();
+        numChannels = cached->samples.getNumChannels();
+    }
+    else
+    {
+        reader.reset(formatManager.createReaderFor(file));
+        if (reader == nullptr)
+        {
+            return false;
+        }
+        sourceRate = reader->sampleRate;
+        length = reader->lengthInSamples;
+        numChannels = int(reader->numChannels);
+    }
+    if (sourceRate <= 0.0 || length <= 0 || numChannels <= 0)
+    {
+        return false;
+    }
+
+    // whole samples are dropped, so the rate ends up between 11 and 22kHz
+    int factor = juce::jmax(1, int(sourceRate / analysisRate));
+    sampleRate = sourceRate / factor;
+
+    // a Kaiser windowed sinc, cutting off a little under the new Nyquist
+    int numTaps = 16 * factor;
+    std::vector<float> taps(size_t(numTaps));
+    double cutoff = 0.45 / factor;
+    double beta = 8.0;
+    auto besselI0 = [](double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    };
+    double tapSum = 0.0;
+    for (int i = 0; i < numTaps; ++i)
+    {
+        double t = i - (numTaps - 1) / 2.0;
+        double sinc = t == 0.0 ? 2.0 * cutoff : std::sin(2.0 * juce::MathConstants<double>::pi * cutoff * t) / (juce::MathConstants<double>::pi * t);
+        double position = 2.0 * i / (numTaps - 1) - 1.0;
+        taps[size_t(i)] = float(sinc * besselI0(beta * std::sqrt(1.0 - position * position)) / besselI0(beta));
+        tapSum += taps[size_t(i)];
+    }
+    for (auto& tap : taps)
+    {
+        tap = float(tap / tapSum);
+    }
+
+    const int blockSize = 65536;
+    // only used when reading the file, cached audio is read where it is
+    juce::AudioBuffer<float> block{ reader != nullptr ? numChannels : 0, reader != nullptr ? blockSize : 0 };
+    // mono input still waiting to be filtered, starting with the last block's tail
+    std::vector<float> mono(size_t(numTaps - 1), 0.0f);
+    samples.clear();
+    samples.reserve(size_t(length / factor + 1));
+    for (juce::int64 position = 0; position < length; position += blockSize)
+    {
+        if (shouldStop())
+        {
+            return false;
+        }
+        int numSamples = int(juce::jmin(juce::int64(blockSize), length - position));
+        auto readChannel = [&](int channel)
+        {
+            return reader != nullptr ? block.getReadPointer(channel)
+                                     : cached->samples.getReadPointer(channel, int(position));
+        };
+        if (reader != nullptr && !reader->read(&block, 0, numSamples, position, true, true))
+        {
+            return false;
+        }
+
+        size_t start = mono.size();
+        mono.resize(start + size_t(numSamples));
+        juce::FloatVectorOperations::copy(mono.data() + start, readChannel(0), numSamples);
+        for (int channel = 1; channel < numChannels; ++channel)
+        {
+            juce::FloatVectorOperations::add(mono.data() + start, readChannel(channel), numSamples);
+        }
+        juce::FloatVectorOperations::multiply(mono.data() + start, 1.0f / float(numChannels), numSamples);
+
+        // only the samples that are kept are filtered
+        size_t used = 0;
+        while (used + size_t(numTaps) <= mono.size())
+        {
+            samples.push_back(SimdOps::dotProduct(taps.data(), mono.data() + used, numTaps));
+            used += size_t(factor);
+        }
+        mono.erase(mono.begin(), mono.begin() + std::ptrdiff_t(used));
+    }
+    return true;
+}
+
+void TrackAnalyser::addResult(Result result, int jobGeneration)
+{
+    const juce::ScopedLock sl(lock);
+    if (jobGeneration == generation)
+    {
+        pending.push_back(std::move(result));
+        --numWaiting;
+    }
+}
+
+void TrackAnalyser::timerCallback()
+{
+    throttled = throttleCheck != nullptr && throttleCheck();
+    std::vector<Result> batch;
+    bool allAnalysed;
+    {
+        const juce::ScopedLock sl(lock);
+        batch.swap(pending);
+        allAnalysed = numWaiting == 0;
+    }
+
+    if (!batch.empty())
+    {
+        listeners.call([&batch](Listener& l) { l.tracksAnalysed(batch); });
+    }
+    if (allAnalysed)
+    {
+        stopTimer();
+    }
+}
@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    TrackAnalyser.h
+    Created: 13 Aug 2023 10:26:41am
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "BeatAnalyser.h"
+#include "DecodedAudioCache.h"
+#include "KeyAnalyser.h"
+
+//==============================================================================
+/*
+    Analyses library tracks on a pool of worker threads once they have been
+    imported, well away from the audio thread. The pool is a quarter of the
+    cores at background priority, and while a deck is playing each track is
+    decoded with a pause between blocks, so the decks and the GUI come first.
+
+    Each track is decoded a block at a time, mixed to mono and filtered down
+    to around 11kHz, which is all the analysis needs and a quarter of the
+    memory, then handed to each analyser in turn, so a track is decoded
+    once however much is found out about it. Results are collected and
+    handed to the listeners in batches on the message thread, like the
+    importer's.
+*/
+class TrackAnalyser : private juce::Timer
+{
+    public:
+        TrackAnalyser(juce::AudioFormatManager& _formatManager);
+        ~TrackAnalyser() override;
+
+        /**What was found out about one track*/
+        struct Result
+        {
+            juce::uint32 trackId{ 0 };
+            juce::File file;
+            /**false if the file couldn't be decoded*/
+            bool decoded{ false };
+            BeatAnalyser::Result beats;
+            KeyAnalyser::Result key;
+        };
+
+        class Listener
+        {
+            public:
+                Listener();
+                virtual ~Listener();
+
+                /**Called on the message thread with the next batch of analysed tracks*/
+                virtual void tracksAnalysed(const std::vector<Result>& batch) = 0;
+        };
+        void addListener(Listener* l);
+        void removeListener(Listener* l);
+
+        /**Queues a library track for analysis*/
+        void analyse(juce::uint32 trackId, const juce::File& file);
+        /**Drops every track that hasn't been analysed yet*/
+        void cancel();
+        /**Gets the number of tracks queued and not yet analysed*/
+        int getNumWaiting() const;
+        /**Message thread: checked while tracks are waiting. While it returns true,
+           like while a deck is playing, analysis goes slower*/
+        void setThrottleCheck(std::function<bool()> shouldThrottle);
+
+        /**Decodes a file to mono at the analysis rate, or mixes down the cached
+           audio instead when it is given. Returns false if it couldn't be read.
+           Any thread*/
+        static bool decodeForAnalysis(juce::AudioFormatManager& formatManager,
+                                      const juce::File& file,
+                                      std::vector<float>& samples,
+                                      double& sampleRate,
+                                      const std::function<bool()>& shouldStop,
+                                      DecodedAudioCache::AudioPtr cached = nullptr);
+
+        /**Roughly the rate analysis runs at, the most the onsets need*/
+        static constexpr double analysisRate = 11025.0;
+
+    private:
+        class AnalysisJob;
+
+        void timerCallback() override;
+        void addResult(Result result, int generation);
+
+        juce::AudioFormatManager& formatManager;
+        juce::ListenerList<Listener> listeners;
+        juce::SharedResourcePointer<DecodedAudioCache> decodedAudio;
+
+        juce::CriticalSection lock;
+        std::vector<Result> pending;
+
+        std::atomic<int> generation{ 0 };
+        std::atomic<int> numWaiting{ 0 };
+
+        std::function<bool()> throttleCheck;
+        std::atomic<bool> throttled{ false };
+        /**How long a job rests after each block it decodes while throttled*/
+        static constexpr int throttledPauseMillis = 50;
+
+        juce::ThreadPool pool{ juce::jmax(1, juce::SystemStats::getNumCpus() / 4),
+                               juce::Thread::osDefaultStackSize,
+                               juce::Thread::Priority::background };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TrackAnalyser)
+};
@@ -0,0 +1,405 @@
+/*
+  ==============================================================================
+
+    TrackStore.cpp
+    Created: 7 May 2023 1:15:33pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include "TrackStore.h"
+#include <algorithm>
+
+TrackStore::TrackStore()
+{
+}
+
+void TrackStore::open(std::shared_ptr<const Snapshot> newSnapshot)
+{
+    clear();
+    snapshot = std::move(newSnapshot);
+    if (snapshot != nullptr)
+    {
+        nextId = snapshot->getMaxId() + 1;
+    }
+}
+
+juce::uint32 TrackStore::add(const Track& track)
+{
+    juce::uint32 id = track.id;
+    if (id == 0 || getRow(id) >= 0)
+    {
+        id = nextId;
+    }
+    nextId = juce::jmax(nextId, id + 1);
+
+    addedById[id] = juce::uint32(addedSlots.size());
+    addedSlots.push_back(addSlot(id, track));
+    return id;
+}
+
+void TrackStore::update(const Track& track)
+{
+    int row = getRow(track.id);
+    if (row < 0)
+    {
+        return;
+    }
+    int index = -1;
+    int slot = findSlot(row, index);
+    if (slot >= 0)
+    {
+        setSlot(size_t(slot), track);
+    }
+    else
+    {
+        // a snapshot track is copied into the columns the first time it changes
+        editedInSnapshot[juce::uint32(index)] = addSlot(track.id, track);
+    }
+}
+
+void TrackStore::remove(juce::uint32 id)
+{
+    remove(std::vector<juce::uint32>{ id });
+}
+
+void TrackStore::remove(const std::vector<juce::uint32>& idsToRemove)
+{
+    size_t firstAdded = addedSlots.size();
+    std::vector<juce::uint32> fromSnapshot;
+    for (auto id : idsToRemove)
+    {
+        auto added = addedById.find(id);
+        if (added != addedById.end())
+        {
+            firstAdded = juce::jmin(firstAdded, size_t(added->second));
+            addedSlots[added->second] = noSlot;
+            addedById.erase(added);
+        }
+        else if (snapshot != nullptr && getRow(id) >= 0)
+        {
+            auto index = juce::uint32(snapshot->find(id));
+            fromSnapshot.push_back(index);
+            editedInSnapshot.erase(index);
+        }
+    }
+
+    // the snapshot's tracks are only marked as gone, in index order
+    if (!fromSnapshot.empty())
+    {
+        std::sort(fromSnapshot.begin(), fromSnapshot.end());
+        fromSnapshot.erase(std::unique(fromSnapshot.begin(), fromSnapshot.end()), fromSnapshot.end());
+        auto middle = removedFromSnapshot.insert(removedFromSnapshot.end(), fromSnapshot.begin(), fromSnapshot.end());
+        std::inplace_merge(removedFromSnapshot.begin(), middle, removedFromSnapshot.end());
+    }
+
+    // the added tracks after the first one removed close up
+    size_t kept = firstAdded;
+    for (size_t i = firstAdded; i < addedSlots.size(); ++i)
+    {
+        if (addedSlots[i] != noSlot)
+        {
+            addedSlots[kept] = addedSlots[i];
+            addedById[ids[addedSlots[kept]]] = juce::uint32(kept);
+            ++kept;
+        }
+    }
+    addedSlots.resize(kept);
+}
+
+void TrackStore::clear()
+{
+    snapshot.reset();
+    removedFromSnapshot.clear();
+    editedInSnapshot.clear();
+    addedSlots.clear();
+    addedById.clear();
+    ids.clear();
+    folders.clear();
+    fileNames.clear();
+    titles.clear();
+    artists.clear();
+    lengthMillis.clear();
+    bpms.clear();
+    firstDownbeats.clear();
+    keys.clear();
+    analysed.clear();
+    fileSizes.clear();
+    modificationTimes.clear();
+    contentHashes.clear();
+    nextId = 1;
+    folderPaths.clear();
+    folderLookup.clear();
+}
+
+void TrackStore::reserve(int numTracks)
+{
+    auto numRows = size_t(juce::jmax(0, numTracks));
+    addedSlots.reserve(numRows);
+    ids.reserve(numRows);
+    folders.reserve(numRows);
+    fileNames.reserve(numRows);
+    titles.reserve(numRows);
+    artists.reserve(numRows);
+    lengthMillis.reserve(numRows);
+    bpms.reserve(numRows);
+    firstDownbeats.reserve(numRows);
+    keys.reserve(numRows);
+    analysed.reserve(numRows);
+    fileSizes.reserve(numRows);
+    modificationTimes.reserve(numRows);
+    contentHashes.reserve(numRows);
+}
+
+int TrackStore::size() const
+{
+    return getNumFromSnapshot() + int(addedSlots.size());
+}
+
+int TrackStore::getRow(juce::uint32 id) const
+{
+    auto added = addedById.find(id);
+    if (added != addedById.end())
+    {
+        return getNumFromSnapshot() + int(added->second);
+    }
+    if (snapshot == nullptr)
+    {
+        return -1;
+    }
+    int index = snapshot->find(id);
+    if (index < 0)
+    {
+        return -1;
+    }
+    // each track removed before it moves it up a row
+    auto removed = std::lower_bound(removedFromSnapshot.begin(), removedFromSnapshot.end(), juce::uint32(index));
+    if (removed != removedFromSnapshot.end() && *removed == juce::uint32(index))
+    {
+        return -1;
+    }
+    return index - int(removed - removedFromSnapshot.begin());
+}
+
+juce::uint32 TrackStore::getId(int row) const
+{
+    int index = -1;
+    int slot = findSlot(row, index);
+    return slot >= 0 ? ids[size_t(slot)] : snapshot->getId(index);
+}
+
+juce::File TrackStore::getFile(int row) const
+{
+    int index = -1;
+    int slot = findSlot(row, index);
+    if (slot < 0)
+    {
+        return juce::File{ snapshot->getPath(index) };
+    }
+    return juce::File{ folderPaths[int(folders[size_t(slot)])] }.getChildFile(fileNames[size_t(slot)]);
+}
+
+juce::String TrackStore::getTitle(int row) const
+{
+    int index = -1;
+    int slot = findSlot(row, index);
+    if (slot < 0)
+    {
+        auto title = snapshot->getTitle(index);
+        return title.isNotEmpty() ? title : juce::File{ snapshot->getPath(index) }.getFileNameWithoutExtension();
+    }
+    const juce::String& title = titles[size_t(slot)];
+    if (title.isEmpty())
+    {
+        return fileNames[size_t(slot)].upToLastOccurrenceOf(".", false, false);
+    }
+    return title;
+}
+
+juce::String TrackStore::getArtist(int row) const
+{
+    int index = -1;
+    int slot = findSlot(row, index);
+    return slot >= 0 ? artists[size_t(slot)] : snapshot->getArtist(index);
+}
+
+double TrackStore::getLengthInSeconds(int row) const
+{
+    int index = -1;
+    int slot = findSlot(row, index);
+    return (slot >= 0 ? lengthMillis[size_t(slot)] : snapshot->getLengthMillis(index)) / 1000.0;
+}
+
+double TrackStore::getBpm(int row) const
+{
+    int index = -1;
+    int slot = findSlot(row, index);
+    return slot >= 0 ? bpms[size_t(slot)] : snapshot->getBpm(index);
+}
+
+double TrackStore::getFirstDownbeat(int row) const
+{
+    int index = -1;
+    int slot = findSlot(row, index);
+    return slot >= 0 ? firstDownbeats[size_t(slot)] : snapshot->getFirstDownbeat(index);
+}
+
+bool TrackStore::getBeatsAnalysed(int row) const
+{
+    return (getAnalysisFlags(row) & beatsAnalysedFlag) != 0;
+}
+
+bool TrackStore::getBeatGridFound(int row) const
+{
+    return (getAnalysisFlags(row) & beatGridFoundFlag) != 0;
+}
+
+int TrackStore::getKey(int row) const
+{
+    int index = -1;
+    int slot = findSlot(row, index);
+    return slot >= 0 ? keys[size_t(slot)] : snapshot->getKey(index);
+}
+
+bool TrackStore::getKeyAnalysed(int row) const
+{
+    return (getAnalysisFlags(row) & keyAnalysedFlag) != 0;
+}
+
+FileIdentity TrackStore::getIdentity(int row) const
+{
+    int index = -1;
+    int slot = findSlot(row, index);
+    if (slot < 0)
+    {
+        return snapshot->getIdentity(index);
+    }
+    FileIdentity identity;
+    identity.path = getFile(row).getFullPathName();
+    identity.size = fileSizes[size_t(slot)];
+    identity.modificationTime = modificationTimes[size_t(slot)];
+    identity.contentHash = contentHashes[size_t(slot)];
+    return identity;
+}
+
+Track TrackStore::getTrack(int row) const
+{
+    Track track{ getFile(row) };
+    track.id = getId(row);
+    track.title = getTitle(row);
+    track.artist = getArtist(row);
+    track.lengthInSeconds = getLengthInSeconds(row);
+    track.bpm = getBpm(row);
+    track.firstDownbeat = getFirstDownbeat(row);
+    unpackAnalysisFlags(track, getAnalysisFlags(row));
+    track.key = getKey(row);
+    track.identity = getIdentity(row);
+    return track;
+}
+
+juce::uint8 TrackStore::getAnalysisFlags(int row) const
+{
+    int index = -1;
+    int slot = findSlot(row, index);
+    return slot >= 0 ? analysed[size_t(slot)] : snapshot->getAnalysisFlags(index);
+}
+
+juce::uint8 TrackStore::packAnalysisFlags(const Track& track)
+{
+    return juce::uint8((track.beatsAnalysed ? beatsAnalysedFlag : 0)
+                       | (track.keyAnalysed ? keyAnalysedFlag : 0)
+                       | (track.beatGridFound ? beatGridFoundFlag : 0));
+}
+
+void TrackStore::unpackAnalysisFlags(Track& track, juce::uint32 flags)
+{
+    track.beatsAnalysed = (flags & beatsAnalysedFlag) != 0;
+    track.keyAnalysed = (flags & keyAnalysedFlag) != 0;
+    track.beatGridFound = (flags & beatGridFoundFlag) != 0;
+}
+
+juce::uint32 TrackStore::internFolder(const juce::String& folder)
+{
+    auto it = folderLookup.find(folder);
+    if (it != folderLookup.end())
+    {
+        return it->second;
+    }
+    auto index = juce::uint32(folderPaths.size());
+    folderPaths.add(folder);
+    folderLookup[folder] = index;
+    return index;
+}
+
+int TrackStore::getNumFromSnapshot() const
+{
+    return snapshot != nullptr ? snapshot->size() - int(removedFromSnapshot.size()) : 0;
+}
+
+int TrackStore::findSlot(int row, int& index) const
+{
+    int numFromSnapshot = getNumFromSnapshot();
+    if (row >= numFromSnapshot)
+    {
+        return int(addedSlots[size_t(row - numFromSnapshot)]);
+    }
+
+    // the index is the row pushed on by every removed index at or before it,
+    // so the count is the number of removed indices i where i - place <= row
+    size_t low = 0;
+    size_t high = removedFromSnapshot.size();
+    while (low < high)
+    {
+        size_t middle = (low + high) / 2;
+        if (juce::int64(removedFromSnapshot[middle]) - juce::int64(middle) <= row)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    index = row + int(low);
+
+    auto edited = editedInSnapshot.find(juce::uint32(index));
+    return edited != editedInSnapshot.end() ? int(edited->second) : -1;
+}
+
+juce::uint32 TrackStore::addSlot(juce::uint32 id, const Track& track)
+{
+    size_t slot = ids.size();
+    ids.push_back(id);
+    folders.emplace_back();
+    fileNames.emplace_back();
+    titles.emplace_back();
+    artists.emplace_back();
+    lengthMillis.emplace_back();
+    bpms.emplace_back();
+    firstDownbeats.emplace_back();
+    keys.emplace_back();
+    analysed.emplace_back();
+    fileSizes.emplace_back();
+    modificationTimes.emplace_back();
+    contentHashes.emplace_back();
+    setSlot(slot, track);
+    return juce::uint32(slot);
+}
+
+void TrackStore::setSlot(size_t slot, const Track& track)
+{
+    folders[slot] = internFolder(track.file.getParentDirectory().getFullPathName());
+    fileNames[slot] = track.file.getFileName();
+    // most titles are just the file name, so those aren't stored twice
+    titles[slot] = track.title == track.file.getFileNameWithoutExtension() ? juce::String() : track.title;
+    artists[slot] = track.artist;
+    lengthMillis[slot] = juce::uint32(juce::jmax(0, juce::roundToInt(track.lengthInSeconds * 1000.0)));
+    bpms[slot] = float(track.bpm);
+    firstDownbeats[slot] = float(track.firstDownbeat);
+    keys[slot] = juce::int8(juce::jlimit(-1, 23, track.key));
+    analysed[slot] = packAnalysisFlags(track);
+    fileSizes[slot] = track.identity.size;
+    modificationTimes[slot] = track.identity.modificationTime;
+    contentHashes[slot] = track.identity.contentHash;
+}
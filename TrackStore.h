@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+    TrackStore.h
+    Created: 7 May 2023 1:15:33pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Track.h"
+
+//==============================================================================
+/*
+    Holds the library one column per field rather than one object per track,
+    so a large library costs a few small arrays instead of a juce::File per
+    track.
+
+    Folders are stored once and shared by every track in them, durations are
+    kept as milliseconds and a title is only stored when it differs from the
+    file name. Tracks keep the same 32-bit id for the life of the library,
+    while their row changes as tracks before them are removed.
+
+    A store can be opened on a snapshot, like the memory-mapped library
+    file, whose tracks make up the first rows and are read from it in place,
+    so opening takes no longer for a larger library. A snapshot track is
+    only copied into the columns once it is edited, and removing one only
+    notes that it is gone.
+*/
+class TrackStore
+{
+    public:
+        /**Tracks kept outside the store, in their own order, which the store
+           reads without copying*/
+        class Snapshot
+        {
+            public:
+                virtual ~Snapshot() = default;
+
+                virtual int size() const = 0;
+                /**Gets the index of a track by id, or -1 if it isn't there*/
+                virtual int find(juce::uint32 id) const = 0;
+                virtual juce::uint32 getMaxId() const = 0;
+                virtual juce::uint32 getId(int index) const = 0;
+                virtual juce::String getPath(int index) const = 0;
+                virtual juce::String getTitle(int index) const = 0;
+                virtual juce::String getArtist(int index) const = 0;
+                virtual juce::uint32 getLengthMillis(int index) const = 0;
+                virtual float getBpm(int index) const = 0;
+                virtual float getFirstDownbeat(int index) const = 0;
+                /**-1 unless the key has been analysed*/
+                virtual int getKey(int index) const = 0;
+                virtual juce::uint8 getAnalysisFlags(int index) const = 0;
+                virtual FileIdentity getIdentity(int index) const = 0;
+        };
+
+        TrackStore();
+
+        /**Empties the store and serves the snapshot's tracks as its first rows*/
+        void open(std::shared_ptr<const Snapshot> newSnapshot);
+
+        /**Adds a track to the end, keeping its id if it has one that isn't
+           already used. Returns the track's id*/
+        juce::uint32 add(const Track& track);
+        /**Replaces the details of a track already in the store, matched by id*/
+        void update(const Track& track);
+        /**Removes a track, moving every track after it up a row*/
+        void remove(juce::uint32 id);
+        /**Removes several tracks in a single pass*/
+        void remove(const std::vector<juce::uint32>& idsToRemove);
+        void clear();
+        /**Makes room for a number of tracks, so loading a library doesn't keep
+           growing every column*/
+        void reserve(int numTracks);
+
+        int size() const;
+        /**Gets the row of a track, or -1 if it isn't in the store*/
+        int getRow(juce::uint32 id) const;
+        juce::uint32 getId(int row) const;
+        juce::File getFile(int row) const;
+        juce::String getTitle(int row) const;
+        juce::String getArtist(int row) const;
+        double getLengthInSeconds(int row) const;
+        double getBpm(int row) const;
+        double getFirstDownbeat(int row) const;
+        bool getBeatsAnalysed(int row) const;
+        bool getBeatGridFound(int row) const;
+        int getKey(int row) const;
+        bool getKeyAnalysed(int row) const;
+        FileIdentity getIdentity(int row) const;
+        /**Copies a whole row out as a Track*/
+        Track getTrack(int row) const;
+        /**Which analyses a track has had and what they found, as flags like beatsAnalysedFlag*/
+        juce::uint8 getAnalysisFlags(int row) const;
+
+        /**The analysis flags, kept the same in the library file*/
+        static constexpr juce::uint8 beatsAnalysedFlag = 1;
+        static constexpr juce::uint8 keyAnalysedFlag = 2;
+        static constexpr juce::uint8 beatGridFoundFlag = 4;
+        static juce::uint8 packAnalysisFlags(const Track& track);
+        static void unpackAnalysisFlags(Track& track, juce::uint32 flags);
+
+    private:
+        juce::uint32 internFolder(const juce::String& folder);
+        /**Adds a slot to the end of every column and fills it in*/
+        juce::uint32 addSlot(juce::uint32 id, const Track& track);
+        void setSlot(size_t slot, const Track& track);
+        int getNumFromSnapshot() const;
+        /**Gets a row's slot in the columns, or -1 with index set to where the
+           snapshot has it*/
+        int findSlot(int row, int& index) const;
+
+        static constexpr juce::uint32 noSlot = 0xffffffff;
+
+        std::shared_ptr<const Snapshot> snapshot;
+        /**Snapshot indices of the tracks removed since it was opened, in order*/
+        std::vector<juce::uint32> removedFromSnapshot;
+        /**Slots of the snapshot tracks edited since it was opened, by index*/
+        std::unordered_map<juce::uint32, juce::uint32> editedInSnapshot;
+        /**Slots of the tracks added after the snapshot's, in row order*/
+        std::vector<juce::uint32> addedSlots;
+        /**Where each added track is in addedSlots, by id*/
+        std::unordered_map<juce::uint32, juce::uint32> addedById;
+
+        /**Columns by slot. A removed track's slot is left unused until the
+           store is cleared*/
+        std::vector<juce::uint32> ids;
+        std::vector<juce::uint32> folders;
+        std::vector<juce::String> fileNames;
+        std::vector<juce::String> titles;
+        std::vector<juce::String> artists;
+        std::vector<juce::uint32> lengthMillis;
+        std::vector<float> bpms;
+        std::vector<float> firstDownbeats;
+        std::vector<juce::int8> keys;
+        /**Which analyses have been run, as flags like beatsAnalysedFlag*/
+        std::vector<juce::uint8> analysed;
+        std::vector<juce::int64> fileSizes;
+        std::vector<juce::int64> modificationTimes;
+        std::vector<juce::uint64> contentHashes;
+
+        juce::uint32 nextId{ 1 };
+
+        juce::StringArray folderPaths;
+        std::unordered_map<juce::String, juce::uint32> folderLookup;
+
+        JUCE_LEAK_DETECTOR (TrackStore)
+};
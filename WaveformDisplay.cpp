@@ -10,12 +10,160 @@
 
 #include <JuceHeader.h>
 #include "WaveformDisplay.h"
+#include "FileIdentity.h"
+#include "PeakCache.h"
+
+//==============================================================================
+class WaveformDisplay::RenderJob : public juce::ThreadPoolJob
+{
+    public:
+        RenderJob(WaveformDisplay& owner)
+            : juce::ThreadPoolJob("WaveformDisplay::RenderJob"),
+              display(&owner),
+              width(owner.getWidth()),
+              height(owner.getHeight()),
+              fileLoaded(owner.fileLoaded),
+              fileName(owner.fileName)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            // the owner waits for this job before it is deleted, so it can be drawn from here
+            juce::Image layer{ juce::Image::RGB, juce::jmax(1, width), juce::jmax(1, height), true,
+                               juce::SoftwareImageType() };
+            {
+                juce::Graphics g{ layer };
+                display.getComponent()->drawStaticLayer(g, width, height, fileLoaded, fileName);
+            }
+
+            juce::MessageManager::callAsync([display = display, layer]
+            {
+                if (display != nullptr)
+                {
+                    display->staticLayer = layer;
+                    display->isRendering = false;
+                    display->repaint();
+                    if (display->needsRender)
+                    {
+                        display->renderStaticLayer();
+                    }
+                }
+            });
+            return jobHasFinished;
+        }
+
+    private:
+        juce::Component::SafePointer<WaveformDisplay> display;
+        int width;
+        int height;
+        bool fileLoaded;
+        juce::String fileName;
+};
+
+//==============================================================================
+class WaveformDisplay::ThumbnailJob : public juce::ThreadPoolJob
+{
+    public:
+        ThumbnailJob(WaveformDisplay& owner, juce::File _file)
+            : juce::ThreadPoolJob("WaveformDisplay::ThumbnailJob"),
+              display(owner),
+              safeDisplay(&owner),
+              file(_file),
+              generation(owner.loadGeneration)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            // local files are looked up by content, so their peaks are found on disk.
+            // Hashing reads both ends of the file, so it's done here rather than on load
+            auto startTime = juce::Time::getMillisecondCounterHiRes();
+            hashCode = juce::int64(FileIdentity::read(file, true).contentHash);
+            {
+                const juce::ScopedLock sl(display.thumbnailLock);
+                if (shouldExit() || display.loadGeneration != generation)
+                {
+                    return jobHasFinished;
+                }
+                if (hashCode != 0 && display.thumbCache.loadThumb(display.audioThumb, hashCode))
+                {
+                    DBG("WaveformDisplay loaded " << file.getFileName() << " from the peak cache in "
+                        << juce::Time::getMillisecondCounterHiRes() - startTime << " ms");
+                    juce::MessageManager::callAsync([safeDisplay = safeDisplay, jobGeneration = generation]
+                    {
+                        if (safeDisplay != nullptr && safeDisplay->loadGeneration == jobGeneration)
+                        {
+                            safeDisplay->renderStaticLayer();
+                        }
+                    });
+                    return jobHasFinished;
+                }
+            }
+
+            // otherwise filled in from the same decode the deck and the zoomed waveform use
+            auto audio = display.decodedAudio->getOrDecode(file, display.formatManager);
+            if (audio == nullptr)
+            {
+                // too big to keep decoded, so the thumbnail reads the file itself
+                juce::MessageManager::callAsync([safeDisplay = safeDisplay, jobGeneration = generation,
+                                                 file = file, hashCode = hashCode]
+                {
+                    if (safeDisplay != nullptr && safeDisplay->loadGeneration == jobGeneration)
+                    {
+                        safeDisplay->fileLoaded = hashCode != 0
+                            ? safeDisplay->audioThumb.setSource(new PeakCache::Source(file, juce::uint64(hashCode)))
+                            : safeDisplay->audioThumb.setSource(new juce::FileInputSource(file));
+                        safeDisplay->renderStaticLayer();
+                    }
+                });
+                return jobHasFinished;
+            }
+
+            const auto& samples = audio->samples;
+            {
+                const juce::ScopedLock sl(display.thumbnailLock);
+                if (display.loadGeneration != generation)
+                {
+                    return jobHasFinished;
+                }
+                display.audioThumb.reset(samples.getNumChannels(), audio->sampleRate, samples.getNumSamples());
+            }
+            const int blockSize = 65536;
+            for (int start = 0; start < samples.getNumSamples(); start += blockSize)
+            {
+                const juce::ScopedLock sl(display.thumbnailLock);
+                if (shouldExit() || display.loadGeneration != generation)
+                {
+                    return jobHasFinished;
+                }
+                display.audioThumb.addBlock(start, samples, start, juce::jmin(blockSize, samples.getNumSamples() - start));
+            }
+
+            // saved to the peak cache so it isn't built again
+            const juce::ScopedLock sl(display.thumbnailLock);
+            if (hashCode != 0 && display.loadGeneration == generation)
+            {
+                display.thumbCache.storeThumb(display.audioThumb, hashCode);
+            }
+            return jobHasFinished;
+        }
+
+    private:
+        WaveformDisplay& display;
+        juce::Component::SafePointer<WaveformDisplay> safeDisplay;
+        juce::File file;
+        juce::int64 hashCode{ 0 };
+        int generation;
+};
 
 //==============================================================================
 WaveformDisplay::WaveformDisplay(int _id,
-                                 juce::AudioFormatManager& formatManager,
-                                 juce::AudioThumbnailCache& thumbCache
-                                ) : audioThumb(1000, formatManager, thumbCache),
+                                 juce::AudioFormatManager& _formatManager,
+                                 juce::AudioThumbnailCache& _thumbCache
+                                ) : formatManager(_formatManager),
+                                    thumbCache(_thumbCache),
+                                    audioThumb(1000, _formatManager, _thumbCache),
                                     fileLoaded(false),
                                     position(0),
                                     id(_id)
@@ -27,43 +175,59 @@ WaveformDisplay::WaveformDisplay(int _id,
 
 WaveformDisplay::~WaveformDisplay()
 {
+    audioThumb.removeChangeListener(this);
+    thumbnailPool.removeAllJobs(true, 10000);
+    renderPool.removeAllJobs(true, 2000);
 }
 
 void WaveformDisplay::paint (juce::Graphics& g)
 {
-    /* This demo code just fills the component's background and
-       draws some placeholder text to get you started.
+    // only the playhead is drawn here, the rest was drawn in the background
+    if (staticLayer.isValid())
+    {
+        g.drawImageAt(staticLayer, 0, 0);
+    }
+    else
+    {
+        auto colour1 = juce::Colours::red;
+        auto colour2 = juce::Colours::purple;
+        g.fillAll (colour1.interpolatedWith (colour2, 0.5f));
+    }
 
-       You should replace everything in this method with your own
-       drawing code..
-    */
+    if (fileLoaded)
+    {
+        g.setColour(juce::Colours::white);
+        g.drawRect(getPlayheadBounds(position), 1);
+    }
+}
 
+void WaveformDisplay::drawStaticLayer(juce::Graphics& g, int width, int height, bool loaded, const juce::String& name)
+{
+    juce::Rectangle<int> bounds{ 0, 0, width, height };
     //g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId)); // clear the background
     //g.setColour (juce::Colours::grey);
     auto colour1 = juce::Colours::red;
     auto colour2 = juce::Colours::purple;
     g.fillAll (colour1.interpolatedWith (colour2, 0.5f));
-    g.drawRect(getLocalBounds(), 1);   // draw an outline around the component
+    g.drawRect(bounds, 1);   // draw an outline around the component
     g.setColour(juce::Colours::white);
 
     g.setFont(18.0f);
-    g.drawText("Deck: " + std::to_string(id), getLocalBounds(),
+    g.drawText("Deck: " + std::to_string(id), bounds,
             juce::Justification::topLeft, true);
 
-    if (fileLoaded)
+    if (loaded)
     {
         g.setFont(15.0f);
         audioThumb.drawChannel(g,
-                               getLocalBounds(),
+                               bounds,
                                0,
                                audioThumb.getTotalLength(),
                                0,
                                1.0f
                               );
-        g.setColour(juce::Colours::white);
-        g.drawRect(position * getWidth(), 0, getWidth() / 20, getHeight());
         g.setColour(juce::Colours::black);
-        g.drawText(fileName, getLocalBounds(),
+        g.drawText(name, bounds,
             juce::Justification::bottomLeft, true);
     }
     else
@@ -72,7 +236,7 @@ void WaveformDisplay::paint (juce::Graphics& g)
         auto colour1 = juce::Colours::red;
         auto colour2 = juce::Colours::purple;
         g.fillAll (colour1.interpolatedWith (colour2, 0.5f));
-        g.drawText("File not loaded...", getLocalBounds(),
+        g.drawText("File not loaded...", bounds,
             juce::Justification::centred, true);   // draw some placeholder text
     }
 }
@@ -81,36 +245,83 @@ void WaveformDisplay::resized()
 {
     // This method is where you should set the bounds of any child
     // components that your component contains..
-
+    renderStaticLayer();
 }
 
 void WaveformDisplay::changeListenerCallback(juce::ChangeBroadcaster* source)
 {
-    repaint();
+    // more of the thumbnail has been read
+    renderStaticLayer();
+}
+
+void WaveformDisplay::renderStaticLayer()
+{
+    if (isRendering)
+    {
+        needsRender = true;
+        return;
+    }
+    needsRender = false;
+    if (getWidth() > 0 && getHeight() > 0)
+    {
+        isRendering = true;
+        renderPool.addJob(new RenderJob(*this), true);
+    }
+}
+
+juce::Rectangle<int> WaveformDisplay::getPlayheadBounds(double pos) const
+{
+    return { int(pos * getWidth()), 0, getWidth() / 20, getHeight() };
 }
 
 void WaveformDisplay::loadURL(juce::URL audioURL)
 {
     DBG("WaveformDisplay::loadURL called");
-    audioThumb.clear();
-    fileLoaded = audioThumb.setSource(new juce::URLInputSource(audioURL));
+    thumbnailPool.removeAllJobs(true, 0);
+    {
+        const juce::ScopedLock sl(thumbnailLock);
+        ++loadGeneration;
+        audioThumb.clear();
+    }
+    if (audioURL.isLocalFile())
+    {
+        // the peaks are found, or built, in the background
+        juce::File file = audioURL.getLocalFile();
+        fileLoaded = file.existsAsFile();
+        if (fileLoaded)
+        {
+            thumbnailPool.addJob(new ThumbnailJob(*this, file), true);
+        }
+    }
+    else
+    {
+        fileLoaded = audioThumb.setSource(new juce::URLInputSource(audioURL));
+    }
+
     if (fileLoaded)
     {
         DBG("WaveformDisplay::loadURL file loaded");
         fileName = audioURL.getFileName();
-        repaint();
     }
     else
     {
         DBG("WaveformDisplay::loadURL file NOT loaded");
     }
+    renderStaticLayer();
 }
 
 void WaveformDisplay::setPositionRelative(double pos)
 {
     if (pos != position)
     {
+        // only the old and new playhead need drawing again
+        auto oldBounds = getPlayheadBounds(position);
         position = pos;
-        repaint();
+        auto newBounds = getPlayheadBounds(position);
+        if (newBounds != oldBounds)
+        {
+            repaint(oldBounds);
+            repaint(newBounds);
+        }
     }
 }
@@ -11,6 +11,7 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "DecodedAudioCache.h"
 
 //==============================================================================
 /*
@@ -31,10 +32,36 @@ public:
     /**set the relative position of the playhead*/
     void setPositionRelative(double pos);
 private:
+    /**Draws everything but the playhead into an image off the message thread*/
+    class RenderJob;
+    /**Fills the thumbnail from the peak cache, or else the decoded audio cache*/
+    class ThumbnailJob;
+
     int id;
     bool fileLoaded;
     double position;
     juce::String fileName;
+    juce::AudioFormatManager& formatManager;
+    juce::AudioThumbnailCache& thumbCache;
     juce::AudioThumbnail audioThumb;
+
+    juce::SharedResourcePointer<DecodedAudioCache> decodedAudio;
+    juce::ThreadPool thumbnailPool{ 1 };
+    /**Held while the thumbnail is filled or cleared, so a job for an earlier
+       file never writes into the thumbnail of the current one*/
+    juce::CriticalSection thumbnailLock;
+    int loadGeneration{ 0 };
+
+    /**The waveform and text, redrawn only on load, resize or new peaks*/
+    juce::Image staticLayer;
+    juce::ThreadPool renderPool{ 1 };
+    bool isRendering{ false };
+    bool needsRender{ false };
+
+    /**Starts drawing a new static layer, or another one once the current one is done*/
+    void renderStaticLayer();
+    /**Takes the file details as they were when the render started, as they may have changed since*/
+    void drawStaticLayer(juce::Graphics& g, int width, int height, bool loaded, const juce::String& name);
+    juce::Rectangle<int> getPlayheadBounds(double pos) const;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveformDisplay)
 };
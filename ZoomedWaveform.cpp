@@ -0,0 +1,197 @@
+/*
+  ==============================================================================
+
+    ZoomedWaveform.cpp
+    Created: 21 May 2023 5:08:33pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "ZoomedWaveform.h"
+#include "FileIdentity.h"
+#include "DecodedAudioCache.h"
+
+//==============================================================================
+class ZoomedWaveform::BuildJob : public juce::ThreadPoolJob
+{
+    public:
+        BuildJob(ZoomedWaveform& owner, juce::File _file)
+            : juce::ThreadPoolJob("ZoomedWaveform::BuildJob"),
+              display(&owner),
+              formatManager(owner.formatManager),
+              peakCache(owner.peakCache),
+              file(_file),
+              generation(owner.generation)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            auto newPyramid = std::make_shared<PeakPyramid>();
+            juce::uint64 contentHash = FileIdentity::read(file, true).contentHash;
+            juce::File pyramidFile = peakCache.getPeakFile(juce::int64(contentHash)).withFileExtension("pyramid");
+
+            if (contentHash == 0 || !readPyramid(pyramidFile, *newPyramid))
+            {
+                // shares the decode with the deck, reading the file only if it can't be cached
+                auto shouldStop = [this] { return shouldExit(); };
+                bool built = false;
+                if (auto audio = decodedAudio->getOrDecode(file, formatManager))
+                {
+                    built = newPyramid->build(audio->samples, audio->sampleRate, shouldStop);
+                }
+                else if (std::unique_ptr<juce::AudioFormatReader> reader{ formatManager.createReaderFor(file) })
+                {
+                    built = newPyramid->build(*reader, shouldStop);
+                }
+                if (!built)
+                {
+                    return jobHasFinished;
+                }
+                if (contentHash != 0)
+                {
+                    writePyramid(pyramidFile, *newPyramid);
+                }
+            }
+
+            // handed over on the message thread, unless another file was loaded since
+            juce::MessageManager::callAsync([display = display, jobGeneration = generation, newPyramid]
+            {
+                if (display != nullptr && display->generation == jobGeneration)
+                {
+                    display->pyramid = newPyramid;
+                    display->repaint();
+                }
+            });
+            return jobHasFinished;
+        }
+
+    private:
+        static bool readPyramid(const juce::File& pyramidFile, PeakPyramid& pyramidToLoad)
+        {
+            juce::MemoryMappedFile mapped{ pyramidFile, juce::MemoryMappedFile::readOnly };
+            if (mapped.getData() == nullptr)
+            {
+                return false;
+            }
+            juce::MemoryInputStream in{ mapped.getData(), mapped.getSize(), false };
+            return pyramidToLoad.loadFrom(in);
+        }
+
+        static void writePyramid(const juce::File& pyramidFile, const PeakPyramid& pyramidToSave)
+        {
+            if (!pyramidFile.getParentDirectory().createDirectory())
+            {
+                return;
+            }
+            juce::MemoryOutputStream out;
+            pyramidToSave.saveTo(out);
+            juce::TemporaryFile temp{ pyramidFile };
+            if (temp.getFile().replaceWithData(out.getData(), out.getDataSize()))
+            {
+                temp.overwriteTargetFileWithTemporary();
+            }
+        }
+
+        juce::Component::SafePointer<ZoomedWaveform> display;
+        juce::SharedResourcePointer<DecodedAudioCache> decodedAudio;
+        juce::AudioFormatManager& formatManager;
+        PeakCache& peakCache;
+        juce::File file;
+        int generation;
+};
+
+//==============================================================================
+ZoomedWaveform::ZoomedWaveform(juce::AudioFormatManager& _formatManager,
+                               PeakCache& _peakCache
+                              ) : formatManager(_formatManager),
+                                  peakCache(_peakCache)
+{
+}
+
+ZoomedWaveform::~ZoomedWaveform()
+{
+    buildPool.removeAllJobs(true, 2000);
+}
+
+void ZoomedWaveform::paint (juce::Graphics& g)
+{
+    auto colour1 = juce::Colours::red;
+    auto colour2 = juce::Colours::purple;
+    g.fillAll (colour1.interpolatedWith (colour2, 0.5f));
+    g.setColour(juce::Colours::white);
+    g.drawRect(getLocalBounds(), 1);   // draw an outline around the component
+
+    if (pyramid == nullptr || pyramid->isEmpty())
+    {
+        g.setFont(15.0f);
+        g.drawText(fileLoaded ? "Building waveform..." : "", getLocalBounds(),
+                   juce::Justification::centred, true);
+        return;
+    }
+
+    // the playhead stays in the middle and the waveform moves past it
+    double samplesPerPixel = visibleSeconds * pyramid->getSampleRate() / juce::jmax(1, getWidth());
+    int level = pyramid->chooseLevel(samplesPerPixel);
+    double playheadSample = position * double(pyramid->getLengthInSamples());
+    double firstSample = playheadSample - samplesPerPixel * getWidth() / 2.0;
+    float centreY = getHeight() / 2.0f;
+    float halfHeight = getHeight() / 2.0f - 1.0f;
+
+    for (int x = 0; x < getWidth(); ++x)
+    {
+        double start = firstSample + x * samplesPerPixel;
+        double end = start + samplesPerPixel;
+        if (end <= 0.0 || start >= double(pyramid->getLengthInSamples()))
+        {
+            continue;
+        }
+        auto peak = pyramid->getPeak(level, juce::int64(start), juce::int64(std::ceil(end)));
+        g.setColour(juce::Colours::white.withAlpha(0.5f));
+        g.drawVerticalLine(x, centreY - peak.maximum * halfHeight, centreY - peak.minimum * halfHeight + 1.0f);
+        g.setColour(juce::Colours::white);
+        g.drawVerticalLine(x, centreY - peak.rms * halfHeight, centreY + peak.rms * halfHeight + 1.0f);
+    }
+
+    g.setColour(juce::Colours::black);
+    g.drawVerticalLine(getWidth() / 2, 0.0f, float(getHeight()));
+}
+
+void ZoomedWaveform::resized()
+{
+}
+
+void ZoomedWaveform::mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel)
+{
+    // scrolling up zooms in, each full notch halves or doubles the time shown
+    visibleSeconds = juce::jlimit(minVisibleSeconds, maxVisibleSeconds,
+                                  visibleSeconds * std::pow(2.0, -wheel.deltaY * 4.0));
+    repaint();
+}
+
+void ZoomedWaveform::loadURL(juce::URL audioURL)
+{
+    DBG("ZoomedWaveform::loadURL called");
+    ++generation;
+    pyramid.reset();
+    position = 0.0;
+    buildPool.removeAllJobs(true, 0);
+
+    fileLoaded = audioURL.isLocalFile();
+    if (fileLoaded)
+    {
+        buildPool.addJob(new BuildJob(*this, audioURL.getLocalFile()), true);
+    }
+    repaint();
+}
+
+void ZoomedWaveform::setPositionRelative(double pos)
+{
+    if (pos != position)
+    {
+        position = pos;
+        repaint();
+    }
+}
@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    ZoomedWaveform.h
+    Created: 21 May 2023 5:08:33pm
+    Author:  Marcus Mui
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include "PeakCache.h"
+#include "PeakPyramid.h"
+
+//==============================================================================
+/*
+    A close up of the waveform that scrolls with the playhead, which stays
+    in the middle. The mouse wheel zooms in and out, and each redraw uses
+    the pyramid level closest to one bin per pixel.
+
+    The pyramid is built on a background thread the first time a track is
+    loaded and kept in the peak cache for next time.
+*/
+class ZoomedWaveform  : public juce::Component
+{
+public:
+    ZoomedWaveform(juce::AudioFormatManager& _formatManager,
+                   PeakCache& _peakCache);
+    ~ZoomedWaveform() override;
+
+    void paint (juce::Graphics&) override;
+    void resized() override;
+    /**Zooms in or out around the playhead*/
+    void mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel) override;
+    void loadURL(juce::URL audioURL);
+    /**set the relative position of the playhead*/
+    void setPositionRelative(double pos);
+
+private:
+    /**Loads or builds the pyramid for one file*/
+    class BuildJob;
+
+    juce::AudioFormatManager& formatManager;
+    PeakCache& peakCache;
+    juce::ThreadPool buildPool{ 1 };
+    /**Bumped on every load so a job for an earlier file is ignored*/
+    int generation{ 0 };
+    bool fileLoaded{ false };
+
+    std::shared_ptr<const PeakPyramid> pyramid;
+    double position{ 0.0 };
+    /**Seconds of audio shown across the whole width*/
+    double visibleSeconds{ 8.0 };
+    static constexpr double minVisibleSeconds = 1.0;
+    static constexpr double maxVisibleSeconds = 64.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ZoomedWaveform)
+};